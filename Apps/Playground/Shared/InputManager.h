@@ -23,7 +23,7 @@ public:
             {
                 m_pointerX = x;
                 m_pointerY = y;
-            });
+            }, Babylon::JsRuntime::DispatchPriority::Input);
         }
 
         void SetPointerDown(bool isPointerDown)
@@ -31,7 +31,7 @@ public:
             m_runtime.Dispatch([isPointerDown, this](Napi::Env)
             {
                 m_isPointerDown = isPointerDown;
-            });
+            }, Babylon::JsRuntime::DispatchPriority::Input);
         }
 
         int GetPointerX() const
@@ -5,12 +5,15 @@
 #include <X11/Xutil.h>
 #include <unistd.h> // syscall
 #undef None
+#include <cstdlib>
 #include <filesystem>
+#include <fstream>
 
 #include <Shared/InputManager.h>
 
 #include <Babylon/AppRuntime.h>
 #include <Babylon/ScriptLoader.h>
+#include <Babylon/StartupProfiler.h>
 #include <Babylon/Plugins/NativeEngine.h>
 #include <Babylon/Plugins/NativeWindow.h>
 #include <Babylon/Polyfills/Console.h>
@@ -214,6 +217,12 @@ int main(int _argc, const char* const* _argv)
                 break;
         }
     }
+    // Lets CI track cold-start time; the file loads in chrome://tracing or Perfetto.
+    if (const char* tracePath = std::getenv("BABYLON_NATIVE_STARTUP_TRACE"))
+    {
+        std::ofstream{tracePath} << Babylon::StartupProfiler::ToChromeTrace();
+    }
+
     XDestroyIC(ic);
     XCloseIM(im);
 
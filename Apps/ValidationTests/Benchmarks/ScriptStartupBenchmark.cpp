@@ -0,0 +1,181 @@
+// Measures how long the Babylon scripts take to load with ScriptLoader's code cache, first with
+// an empty cache directory (cold) and then with the cache those runs produced (warm). Every run
+// creates a fresh runtime so nothing compiled by an earlier run is reused in memory. See
+// Scripts/README.md for how to read the output.
+
+#include <Babylon/AppRuntime.h>
+#include <Babylon/ScriptLoader.h>
+#include <Babylon/StartupProfiler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t RUN_COUNT{5};
+
+    // The code cache is written on the thread pool after a cold run, which the benchmark waits for.
+    constexpr std::chrono::seconds CODE_CACHE_TIMEOUT{10};
+
+    std::string ToFileUrl(const std::filesystem::path& path)
+    {
+        const auto absolutePath = std::filesystem::absolute(path).generic_string();
+        return absolutePath.front() == '/' ? "file://" + absolutePath : "file:///" + absolutePath;
+    }
+
+    struct Run
+    {
+        double TotalMilliseconds{};
+        double EvalMilliseconds{};
+    };
+
+    Run LoadScripts(const std::vector<std::string>& urls, const std::filesystem::path& codeCacheDirectory)
+    {
+        const auto firstEvent = Babylon::StartupProfiler::GetEvents().size();
+        const auto start = Clock::now();
+
+        {
+            Babylon::AppRuntime runtime{};
+            Babylon::ScriptLoader loader{runtime};
+            loader.EnableCodeCache(codeCacheDirectory.string());
+
+            std::promise<void> loaded{};
+            size_t loadedCount{0};
+            loader.SetScriptStatsCallback([&loaded, &loadedCount, &urls](const Babylon::ScriptLoader::ScriptStats&) {
+                if (++loadedCount == urls.size())
+                {
+                    loaded.set_value();
+                }
+            });
+
+            for (const auto& url : urls)
+            {
+                loader.LoadScript(url);
+            }
+
+            loaded.get_future().wait();
+        }
+
+        Run run{};
+        run.TotalMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        const auto events = Babylon::StartupProfiler::GetEvents();
+        for (size_t index = firstEvent; index < events.size(); ++index)
+        {
+            if (events[index].Category == "eval")
+            {
+                run.EvalMilliseconds += std::chrono::duration<double, std::milli>(events[index].End - events[index].Start).count();
+            }
+        }
+
+        return run;
+    }
+
+    size_t CountCodeCacheFiles(const std::filesystem::path& codeCacheDirectory)
+    {
+        size_t count{0};
+        for (const auto& entry : std::filesystem::directory_iterator{codeCacheDirectory})
+        {
+            if (entry.path().extension() == ".jscache")
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    bool WaitForCodeCache(const std::filesystem::path& codeCacheDirectory, size_t expectedCount)
+    {
+        const auto deadline = Clock::now() + CODE_CACHE_TIMEOUT;
+        while (CountCodeCacheFiles(codeCacheDirectory) < expectedCount)
+        {
+            if (Clock::now() > deadline)
+            {
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        }
+
+        return true;
+    }
+
+    double Median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    void PrintRuns(const char* name, const std::vector<Run>& runs)
+    {
+        std::vector<double> totals{};
+        std::vector<double> evals{};
+        for (const auto& run : runs)
+        {
+            std::printf("%-6s %12.1f %12.1f\n", name, run.TotalMilliseconds, run.EvalMilliseconds);
+            totals.push_back(run.TotalMilliseconds);
+            evals.push_back(run.EvalMilliseconds);
+        }
+
+        std::printf("%-6s %12.1f %12.1f (median)\n", name, Median(totals), Median(evals));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> urls{};
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        urls.push_back(ToFileUrl(argv[arg]));
+    }
+
+    if (urls.empty())
+    {
+        urls = {
+            ToFileUrl("Scripts/babylon.max.js"),
+            ToFileUrl("Scripts/babylonjs.materials.js"),
+            ToFileUrl("Scripts/babylon.glTF2FileLoader.js")};
+    }
+
+    const auto codeCacheDirectory = std::filesystem::temp_directory_path() / "BabylonNativeScriptStartupBenchmark";
+
+    std::printf("%-6s %12s %12s\n", "cache", "total (ms)", "eval (ms)");
+
+    // Each cold run waits for its own cache to be written so that it cannot land in the
+    // directory of the next cold run. Engines without a code cache only time out once.
+    std::vector<Run> coldRuns{};
+    bool producedCodeCache{true};
+    for (size_t run = 0; run < RUN_COUNT; ++run)
+    {
+        std::filesystem::remove_all(codeCacheDirectory);
+        std::filesystem::create_directories(codeCacheDirectory);
+        coldRuns.push_back(LoadScripts(urls, codeCacheDirectory));
+        producedCodeCache = producedCodeCache && WaitForCodeCache(codeCacheDirectory, urls.size());
+    }
+    PrintRuns("cold", coldRuns);
+
+    if (!producedCodeCache)
+    {
+        std::printf("The engine produced no code cache, so warm runs would match cold runs.\n");
+        std::filesystem::remove_all(codeCacheDirectory);
+        return 0;
+    }
+
+    std::vector<Run> warmRuns{};
+    for (size_t run = 0; run < RUN_COUNT; ++run)
+    {
+        warmRuns.push_back(LoadScripts(urls, codeCacheDirectory));
+    }
+    PrintRuns("warm", warmRuns);
+
+    std::filesystem::remove_all(codeCacheDirectory);
+    return 0;
+}
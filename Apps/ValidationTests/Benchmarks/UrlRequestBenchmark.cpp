@@ -0,0 +1,550 @@
+// Measures UrlLib's curl backend, which pools every transfer on one shared curl multi handle,
+// against the per-request easy handles it replaced. A stand-in HTTP/1.1 server on loopback serves
+// distinct files and both clients download all of them at once. With --cache, it instead checks
+// the HTTP cache by counting the requests that reach the server. See Scripts/README.md for how to
+// read the output.
+
+#include <UrlLib/UrlLib.h>
+#include <arcana/threading/task_schedulers.h>
+#include <curl/curl.h>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Answers GET requests on 127.0.0.1 with keep-alive, one thread per connection, and counts
+    // the connections it accepted and the requests it answered.
+    class LocalHttpServer
+    {
+    public:
+        struct Request
+        {
+            std::string Path{};
+
+            // Names are lower case.
+            std::unordered_map<std::string, std::string> Headers{};
+        };
+
+        struct Response
+        {
+            int StatusCode{200};
+
+            // Complete header lines, each ending with \r\n. Content-Length is added.
+            std::string Headers{};
+            std::string Body{};
+        };
+
+        using HandlerT = std::function<Response(const Request&)>;
+
+        LocalHttpServer(HandlerT handler)
+            : m_handler{std::move(handler)}
+        {
+            m_listener = socket(AF_INET, SOCK_STREAM, 0);
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t addressLength{sizeof(address)};
+            if (m_listener == -1 ||
+                bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+                listen(m_listener, SOMAXCONN) != 0 ||
+                getsockname(m_listener, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0)
+            {
+                throw std::runtime_error{"Failed to listen on the loopback interface."};
+            }
+
+            m_port = ntohs(address.sin_port);
+            m_acceptThread = std::thread{[this] { Accept(); }};
+        }
+
+        ~LocalHttpServer()
+        {
+            m_stopping = true;
+
+            // Shutting the sockets down wakes the threads blocked in accept and recv.
+            shutdown(m_listener, SHUT_RDWR);
+            m_acceptThread.join();
+            close(m_listener);
+
+            std::scoped_lock lock{m_mutex};
+            for (const int connection : m_connections)
+            {
+                shutdown(connection, SHUT_RDWR);
+            }
+
+            for (auto& thread : m_connectionThreads)
+            {
+                thread.join();
+            }
+
+            for (const int connection : m_connections)
+            {
+                close(connection);
+            }
+        }
+
+        LocalHttpServer(const LocalHttpServer&) = delete;
+        LocalHttpServer& operator=(const LocalHttpServer&) = delete;
+
+        std::string Url(std::string_view path) const
+        {
+            return "http://127.0.0.1:" + std::to_string(m_port) + std::string{path};
+        }
+
+        size_t Connections() const
+        {
+            std::scoped_lock lock{m_mutex};
+            return m_connections.size();
+        }
+
+        size_t Requests() const
+        {
+            return m_requests;
+        }
+
+    private:
+        void Accept()
+        {
+            while (!m_stopping)
+            {
+                const int connection = accept(m_listener, nullptr, nullptr);
+                if (connection == -1)
+                {
+                    continue;
+                }
+
+                std::scoped_lock lock{m_mutex};
+                m_connections.push_back(connection);
+                m_connectionThreads.emplace_back([this, connection] { Serve(connection); });
+            }
+        }
+
+        // The destructor closes the connection once this returns.
+        void Serve(int connection)
+        {
+            std::string buffer{};
+            while (true)
+            {
+                size_t headerEnd{};
+                while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+                {
+                    char chunk[16 * 1024];
+                    const auto received = recv(connection, chunk, sizeof(chunk), 0);
+                    if (received <= 0)
+                    {
+                        return;
+                    }
+                    buffer.append(chunk, static_cast<size_t>(received));
+                }
+
+                const auto request = ParseRequest(std::string_view{buffer}.substr(0, headerEnd));
+                buffer.erase(0, headerEnd + 4);
+
+                const auto response = m_handler(request);
+                ++m_requests;
+
+                std::string message{"HTTP/1.1 " + std::to_string(response.StatusCode) + " " + GetReasonPhrase(response.StatusCode) + "\r\n"};
+                message += "Content-Length: " + std::to_string(response.Body.size()) + "\r\n";
+                message += response.Headers;
+                message += "\r\n";
+                message += response.Body;
+                if (!SendAll(connection, message))
+                {
+                    return;
+                }
+
+                const auto connectionHeader = request.Headers.find("connection");
+                if (connectionHeader != request.Headers.end() && connectionHeader->second == "close")
+                {
+                    return;
+                }
+            }
+        }
+
+        static Request ParseRequest(std::string_view header)
+        {
+            Request request{};
+
+            size_t lineEnd = header.find("\r\n");
+            const auto requestLine = header.substr(0, lineEnd);
+            const size_t pathStart = requestLine.find(' ') + 1;
+            request.Path = requestLine.substr(pathStart, requestLine.find(' ', pathStart) - pathStart);
+
+            while (lineEnd != std::string_view::npos)
+            {
+                const size_t lineStart = lineEnd + 2;
+                lineEnd = header.find("\r\n", lineStart);
+                const auto line = header.substr(lineStart, lineEnd == std::string_view::npos ? std::string_view::npos : lineEnd - lineStart);
+
+                const size_t colon = line.find(':');
+                if (colon == std::string_view::npos)
+                {
+                    continue;
+                }
+
+                std::string name{line.substr(0, colon)};
+                std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+                auto value = line.substr(colon + 1);
+                value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+                request.Headers[std::move(name)] = std::string{value};
+            }
+
+            return request;
+        }
+
+        static const char* GetReasonPhrase(int statusCode)
+        {
+            switch (statusCode)
+            {
+                case 200:
+                    return "OK";
+                case 304:
+                    return "Not Modified";
+                case 404:
+                    return "Not Found";
+                default:
+                    return "Unknown";
+            }
+        }
+
+        static bool SendAll(int connection, std::string_view data)
+        {
+            while (!data.empty())
+            {
+                const auto sent = send(connection, data.data(), data.size(), MSG_NOSIGNAL);
+                if (sent <= 0)
+                {
+                    return false;
+                }
+                data.remove_prefix(static_cast<size_t>(sent));
+            }
+            return true;
+        }
+
+        const HandlerT m_handler;
+        int m_listener{-1};
+        uint16_t m_port{};
+        std::atomic<bool> m_stopping{false};
+        std::atomic<size_t> m_requests{};
+
+        mutable std::mutex m_mutex{};
+        std::vector<int> m_connections{};
+        std::vector<std::thread> m_connectionThreads{};
+
+        std::thread m_acceptThread{};
+    };
+
+    constexpr size_t BODY_SIZE{256 * 1024};
+
+    LocalHttpServer::Response ServeFile(const LocalHttpServer::Request&)
+    {
+        return {200, {}, std::string(BODY_SIZE, 'x')};
+    }
+
+    std::string GetFilePath(size_t index)
+    {
+        return "/file/" + std::to_string(index);
+    }
+
+    struct Result
+    {
+        double Milliseconds{};
+        size_t Connections{};
+        size_t Failures{};
+    };
+
+    // The backend before the transfer pool: every request ran curl_easy_perform with an easy
+    // handle of its own on a pool thread, opening a connection per request.
+    Result MeasureEasyHandles(size_t requestCount, size_t threadCount)
+    {
+        LocalHttpServer server{ServeFile};
+
+        std::atomic<size_t> nextRequest{0};
+        std::atomic<size_t> failures{0};
+        const auto start = Clock::now();
+
+        std::vector<std::thread> threads{};
+        for (size_t thread = 0; thread < threadCount; ++thread)
+        {
+            threads.emplace_back([&server, &nextRequest, &failures, requestCount]() {
+                for (size_t index = nextRequest++; index < requestCount; index = nextRequest++)
+                {
+                    CURL* easy = curl_easy_init();
+                    const std::string url{server.Url(GetFilePath(index))};
+                    size_t received{0};
+
+                    curl_write_callback write = [](char*, size_t, size_t nitems, void* userData) -> size_t {
+                        *static_cast<size_t*>(userData) += nitems;
+                        return nitems;
+                    };
+
+                    curl_easy_setopt(easy, CURLOPT_URL, url.data());
+                    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+                    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write);
+                    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &received);
+
+                    if (curl_easy_perform(easy) != CURLE_OK || received != BODY_SIZE)
+                    {
+                        ++failures;
+                    }
+
+                    curl_easy_cleanup(easy);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        return {std::chrono::duration<double, std::milli>(Clock::now() - start).count(), server.Connections(), failures};
+    }
+
+    Result MeasureCurlMulti(size_t requestCount)
+    {
+        LocalHttpServer server{ServeFile};
+
+        std::atomic<size_t> completed{0};
+        std::atomic<size_t> failures{0};
+        std::promise<void> done{};
+        const auto start = Clock::now();
+
+        for (size_t index = 0; index < requestCount; ++index)
+        {
+            UrlLib::UrlRequest request{};
+            request.Open(UrlLib::UrlMethod::Get, server.Url(GetFilePath(index)));
+            request.ResponseType(UrlLib::UrlResponseType::Buffer);
+            request.SendAsync().then(arcana::inline_scheduler, arcana::cancellation::none(), [request, &completed, &failures, &done, requestCount](const arcana::expected<void, std::exception_ptr>& result) {
+                if (result.has_error() || static_cast<size_t>(request.ResponseBuffer().size()) != BODY_SIZE)
+                {
+                    ++failures;
+                }
+
+                if (++completed == requestCount)
+                {
+                    done.set_value();
+                }
+            });
+        }
+
+        done.get_future().wait();
+
+        return {std::chrono::duration<double, std::milli>(Clock::now() - start).count(), server.Connections(), failures};
+    }
+
+    void PrintResult(const char* name, size_t requestCount, const Result& result)
+    {
+        std::printf("%-14s %9zu %12zu %9zu %12.1f %12.0f\n",
+            name, requestCount, result.Connections, result.Failures, result.Milliseconds, requestCount / (result.Milliseconds / 1000));
+    }
+
+    bool RunBenchmark(size_t requestCount)
+    {
+        const size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+        std::printf("%-14s %9s %12s %9s %12s %12s\n", "client", "requests", "connections", "failures", "total (ms)", "requests/s");
+
+        const auto easyHandles = MeasureEasyHandles(requestCount, threadCount);
+        PrintResult("easy handles", requestCount, easyHandles);
+
+        const auto statsBefore = UrlLib::UrlRequest::GetStats();
+        const auto curlMulti = MeasureCurlMulti(requestCount);
+        const auto statsAfter = UrlLib::UrlRequest::GetStats();
+        PrintResult("CurlMulti", requestCount, curlMulti);
+
+        const auto startedTransfers = statsAfter.StartedTransfers - statsBefore.StartedTransfers;
+        std::printf("CurlMulti started %llu transfers, waiting %.1f ms on average and at most %.1f ms for a slot.\n",
+            static_cast<unsigned long long>(startedTransfers),
+            startedTransfers == 0 ? 0.0 : (statsAfter.TotalQueueWait - statsBefore.TotalQueueWait).count() / 1000.0 / startedTransfers,
+            statsAfter.MaxQueueWait.count() / 1000.0);
+
+        return easyHandles.Failures == 0 && curlMulti.Failures == 0;
+    }
+
+    // Sends a request and waits for it; empty if it failed.
+    std::optional<std::string> Fetch(const std::string& url)
+    {
+        UrlLib::UrlRequest request{};
+        request.Open(UrlLib::UrlMethod::Get, url);
+
+        std::promise<std::optional<std::string>> response{};
+        request.SendAsync().then(arcana::inline_scheduler, arcana::cancellation::none(), [request, &response](const arcana::expected<void, std::exception_ptr>& result) {
+            if (result.has_error())
+            {
+                response.set_value({});
+                return;
+            }
+
+            const auto body = request.ResponseString();
+            response.set_value(std::string{body.data(), static_cast<size_t>(body.size())});
+        });
+
+        return response.get_future().get();
+    }
+
+    void RemoveDirectory(const std::string& directory)
+    {
+        if (DIR* entries = opendir(directory.c_str()))
+        {
+            while (const dirent* file = readdir(entries))
+            {
+                if (std::strcmp(file->d_name, ".") != 0 && std::strcmp(file->d_name, "..") != 0)
+                {
+                    unlink((directory + "/" + file->d_name).c_str());
+                }
+            }
+            closedir(entries);
+        }
+        rmdir(directory.c_str());
+    }
+
+    struct CacheCase
+    {
+        const char* Path{};
+        const char* Body{};
+
+        // Of the two identical requests each case sends.
+        size_t ExpectedServerRequests{};
+        uint64_t ExpectedCacheHits{};
+        uint64_t ExpectedRevalidations{};
+    };
+
+    // A fresh entry is served without contacting the server, a stale one is revalidated with its
+    // ETag and answered by 304 Not Modified, and a response that varies is never stored.
+    constexpr CacheCase CACHE_CASES[]{
+        {"/fresh", "fresh", 1, 1, 0},
+        {"/revalidated", "revalidated", 2, 0, 1},
+        {"/varied", "varied", 2, 0, 0},
+    };
+
+    LocalHttpServer::Response ServeCacheCase(const LocalHttpServer::Request& request)
+    {
+        if (request.Path == "/fresh")
+        {
+            return {200, "Cache-Control: max-age=3600\r\n", "fresh"};
+        }
+
+        if (request.Path == "/revalidated")
+        {
+            const auto match = request.Headers.find("if-none-match");
+            if (match != request.Headers.end() && match->second == "\"1\"")
+            {
+                return {304, "ETag: \"1\"\r\nCache-Control: no-cache\r\n", {}};
+            }
+
+            return {200, "ETag: \"1\"\r\nCache-Control: no-cache\r\n", "revalidated"};
+        }
+
+        if (request.Path == "/varied")
+        {
+            return {200, "Cache-Control: max-age=3600\r\nVary: Accept-Language\r\n", "varied"};
+        }
+
+        return {404, {}, {}};
+    }
+
+    bool RunCacheTest()
+    {
+        char directoryTemplate[]{"/tmp/UrlRequestBenchmark.XXXXXX"};
+        if (mkdtemp(directoryTemplate) == nullptr)
+        {
+            std::printf("FAILED: could not create a cache directory.\n");
+            return false;
+        }
+
+        const std::string directory{directoryTemplate};
+        UrlLib::UrlRequest::EnableCache(directory, 64 * 1024 * 1024);
+
+        LocalHttpServer server{ServeCacheCase};
+
+        std::printf("%-12s %16s %12s %14s %8s\n", "case", "server requests", "cache hits", "revalidations", "bodies");
+
+        bool passed{true};
+        for (const auto& cacheCase : CACHE_CASES)
+        {
+            const auto requestsBefore = server.Requests();
+            const auto statsBefore = UrlLib::UrlRequest::GetStats();
+
+            size_t matchingBodies{0};
+            for (size_t attempt = 0; attempt < 2; ++attempt)
+            {
+                if (Fetch(server.Url(cacheCase.Path)) == cacheCase.Body)
+                {
+                    ++matchingBodies;
+                }
+            }
+
+            const auto serverRequests = server.Requests() - requestsBefore;
+            const auto statsAfter = UrlLib::UrlRequest::GetStats();
+            const auto cacheHits = statsAfter.CacheHits - statsBefore.CacheHits;
+            const auto revalidations = statsAfter.CacheRevalidations - statsBefore.CacheRevalidations;
+
+            std::printf("%-12s %8zu (of %zu) %5llu (of %llu) %7llu (of %llu) %5zu/2\n",
+                cacheCase.Path,
+                serverRequests, cacheCase.ExpectedServerRequests,
+                static_cast<unsigned long long>(cacheHits), static_cast<unsigned long long>(cacheCase.ExpectedCacheHits),
+                static_cast<unsigned long long>(revalidations), static_cast<unsigned long long>(cacheCase.ExpectedRevalidations),
+                matchingBodies);
+
+            passed = passed &&
+                serverRequests == cacheCase.ExpectedServerRequests &&
+                cacheHits == cacheCase.ExpectedCacheHits &&
+                revalidations == cacheCase.ExpectedRevalidations &&
+                matchingBodies == 2;
+        }
+
+        RemoveDirectory(directory);
+
+        std::printf(passed ? "PASSED: the server saw exactly the requests the cache could not answer.\n" : "FAILED: the cache did not match the expected requests.\n");
+        return passed;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool cache{false};
+    size_t count{0};
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (std::strcmp(argv[arg], "--cache") == 0)
+        {
+            cache = true;
+        }
+        else
+        {
+            count = std::max(1, std::atoi(argv[arg]));
+        }
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    const bool passed = cache ? RunCacheTest() : RunBenchmark(count == 0 ? 200 : count);
+    curl_global_cleanup();
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
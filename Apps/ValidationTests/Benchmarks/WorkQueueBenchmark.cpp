@@ -0,0 +1,433 @@
+// Measures the JavaScript thread's work queue against the arcana continuation chain it replaced.
+// By default producer threads append empty work items as fast as they can while the consumer
+// thread runs them, recording the time from Append to invocation. With --frame-latency, frame
+// callbacks are appended at 60 Hz while other threads keep the queue full of background work, and
+// the run fails if a frame callback waits longer than the queue's budgets allow. With --suspend,
+// it checks that Suspend stops the queue after exactly the work appended before it. See
+// Scripts/README.md for how to read the output.
+
+#include "WorkQueue.h"
+
+#include <arcana/threading/dispatcher.h>
+#include <arcana/threading/task.h>
+
+#include <napi/env.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Priority = Babylon::WorkQueue::Priority;
+
+    // The work queue as it was before the lock-free lanes: every Append takes a mutex and chains
+    // a continuation onto the previous task.
+    class LegacyWorkQueue
+    {
+    public:
+        LegacyWorkQueue(std::function<void()> threadProcedure)
+            : m_thread{std::move(threadProcedure)}
+        {
+        }
+
+        ~LegacyWorkQueue()
+        {
+            m_cancelSource.cancel();
+            m_dispatcher.cancelled();
+
+            m_thread.join();
+        }
+
+        template<typename CallableT>
+        void Append(CallableT callable)
+        {
+            std::scoped_lock lock{m_appendMutex};
+            m_task = m_task.then(m_dispatcher, m_cancelSource, [this, callable = std::move(callable)]() mutable {
+                callable(m_env.value());
+            });
+        }
+
+        void Run(Napi::Env env)
+        {
+            m_env = std::make_optional(env);
+            m_dispatcher.set_affinity(std::this_thread::get_id());
+
+            while (!m_cancelSource.cancelled())
+            {
+                m_dispatcher.blocking_tick(m_cancelSource);
+            }
+
+            m_dispatcher.clear();
+            m_task = arcana::task_from_result<std::exception_ptr>();
+        }
+
+    private:
+        std::optional<Napi::Env> m_env{};
+
+        std::mutex m_appendMutex{};
+
+        arcana::cancellation_source m_cancelSource{};
+        arcana::task<void, std::exception_ptr> m_task = arcana::task_from_result<std::exception_ptr>();
+        arcana::manual_dispatcher<128> m_dispatcher{};
+
+        std::thread m_thread;
+    };
+
+    // Both queues start their consumer thread from the constructor, so the thread waits until
+    // the queue pointer has been assigned before entering Run.
+    template<typename QueueT>
+    class Consumer
+    {
+    public:
+        Consumer()
+        {
+            auto started = m_started.get_future().share();
+            m_queue = std::make_unique<QueueT>([this, started]() {
+                started.wait();
+                m_queue->Run(Napi::Env{nullptr});
+            });
+            m_started.set_value();
+        }
+
+        QueueT& Queue()
+        {
+            return *m_queue;
+        }
+
+    private:
+        std::promise<void> m_started{};
+        std::unique_ptr<QueueT> m_queue{};
+    };
+
+    struct Result
+    {
+        double ItemsPerSecond{};
+        double MedianMicroseconds{};
+        double P99Microseconds{};
+        double MaxMicroseconds{};
+    };
+
+    double ToMicroseconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    template<typename QueueT>
+    Result MeasureThroughput(size_t producerCount, size_t itemsPerProducer)
+    {
+        const size_t total{producerCount * itemsPerProducer};
+
+        // Only the consumer thread touches these until the done promise is fulfilled.
+        std::vector<Clock::duration> latencies{};
+        latencies.reserve(total);
+        std::promise<Clock::time_point> done{};
+        auto doneFuture = done.get_future();
+
+        Consumer<QueueT> consumer{};
+        auto& queue = consumer.Queue();
+
+        std::promise<void> go{};
+        auto goFuture = go.get_future().share();
+
+        std::vector<std::thread> producers{};
+        for (size_t producer = 0; producer < producerCount; ++producer)
+        {
+            producers.emplace_back([&queue, &latencies, &done, goFuture, itemsPerProducer, total]() {
+                goFuture.wait();
+                for (size_t item = 0; item < itemsPerProducer; ++item)
+                {
+                    queue.Append([&latencies, &done, total, enqueued = Clock::now()](Napi::Env) {
+                        const auto now = Clock::now();
+                        latencies.push_back(now - enqueued);
+                        if (latencies.size() == total)
+                        {
+                            done.set_value(now);
+                        }
+                    });
+                }
+            });
+        }
+
+        const auto start = Clock::now();
+        go.set_value();
+        const auto finish = doneFuture.get();
+
+        for (auto& producer : producers)
+        {
+            producer.join();
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+
+        Result result{};
+        result.ItemsPerSecond = total / std::chrono::duration<double>(finish - start).count();
+        result.MedianMicroseconds = ToMicroseconds(latencies[total / 2]);
+        result.P99Microseconds = ToMicroseconds(latencies[total * 99 / 100]);
+        result.MaxMicroseconds = ToMicroseconds(latencies.back());
+        return result;
+    }
+
+    void PrintResult(const char* name, size_t producerCount, const Result& result)
+    {
+        std::printf("%-10s %9zu %14.0f %12.1f %12.1f %12.1f\n",
+            name, producerCount, result.ItemsPerSecond, result.MedianMicroseconds, result.P99Microseconds, result.MaxMicroseconds);
+    }
+
+    void RunThroughputBenchmark(size_t itemsPerProducer)
+    {
+        std::printf("%-10s %9s %14s %12s %12s %12s\n", "queue", "producers", "items/s", "p50 (us)", "p99 (us)", "max (us)");
+
+        for (size_t producerCount : {1, 2, 4, 8, 16})
+        {
+            PrintResult("WorkQueue", producerCount, MeasureThroughput<Babylon::WorkQueue>(producerCount, itemsPerProducer));
+            PrintResult("arcana", producerCount, MeasureThroughput<LegacyWorkQueue>(producerCount, itemsPerProducer));
+        }
+    }
+
+    template<typename CallableT>
+    void Append(Babylon::WorkQueue& queue, CallableT callable, Priority priority)
+    {
+        queue.Append(std::move(callable), priority);
+    }
+
+    // The arcana chain has a single lane, so frame callbacks queue up behind everything else.
+    template<typename CallableT>
+    void Append(LegacyWorkQueue& queue, CallableT callable, Priority)
+    {
+        queue.Append(std::move(callable));
+    }
+
+    void Spin(Clock::duration duration)
+    {
+        const auto end = Clock::now() + duration;
+        while (Clock::now() < end)
+        {
+        }
+    }
+
+    constexpr size_t LOAD_PRODUCER_COUNT{4};
+    constexpr size_t MAX_PENDING_LOAD{1000};
+    constexpr std::chrono::microseconds LOAD_ITEM_DURATION{200};
+    constexpr std::chrono::microseconds FRAME_INTERVAL{16667};
+
+    // A frame callback waits for the item in flight, then for at most a normal and a background
+    // slice, each of which can overrun its budget by one item. The test only requires the callback
+    // to run before the next frame is due, which leaves room for thread scheduling.
+    constexpr auto EXPECTED_FRAME_LATENCY{
+        Babylon::WorkQueue::NORMAL_BUDGET + Babylon::WorkQueue::BACKGROUND_BUDGET + 3 * LOAD_ITEM_DURATION};
+    static_assert(EXPECTED_FRAME_LATENCY < FRAME_INTERVAL);
+
+    template<typename QueueT>
+    std::vector<Clock::duration> MeasureFrameLatency(size_t frameCount)
+    {
+        std::vector<Clock::duration> latencies{};
+        latencies.reserve(frameCount);
+
+        {
+            Consumer<QueueT> consumer{};
+            auto& queue = consumer.Queue();
+
+            // Half of the load goes to the normal lane and half to the background lane. Each
+            // producer keeps the queue topped up rather than growing it without bound.
+            std::atomic<size_t> pending{};
+            std::atomic<bool> stop{false};
+            std::vector<std::thread> producers{};
+            for (size_t producer = 0; producer < LOAD_PRODUCER_COUNT; ++producer)
+            {
+                const auto priority = producer % 2 == 0 ? Priority::Normal : Priority::Background;
+                producers.emplace_back([&queue, &pending, &stop, priority]() {
+                    while (!stop)
+                    {
+                        if (pending < MAX_PENDING_LOAD)
+                        {
+                            ++pending;
+                            Append(queue, [&pending](Napi::Env) {
+                                Spin(LOAD_ITEM_DURATION);
+                                --pending;
+                            }, priority);
+                        }
+                        else
+                        {
+                            std::this_thread::sleep_for(std::chrono::microseconds{100});
+                        }
+                    }
+                });
+            }
+
+            // Let the load reach its steady state before the first frame.
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+
+            auto frameTime = Clock::now();
+            for (size_t frame = 0; frame < frameCount; ++frame)
+            {
+                Append(queue, [&latencies, enqueued = Clock::now()](Napi::Env) {
+                    latencies.push_back(Clock::now() - enqueued);
+                }, Priority::Frame);
+
+                frameTime += FRAME_INTERVAL;
+                std::this_thread::sleep_until(frameTime);
+            }
+
+            // Give the last frame callback time to run before the queue is torn down; callbacks
+            // that never ran are reported as missing.
+            std::this_thread::sleep_for(FRAME_INTERVAL);
+
+            stop = true;
+            for (auto& producer : producers)
+            {
+                producer.join();
+            }
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        return latencies;
+    }
+
+    void PrintFrameLatency(const char* name, size_t frameCount, const std::vector<Clock::duration>& latencies)
+    {
+        if (latencies.empty())
+        {
+            std::printf("%-10s %8zu %12s %12s %12s\n", name, frameCount, "-", "-", "-");
+            return;
+        }
+
+        std::printf("%-10s %8zu %12.2f %12.2f %12.2f\n",
+            name, frameCount - latencies.size(),
+            ToMicroseconds(latencies[latencies.size() / 2]) / 1000,
+            ToMicroseconds(latencies[latencies.size() * 99 / 100]) / 1000,
+            ToMicroseconds(latencies.back()) / 1000);
+    }
+
+    bool RunFrameLatencyTest(size_t frameCount)
+    {
+        std::printf("%-10s %8s %12s %12s %12s\n", "queue", "missing", "p50 (ms)", "p99 (ms)", "max (ms)");
+
+        const auto latencies = MeasureFrameLatency<Babylon::WorkQueue>(frameCount);
+        PrintFrameLatency("WorkQueue", frameCount, latencies);
+        PrintFrameLatency("arcana", frameCount, MeasureFrameLatency<LegacyWorkQueue>(frameCount));
+
+        std::printf("Expected at most %.2f ms from the queue's budgets.\n", ToMicroseconds(EXPECTED_FRAME_LATENCY) / 1000);
+        if (latencies.size() != frameCount || latencies.back() >= FRAME_INTERVAL)
+        {
+            std::printf("FAILED: a frame callback did not run before the next frame was due.\n");
+            return false;
+        }
+
+        std::printf("PASSED: every frame callback ran before the next frame was due.\n");
+        return true;
+    }
+
+    constexpr std::array<Priority, 4> ALL_PRIORITIES{Priority::Input, Priority::Frame, Priority::Normal, Priority::Background};
+    constexpr size_t SUSPEND_ITEMS_PER_LANE{100};
+    constexpr std::chrono::milliseconds SUSPEND_SETTLE_TIME{100};
+
+    size_t AppendCounters(Babylon::WorkQueue& queue, std::atomic<size_t>& counter)
+    {
+        for (const auto priority : ALL_PRIORITIES)
+        {
+            for (size_t item = 0; item < SUSPEND_ITEMS_PER_LANE; ++item)
+            {
+                queue.Append([&counter](Napi::Env) {
+                    ++counter;
+                }, priority);
+            }
+        }
+
+        return ALL_PRIORITIES.size() * SUSPEND_ITEMS_PER_LANE;
+    }
+
+    bool RunSuspendTest()
+    {
+        std::atomic<size_t> before{};
+        std::atomic<size_t> after{};
+        size_t beforeWhileSuspended{};
+        size_t afterWhileSuspended{};
+        size_t afterResumed{};
+        size_t expected{};
+
+        {
+            Consumer<Babylon::WorkQueue> consumer{};
+            auto& queue = consumer.Queue();
+
+            // Hold the JavaScript thread so that all of the work below is queued before any runs.
+            std::promise<void> gate{};
+            queue.Append([gateFuture = gate.get_future().share()](Napi::Env) {
+                gateFuture.wait();
+            });
+
+            expected = AppendCounters(queue, before);
+            queue.Suspend();
+            AppendCounters(queue, after);
+            gate.set_value();
+
+            std::this_thread::sleep_for(SUSPEND_SETTLE_TIME);
+            beforeWhileSuspended = before;
+            afterWhileSuspended = after;
+
+            queue.Resume();
+            std::this_thread::sleep_for(SUSPEND_SETTLE_TIME);
+            afterResumed = after;
+        }
+
+        std::printf("%-22s %8s %8s\n", "", "before", "after");
+        std::printf("%-22s %8zu %8zu\n", "expected suspended", expected, size_t{0});
+        std::printf("%-22s %8zu %8zu\n", "ran while suspended", beforeWhileSuspended, afterWhileSuspended);
+        std::printf("%-22s %8zu %8zu\n", "ran after Resume", before.load(), afterResumed);
+
+        if (beforeWhileSuspended != expected || afterWhileSuspended != 0 || afterResumed != expected)
+        {
+            std::printf("FAILED: Suspend did not stop the queue after exactly the work appended before it.\n");
+            return false;
+        }
+
+        std::printf("PASSED: the queue ran every lane's earlier work, then nothing until Resume.\n");
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool frameLatency{false};
+    bool suspend{false};
+    size_t count{0};
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (std::strcmp(argv[arg], "--frame-latency") == 0)
+        {
+            frameLatency = true;
+        }
+        else if (std::strcmp(argv[arg], "--suspend") == 0)
+        {
+            suspend = true;
+        }
+        else
+        {
+            count = std::max(1, std::atoi(argv[arg]));
+        }
+    }
+
+    if (suspend)
+    {
+        return RunSuspendTest() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (frameLatency)
+    {
+        return RunFrameLatencyTest(count == 0 ? 300 : count) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    RunThroughputBenchmark(count == 0 ? 100000 : count);
+    return EXIT_SUCCESS;
+}
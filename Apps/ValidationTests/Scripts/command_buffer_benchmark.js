@@ -0,0 +1,191 @@
+// Compares draw call throughput of the individual NativeEngine methods, the same methods with
+// uniforms written to the program's shared uniform buffer, and submitCommands. Each frame draws
+// the same 5,000 cubes, switching to the next path every FRAMES_PER_RUN frames, and logs the
+// draw calls per second spent issuing them from script.
+
+var DRAW_COUNT = 5000;
+var FRAMES_PER_RUN = 120;
+
+var engine = new BABYLON.NativeEngine();
+var native = engine._native;
+
+// Must match CommandType in Plugins/NativeEngine/Source/CommandBuffer.h.
+var Command = {
+    SetProgram: 0,
+    SetState: 1,
+    SetBlendMode: 5,
+    SetFloat4: 10,
+    SetMatrix: 11,
+    BindVertexArray: 13,
+    DrawIndexed: 14
+};
+
+var vertexSource = [
+    "precision highp float;",
+    "layout(location = 0) in vec3 position;",
+    "uniform mat4 world;",
+    "void main() {",
+    "    gl_Position = world * vec4(position, 1.0);",
+    "}"
+].join("\n");
+
+var fragmentSource = [
+    "precision highp float;",
+    "uniform vec4 color;",
+    "out vec4 fragColor;",
+    "void main() {",
+    "    fragColor = color;",
+    "}"
+].join("\n");
+
+var program = native.createProgram(vertexSource, fragmentSource);
+var uniforms = native.getUniforms(program, ["world", "color"]);
+var positionLocation = native.getAttributes(program, ["position"])[0];
+
+var s = 0.01;
+var positions = new Float32Array([
+    -s, -s, -s, s, -s, -s, s, s, -s, -s, s, -s,
+    -s, -s, s, s, -s, s, s, s, s, -s, s, s
+]);
+var indices = new Uint16Array([
+    0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6,
+    0, 4, 5, 0, 5, 1, 3, 2, 6, 3, 6, 7,
+    0, 3, 7, 0, 7, 4, 1, 5, 6, 1, 6, 2
+]);
+
+var vertexArray = native.createVertexArray();
+native.recordIndexBuffer(vertexArray, native.createIndexBuffer(indices, false));
+native.recordVertexBuffer(vertexArray, native.createVertexBuffer(new Uint8Array(positions.buffer), false), positionLocation, 0, 12, 3, 5126, false);
+
+var worlds = [];
+var colors = [];
+for (var i = 0; i < DRAW_COUNT; ++i) {
+    var x = (i % 100) / 50 - 1;
+    var y = Math.floor(i / 100) / 25 - 1;
+    worlds.push(new Float32Array([1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, 0.5, 1]));
+    colors.push([i / DRAW_COUNT, 1 - i / DRAW_COUNT, 0.5, 1]);
+}
+
+var uniformBuffer = native.getUniformBuffer(program);
+var uniformOffsets = native.getUniformBufferOffsets(program, ["world", "color"]);
+
+function drawWithUniformBuffer() {
+    for (var i = 0; i < DRAW_COUNT; ++i) {
+        var color = colors[i];
+        native.setProgram(program);
+        native.setState(false, 0, false);
+        native.setBlendMode(0);
+        uniformBuffer.set(worlds[i], uniformOffsets[0]);
+        uniformBuffer.set(color, uniformOffsets[1]);
+        native.bindVertexArray(vertexArray);
+        native.drawIndexed(0, 0, indices.length);
+    }
+}
+
+function drawIndividually() {
+    for (var i = 0; i < DRAW_COUNT; ++i) {
+        var color = colors[i];
+        native.setProgram(program);
+        native.setState(false, 0, false);
+        native.setBlendMode(0);
+        native.setMatrix(uniforms[0], worlds[i]);
+        native.setFloat4(uniforms[1], color[0], color[1], color[2], color[3]);
+        native.bindVertexArray(vertexArray);
+        native.drawIndexed(0, 0, indices.length);
+    }
+}
+
+var programHandle = native.createCommandHandle(program);
+var worldHandle = native.createCommandHandle(uniforms[0]);
+var colorHandle = native.createCommandHandle(uniforms[1]);
+var vertexArrayHandle = native.createCommandHandle(vertexArray);
+
+// Handles to the wrong kind of resource, to deleted resources and deleted handles are rejected.
+function expectRejected(description, words) {
+    try {
+        native.submitCommands(new Uint32Array(words));
+    } catch (e) {
+        return;
+    }
+
+    throw new Error("submitCommands accepted " + description);
+}
+
+var deletedVertexArray = native.createVertexArray();
+var deletedVertexArrayHandle = native.createCommandHandle(deletedVertexArray);
+native.deleteVertexArray(deletedVertexArray);
+expectRejected("a handle to a deleted vertex array", [Command.BindVertexArray, deletedVertexArrayHandle]);
+native.deleteCommandHandle(deletedVertexArrayHandle);
+expectRejected("a deleted handle", [Command.BindVertexArray, deletedVertexArrayHandle]);
+expectRejected("a uniform handle as a vertex array", [Command.BindVertexArray, worldHandle]);
+expectRejected("a truncated command", [Command.SetMatrix, worldHandle, 0]);
+
+// Words per draw: 2 + 4 + 2 + 18 + 6 + 2 + 4.
+var commandBuffer = new ArrayBuffer(DRAW_COUNT * 38 * 4);
+var commandWords = new Uint32Array(commandBuffer);
+var commandFloats = new Float32Array(commandBuffer);
+
+function drawBatched() {
+    var offset = 0;
+    for (var i = 0; i < DRAW_COUNT; ++i) {
+        var world = worlds[i];
+        var color = colors[i];
+
+        commandWords[offset++] = Command.SetProgram;
+        commandWords[offset++] = programHandle;
+
+        commandWords[offset++] = Command.SetState;
+        commandWords[offset++] = 0;
+        commandFloats[offset++] = 0;
+        commandWords[offset++] = 0;
+
+        commandWords[offset++] = Command.SetBlendMode;
+        commandWords[offset++] = 0;
+
+        commandWords[offset++] = Command.SetMatrix;
+        commandWords[offset++] = worldHandle;
+        commandFloats.set(world, offset);
+        offset += 16;
+
+        commandWords[offset++] = Command.SetFloat4;
+        commandWords[offset++] = colorHandle;
+        commandFloats[offset++] = color[0];
+        commandFloats[offset++] = color[1];
+        commandFloats[offset++] = color[2];
+        commandFloats[offset++] = color[3];
+
+        commandWords[offset++] = Command.BindVertexArray;
+        commandWords[offset++] = vertexArrayHandle;
+
+        commandWords[offset++] = Command.DrawIndexed;
+        commandWords[offset++] = 0;
+        commandWords[offset++] = 0;
+        commandWords[offset++] = indices.length;
+    }
+
+    native.submitCommands(commandBuffer, offset * 4);
+}
+
+var paths = [
+    { name: "individual calls", draw: drawIndividually },
+    { name: "uniform buffer", draw: drawWithUniformBuffer },
+    { name: "submitCommands", draw: drawBatched }
+];
+var path = 0;
+var frame = 0;
+var elapsed = 0;
+
+engine.runRenderLoop(function () {
+    var start = Date.now();
+    paths[path].draw();
+    elapsed += Date.now() - start;
+
+    if (++frame === FRAMES_PER_RUN) {
+        var drawsPerSecond = Math.round(DRAW_COUNT * FRAMES_PER_RUN / (Math.max(elapsed, 1) / 1000));
+        console.log(paths[path].name + ": " + drawsPerSecond + " draw calls per second");
+
+        path = (path + 1) % paths.length;
+        frame = 0;
+        elapsed = 0;
+    }
+});
@@ -0,0 +1,116 @@
+// Compares drawing 10,000 cubes with one draw call per cube against a single instanced draw
+// call, switching between the two every FRAMES_PER_RUN frames, and logs the milliseconds per
+// frame spent issuing them from script.
+
+var INSTANCE_COUNT = 10000;
+var FRAMES_PER_RUN = 120;
+
+var engine = new BABYLON.NativeEngine();
+var native = engine._native;
+
+var fragmentSource = [
+    "precision highp float;",
+    "in vec4 vColor;",
+    "out vec4 fragColor;",
+    "void main() {",
+    "    fragColor = vColor;",
+    "}"
+].join("\n");
+
+var instancedProgram = native.createProgram([
+    "precision highp float;",
+    "layout(location = 0) in vec3 position;",
+    "in vec4 world0;",
+    "in vec4 world1;",
+    "in vec4 world2;",
+    "in vec4 world3;",
+    "in vec4 instanceColor;",
+    "out vec4 vColor;",
+    "void main() {",
+    "    mat4 world = mat4(world0, world1, world2, world3);",
+    "    gl_Position = world * vec4(position, 1.0);",
+    "    vColor = instanceColor;",
+    "}"
+].join("\n"), fragmentSource);
+
+var singleProgram = native.createProgram([
+    "precision highp float;",
+    "layout(location = 0) in vec3 position;",
+    "uniform mat4 world;",
+    "uniform vec4 color;",
+    "out vec4 vColor;",
+    "void main() {",
+    "    gl_Position = world * vec4(position, 1.0);",
+    "    vColor = color;",
+    "}"
+].join("\n"), fragmentSource);
+var singleUniforms = native.getUniforms(singleProgram, ["world", "color"]);
+
+var s = 0.005;
+var positions = new Float32Array([
+    -s, -s, -s, s, -s, -s, s, s, -s, -s, s, -s,
+    -s, -s, s, s, -s, s, s, s, s, -s, s, s
+]);
+var indices = new Uint16Array([
+    0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6,
+    0, 4, 5, 0, 5, 1, 3, 2, 6, 3, 6, 7,
+    0, 3, 7, 0, 7, 4, 1, 5, 6, 1, 6, 2
+]);
+
+var vertexArray = native.createVertexArray();
+native.recordIndexBuffer(vertexArray, native.createIndexBuffer(indices, false));
+native.recordVertexBuffer(vertexArray, native.createVertexBuffer(new Uint8Array(positions.buffer), false), 0, 0, 12, 3, 5126, false);
+
+// One row per instance: the four world matrix columns, then the color.
+var ROW_FLOATS = 20;
+var instances = new Float32Array(INSTANCE_COUNT * ROW_FLOATS);
+for (var i = 0; i < INSTANCE_COUNT; ++i) {
+    var x = (i % 100) / 50 - 1;
+    var y = Math.floor(i / 100) / 50 - 1;
+    instances.set([1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, 0.5, 1, i / INSTANCE_COUNT, 1 - i / INSTANCE_COUNT, 0.5, 1], i * ROW_FLOATS);
+}
+
+var instanceBuffer = native.createInstanceBuffer(instances, ROW_FLOATS * 4);
+
+function drawInstanced() {
+    native.setProgram(instancedProgram);
+    native.setState(false, 0, false);
+    native.setBlendMode(0);
+    native.bindVertexArray(vertexArray);
+    native.drawIndexedInstanced(0, 0, indices.length, instanceBuffer, 0, INSTANCE_COUNT);
+}
+
+function drawIndividually() {
+    for (var i = 0; i < INSTANCE_COUNT; ++i) {
+        var row = i * ROW_FLOATS;
+        native.setProgram(singleProgram);
+        native.setState(false, 0, false);
+        native.setBlendMode(0);
+        native.setMatrix(singleUniforms[0], instances.subarray(row, row + 16));
+        native.setFloat4(singleUniforms[1], instances[row + 16], instances[row + 17], instances[row + 18], instances[row + 19]);
+        native.bindVertexArray(vertexArray);
+        native.drawIndexed(0, 0, indices.length);
+    }
+}
+
+var paths = [
+    { name: "one draw per cube", draw: drawIndividually },
+    { name: "drawIndexedInstanced", draw: drawInstanced }
+];
+var path = 0;
+var frame = 0;
+var elapsed = 0;
+
+engine.runRenderLoop(function () {
+    var start = Date.now();
+    paths[path].draw();
+    elapsed += Date.now() - start;
+
+    if (++frame === FRAMES_PER_RUN) {
+        console.log(paths[path].name + ": " + (elapsed / FRAMES_PER_RUN).toFixed(2) + " ms per frame");
+
+        path = (path + 1) % paths.length;
+        frame = 0;
+        elapsed = 0;
+    }
+});
@@ -0,0 +1,84 @@
+// Draws two quads whose positions and colors are interleaved in one vertex buffer, so that both
+// attributes are recorded into the same vertex stream. The left quad records position then color;
+// the right one records them the other way round and starts a few vertices into its buffer. Both
+// should show the same red, green, blue and white corners.
+
+var FRAME_COUNT = 120;
+
+// Floats per vertex: position (3), then color (4).
+var VERTEX_FLOATS = 7;
+var STRIDE = VERTEX_FLOATS * 4;
+var COLOR_OFFSET = 3 * 4;
+
+var engine = new BABYLON.NativeEngine();
+var native = engine._native;
+
+var program = native.createProgram([
+    "precision highp float;",
+    "in vec3 position;",
+    "in vec4 color;",
+    "out vec4 vColor;",
+    "void main() {",
+    "    gl_Position = vec4(position, 1.0);",
+    "    vColor = color;",
+    "}"
+].join("\n"), [
+    "precision highp float;",
+    "in vec4 vColor;",
+    "out vec4 fragColor;",
+    "void main() {",
+    "    fragColor = vColor;",
+    "}"
+].join("\n"));
+
+var locations = native.getAttributes(program, ["position", "color"]);
+var positionLocation = locations[0];
+var colorLocation = locations[1];
+
+var indices = new Uint16Array([0, 1, 2, 0, 2, 3]);
+
+function createVertices(left, skippedVertices) {
+    var right = left + 0.8;
+    var vertices = new Float32Array((skippedVertices + 4) * VERTEX_FLOATS);
+    vertices.set([
+        left, -0.4, 0.5, 1, 0, 0, 1,
+        right, -0.4, 0.5, 0, 1, 0, 1,
+        right, 0.4, 0.5, 0, 0, 1, 1,
+        left, 0.4, 0.5, 1, 1, 1, 1
+    ], skippedVertices * VERTEX_FLOATS);
+    return new Uint8Array(vertices.buffer);
+}
+
+function createQuad(left, skippedVertices, colorFirst) {
+    var vertexArray = native.createVertexArray();
+    var vertexBuffer = native.createVertexBuffer(createVertices(left, skippedVertices), false);
+    var byteOffset = skippedVertices * STRIDE;
+
+    native.recordIndexBuffer(vertexArray, native.createIndexBuffer(indices, false));
+    if (colorFirst) {
+        native.recordVertexBuffer(vertexArray, vertexBuffer, colorLocation, byteOffset + COLOR_OFFSET, STRIDE, 4, 5126, false);
+        native.recordVertexBuffer(vertexArray, vertexBuffer, positionLocation, byteOffset, STRIDE, 3, 5126, false);
+    } else {
+        native.recordVertexBuffer(vertexArray, vertexBuffer, positionLocation, byteOffset, STRIDE, 3, 5126, false);
+        native.recordVertexBuffer(vertexArray, vertexBuffer, colorLocation, byteOffset + COLOR_OFFSET, STRIDE, 4, 5126, false);
+    }
+
+    return vertexArray;
+}
+
+var quads = [createQuad(-0.9, 0, false), createQuad(0.1, 3, true)];
+
+var frame = 0;
+engine.runRenderLoop(function () {
+    quads.forEach(function (vertexArray) {
+        native.setProgram(program);
+        native.setState(false, 0, false);
+        native.setBlendMode(0);
+        native.bindVertexArray(vertexArray);
+        native.drawIndexed(0, 0, indices.length);
+    });
+
+    if (++frame === FRAME_COUNT) {
+        console.log("Drew " + FRAME_COUNT + " frames of two interleaved vertex buffers");
+    }
+});
@@ -0,0 +1,90 @@
+// Compiles PROGRAM_COUNT program variants while the render loop keeps drawing, first with
+// createProgram and then with createProgramAsync, and logs the total compile time and the longest
+// frame for each. Every variant's code is unique so that the shader cache never hits; comments
+// alone would not do, as the cache key ignores them.
+
+var PROGRAM_COUNT = 50;
+var PROGRAMS_PER_FRAME = 5;
+
+var engine = new BABYLON.NativeEngine();
+var native = engine._native;
+
+var runId = Date.now();
+var variant = 0;
+
+function getSources() {
+    var id = (runId % 1000000) * 1000 + variant++;
+    var vertexSource = [
+        "precision highp float;",
+        "layout(location = 0) in vec3 position;",
+        "uniform mat4 world;",
+        "out vec3 vPosition;",
+        "void main() {",
+        "    vPosition = position * (1.0 + 0.0 * " + id + ".0);",
+        "    gl_Position = world * vec4(position, 1.0);",
+        "}"
+    ].join("\n");
+    var fragmentSource = [
+        "precision highp float;",
+        "in vec3 vPosition;",
+        "uniform vec4 color;",
+        "out vec4 fragColor;",
+        "void main() {",
+        "    fragColor = color * vec4(abs(sin(vPosition * (40.0 + 0.0 * " + id + ".0))), 1.0);",
+        "}"
+    ].join("\n");
+    return [vertexSource, fragmentSource];
+}
+
+function compileSync(onDone) {
+    for (var i = 0; i < PROGRAMS_PER_FRAME; ++i) {
+        var sources = getSources();
+        native.createProgram(sources[0], sources[1]);
+        onDone();
+    }
+}
+
+function compileAsync(onDone) {
+    for (var i = 0; i < PROGRAMS_PER_FRAME; ++i) {
+        var sources = getSources();
+        native.createProgramAsync(sources[0], sources[1]).ready.then(onDone, function (error) {
+            console.log("createProgramAsync failed: " + error.message);
+            onDone();
+        });
+    }
+}
+
+var paths = [
+    { name: "createProgram", compile: compileSync },
+    { name: "createProgramAsync", compile: compileAsync }
+];
+var path = 0;
+var requested = 0;
+var compiled = 0;
+var start = Date.now();
+var lastFrame = start;
+var longestFrame = 0;
+
+function onCompiled() {
+    if (++compiled === PROGRAM_COUNT) {
+        console.log(paths[path].name + ": " + PROGRAM_COUNT + " programs in " + (Date.now() - start) + " ms, longest frame " + longestFrame + " ms");
+
+        path = (path + 1) % paths.length;
+        requested = 0;
+        compiled = 0;
+        start = Date.now();
+        lastFrame = start;
+        longestFrame = 0;
+    }
+}
+
+engine.runRenderLoop(function () {
+    var now = Date.now();
+    longestFrame = Math.max(longestFrame, now - lastFrame);
+    lastFrame = now;
+
+    if (requested < PROGRAM_COUNT) {
+        requested += PROGRAMS_PER_FRAME;
+        paths[path].compile(onCompiled);
+    }
+});
@@ -0,0 +1,71 @@
+// Creates SHADER_COUNT distinct programs, each spelled SPELLING_COUNT ways that only differ in
+// comments, whitespace and unused macros, and logs how many bgfx programs and shaders they took.
+
+var SHADER_COUNT = 8;
+var SPELLING_COUNT = 5;
+
+var engine = new BABYLON.NativeEngine();
+var native = engine._native;
+
+var runId = Date.now() % 1000000;
+
+function spell(lines, shader, spelling) {
+    var header = [
+        "precision highp float;",
+        "// shader " + shader + ", spelling " + spelling,
+        "#define UNUSED_" + spelling + " " + spelling
+    ];
+    var indent = new Array(spelling + 1).join("  ");
+    var body = lines.map(function (line) {
+        return indent + line.replace(/ /g, spelling % 2 ? "  " : " ");
+    });
+    var blankLines = new Array(spelling + 1).join("\n");
+    return header.join("\n") + blankLines + "\n" + body.join("\n") + "\n/* end of spelling " + spelling + " */\n";
+}
+
+function getSources(shader, spelling) {
+    var scale = (runId * 100 + shader) + ".0";
+    var vertexLines = [
+        "layout(location = 0) in vec3 position;",
+        "uniform mat4 world;",
+        "out vec3 vPosition;",
+        "void main() {",
+        "vPosition = position * (1.0 + 0.0 * " + scale + ");",
+        "gl_Position = world * vec4(position, 1.0);",
+        "}"
+    ];
+    var fragmentLines = [
+        "in vec3 vPosition;",
+        "uniform vec4 color;",
+        "out vec4 fragColor;",
+        "void main() {",
+        "fragColor = color * vec4(abs(sin(vPosition * (40.0 + 0.0 * " + scale + "))), 1.0);",
+        "}"
+    ];
+    return [spell(vertexLines, shader, spelling), spell(fragmentLines, shader, spelling)];
+}
+
+function createPrograms() {
+    for (var shader = 0; shader < SHADER_COUNT; ++shader) {
+        for (var spelling = 0; spelling < SPELLING_COUNT; ++spelling) {
+            var sources = getSources(shader, spelling);
+            native.createProgram(sources[0], sources[1]);
+        }
+    }
+}
+
+var before = native.getShaderCacheStats();
+var start = Date.now();
+createPrograms();
+var elapsed = Date.now() - start;
+var after = native.getShaderCacheStats();
+
+console.log("Created " + (after.requestedPrograms - before.requestedPrograms) + " programs in " + elapsed + " ms: " +
+    (after.misses - before.misses) + " compiled, " + (after.memoryHits - before.memoryHits) + " memory hits, " +
+    (after.uniquePrograms - before.uniquePrograms) + " new bgfx programs, " +
+    (after.uniqueShaders - before.uniqueShaders) + " new bgfx shaders out of " + (after.requestedShaders - before.requestedShaders) + " requested");
+
+// The same sources again skip the preprocessor as well as the compiler.
+start = Date.now();
+createPrograms();
+console.log("Created them again in " + (Date.now() - start) + " ms");
@@ -0,0 +1,67 @@
+// Uploads a GRID_SIZE x GRID_SIZE grid, two triangles per cell, into static vertex and index
+// buffers and keeps drawing it. The script keeps no reference to the arrays, so once the buffers
+// are uploaded the process memory only holds what NativeEngine kept on the CPU. Sample the
+// resident set size with the platform's tools after the message is logged.
+//
+// Static buffers read their array in place until bgfx uploads them, at the end of the frame that
+// first records them into a vertex array. Script must not write to an array once it has passed it
+// to createIndexBuffer or createVertexBuffer; this one never touches them again.
+
+var GRID_SIZE = 1000;
+var FRAMES_BEFORE_SAMPLE = 60;
+
+var engine = new BABYLON.NativeEngine();
+var native = engine._native;
+
+var program = native.createProgram([
+    "precision highp float;",
+    "layout(location = 0) in vec3 position;",
+    "void main() {",
+    "    gl_Position = vec4(position, 1.0);",
+    "}"
+].join("\n"), [
+    "precision highp float;",
+    "out vec4 fragColor;",
+    "void main() {",
+    "    fragColor = vec4(0.4, 0.8, 0.4, 1.0);",
+    "}"
+].join("\n"));
+
+function createGrid() {
+    var rowVertices = GRID_SIZE + 1;
+    var positions = new Float32Array(rowVertices * rowVertices * 3);
+    for (var y = 0; y < rowVertices; ++y) {
+        for (var x = 0; x < rowVertices; ++x) {
+            positions.set([x / GRID_SIZE * 1.8 - 0.9, y / GRID_SIZE * 1.8 - 0.9, 0.5], (y * rowVertices + x) * 3);
+        }
+    }
+
+    var indices = new Uint32Array(GRID_SIZE * GRID_SIZE * 6);
+    for (var row = 0; row < GRID_SIZE; ++row) {
+        for (var column = 0; column < GRID_SIZE; ++column) {
+            var corner = row * rowVertices + column;
+            indices.set([corner, corner + 1, corner + rowVertices + 1, corner, corner + rowVertices + 1, corner + rowVertices], (row * GRID_SIZE + column) * 6);
+        }
+    }
+
+    // Neither array may be written to from here on.
+    var vertexArray = native.createVertexArray();
+    native.recordIndexBuffer(vertexArray, native.createIndexBuffer(indices, false));
+    native.recordVertexBuffer(vertexArray, native.createVertexBuffer(new Uint8Array(positions.buffer), false), 0, 0, 12, 3, 5126, false);
+    return { vertexArray: vertexArray, indexCount: indices.length };
+}
+
+var grid = createGrid();
+var frame = 0;
+
+engine.runRenderLoop(function () {
+    native.setProgram(program);
+    native.setState(false, 0, false);
+    native.setBlendMode(0);
+    native.bindVertexArray(grid.vertexArray);
+    native.drawIndexed(0, 0, grid.indexCount);
+
+    if (++frame === FRAMES_BEFORE_SAMPLE) {
+        console.log("Uploaded " + (2 * GRID_SIZE * GRID_SIZE) + " triangles; sample the resident set size now");
+    }
+});
@@ -0,0 +1,114 @@
+// Moves PARTICLE_COUNT quads every frame and uploads their vertices and indices either into
+// dynamic buffers or into transient buffers, switching every FRAMES_PER_RUN frames, and logs the
+// milliseconds per frame spent uploading and drawing them.
+
+var PARTICLE_COUNT = 50000;
+var FRAMES_PER_RUN = 120;
+
+// Position and color, interleaved.
+var VERTEX_FLOATS = 7;
+var VERTEX_STRIDE = VERTEX_FLOATS * 4;
+
+var engine = new BABYLON.NativeEngine();
+var native = engine._native;
+
+var program = native.createProgram([
+    "precision highp float;",
+    "in vec3 position;",
+    "in vec4 color;",
+    "out vec4 vColor;",
+    "void main() {",
+    "    gl_Position = vec4(position, 1.0);",
+    "    vColor = color;",
+    "}"
+].join("\n"), [
+    "precision highp float;",
+    "in vec4 vColor;",
+    "out vec4 fragColor;",
+    "void main() {",
+    "    fragColor = vColor;",
+    "}"
+].join("\n"));
+var locations = native.getAttributes(program, ["position", "color"]);
+
+var vertices = new Float32Array(PARTICLE_COUNT * 4 * VERTEX_FLOATS);
+var indices = new Uint32Array(PARTICLE_COUNT * 6);
+for (var i = 0; i < PARTICLE_COUNT; ++i) {
+    indices.set([4 * i, 4 * i + 1, 4 * i + 2, 4 * i, 4 * i + 2, 4 * i + 3], 6 * i);
+}
+
+function updateVertices(time) {
+    var s = 0.004;
+    var corners = [-s, -s, s, -s, s, s, -s, s];
+    for (var i = 0; i < PARTICLE_COUNT; ++i) {
+        var angle = i * 0.618 + time * 0.001;
+        var radius = (i % 1000) / 1000;
+        var x = Math.cos(angle) * radius;
+        var y = Math.sin(angle) * radius;
+        for (var corner = 0; corner < 4; ++corner) {
+            vertices.set([x + corners[2 * corner], y + corners[2 * corner + 1], 0.5, radius, 1 - radius, 0.5, 1], (4 * i + corner) * VERTEX_FLOATS);
+        }
+    }
+}
+
+function createVertexArray(vertexBuffer, indexBuffer) {
+    var vertexArray = native.createVertexArray();
+    native.recordIndexBuffer(vertexArray, indexBuffer);
+    native.recordVertexBuffer(vertexArray, vertexBuffer, locations[0], 0, VERTEX_STRIDE, 3, 5126, false);
+    native.recordVertexBuffer(vertexArray, vertexBuffer, locations[1], 12, VERTEX_STRIDE, 4, 5126, false);
+    return vertexArray;
+}
+
+var dynamicVertexBuffer = native.createVertexBuffer(new Uint8Array(vertices.buffer), true);
+var dynamicIndexBuffer = native.createIndexBuffer(indices, true);
+var dynamicVertexArray = createVertexArray(dynamicVertexBuffer, dynamicIndexBuffer);
+
+var transientVertexBuffer = native.createTransientVertexBuffer(VERTEX_STRIDE);
+var transientIndexBuffer = native.createTransientIndexBuffer(true);
+var transientVertexArray = createVertexArray(transientVertexBuffer, transientIndexBuffer);
+
+function draw(vertexArray) {
+    native.setProgram(program);
+    native.setState(false, 0, false);
+    native.setBlendMode(0);
+    native.bindVertexArray(vertexArray);
+    native.drawIndexed(0, 0, indices.length);
+}
+
+var paths = [
+    {
+        name: "dynamic buffers",
+        upload: function () {
+            native.updateDynamicVertexBuffer(dynamicVertexBuffer, new Uint8Array(vertices.buffer), 0, 0);
+            native.updateDynamicIndexBuffer(dynamicIndexBuffer, indices, 0);
+            draw(dynamicVertexArray);
+        }
+    },
+    {
+        name: "transient buffers",
+        upload: function () {
+            native.updateTransientVertexBuffer(transientVertexBuffer, vertices);
+            native.updateTransientIndexBuffer(transientIndexBuffer, indices);
+            draw(transientVertexArray);
+        }
+    }
+];
+var path = 0;
+var frame = 0;
+var elapsed = 0;
+
+engine.runRenderLoop(function () {
+    updateVertices(Date.now());
+
+    var start = Date.now();
+    paths[path].upload();
+    elapsed += Date.now() - start;
+
+    if (++frame === FRAMES_PER_RUN) {
+        console.log(paths[path].name + ": " + (elapsed / FRAMES_PER_RUN).toFixed(2) + " ms per frame");
+
+        path = (path + 1) % paths.length;
+        frame = 0;
+        elapsed = 0;
+    }
+});
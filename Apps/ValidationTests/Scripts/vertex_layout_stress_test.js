@@ -0,0 +1,89 @@
+// Creates, draws and deletes MESH_COUNT meshes, MESHES_PER_FRAME at a time. Each frame's meshes
+// share a vertex stride, and the strides cycle through STRIDE_COUNT values, more distinct layouts
+// than bgfx has layout handles, so the test only finishes if the handles of deleted meshes are
+// released.
+
+var MESH_COUNT = 50000;
+var MESHES_PER_FRAME = 500;
+var STRIDE_COUNT = 100;
+
+// Vertex buffers reference their bytes until bgfx has created them, so meshes are deleted a
+// couple of frames after they were drawn.
+var FRAMES_BEFORE_DELETE = 2;
+
+var engine = new BABYLON.NativeEngine();
+var native = engine._native;
+
+var program = native.createProgram([
+    "precision highp float;",
+    "layout(location = 0) in vec3 position;",
+    "void main() {",
+    "    gl_Position = vec4(position, 1.0);",
+    "}"
+].join("\n"), [
+    "precision highp float;",
+    "out vec4 fragColor;",
+    "void main() {",
+    "    fragColor = vec4(0.2, 0.6, 1.0, 1.0);",
+    "}"
+].join("\n"));
+
+var indices = new Uint16Array([0, 1, 2]);
+
+function createVertices(stride, x, y) {
+    var s = 0.01;
+    var vertices = new Float32Array(3 * stride / 4);
+    vertices.set([x - s, y - s, 0.5], 0);
+    vertices.set([x + s, y - s, 0.5], stride / 4);
+    vertices.set([x, y + s, 0.5], 2 * stride / 4);
+    return new Uint8Array(vertices.buffer);
+}
+
+function deleteMeshes(meshes) {
+    meshes.forEach(function (mesh) {
+        native.deleteVertexArray(mesh.vertexArray);
+        native.deleteIndexBuffer(mesh.indexBuffer);
+        native.deleteVertexBuffer(mesh.vertexBuffer);
+    });
+}
+
+var created = 0;
+var pending = [];
+var start = Date.now();
+
+engine.runRenderLoop(function () {
+    if (pending.length === FRAMES_BEFORE_DELETE || (created === MESH_COUNT && pending.length > 0)) {
+        deleteMeshes(pending.shift());
+        if (created === MESH_COUNT && pending.length === 0) {
+            console.log("Created and deleted " + MESH_COUNT + " meshes with " + STRIDE_COUNT + " vertex layouts in " + (Date.now() - start) + " ms");
+        }
+    }
+
+    if (created === MESH_COUNT) {
+        return;
+    }
+
+    var meshes = [];
+    for (var i = 0; i < MESHES_PER_FRAME; ++i, ++created) {
+        var stride = 12 + 4 * (Math.floor(created / MESHES_PER_FRAME) % STRIDE_COUNT);
+        var x = (i % 25) / 12.5 - 0.96;
+        var y = Math.floor(i / 25) / 10 - 0.96;
+
+        var mesh = {
+            vertexArray: native.createVertexArray(),
+            indexBuffer: native.createIndexBuffer(indices, false),
+            vertexBuffer: native.createVertexBuffer(createVertices(stride, x, y), false)
+        };
+        native.recordIndexBuffer(mesh.vertexArray, mesh.indexBuffer);
+        native.recordVertexBuffer(mesh.vertexArray, mesh.vertexBuffer, 0, 0, stride, 3, 5126, false);
+        meshes.push(mesh);
+
+        native.setProgram(program);
+        native.setState(false, 0, false);
+        native.setBlendMode(0);
+        native.bindVertexArray(mesh.vertexArray);
+        native.drawIndexed(0, 0, indices.length);
+    }
+
+    pending.push(meshes);
+});
@@ -2,6 +2,7 @@
 
 #include <Babylon/JsRuntime.h>
 
+#include <chrono>
 #include <future>
 #include <memory>
 #include <string>
@@ -19,7 +20,7 @@ namespace Babylon
         void Suspend();
         void Resume();
 
-        void Dispatch(std::function<void(Napi::Env)> callback);
+        void Dispatch(std::function<void(Napi::Env)> callback, JsRuntime::DispatchPriority priority = JsRuntime::DispatchPriority::Normal);
 
     private:
         // These three methods are the mechanism by which platform- and JavaScript-specific
@@ -36,6 +37,8 @@ namespace Babylon
         void RunEnvironmentTier(const char* executablePath = ".");
         void Run(Napi::Env);
 
+        // Declared before m_workQueue so that it is set before the JavaScript thread starts.
+        const std::chrono::steady_clock::time_point m_creationTime{std::chrono::steady_clock::now()};
         std::unique_ptr<WorkQueue> m_workQueue;
     };
 }
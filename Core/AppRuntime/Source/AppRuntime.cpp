@@ -2,13 +2,20 @@
 
 #include "WorkQueue.h"
 
+#include <Babylon/StartupProfiler.h>
+
 namespace Babylon
 {
     AppRuntime::AppRuntime()
         : m_workQueue{std::make_unique<WorkQueue>([this] { RunPlatformTier(); })}
     {
         Dispatch([this](Napi::Env env) {
-            JsRuntime::CreateForJavaScript(env, [this](auto func) { m_workQueue->Append(std::move(func)); });
+            StartupProfiler::Scope scope{"JsRuntime initialization", "AppRuntime"};
+            JsRuntime::CreateForJavaScript(
+                env,
+                [this](std::function<void(Napi::Env)> func, JsRuntime::DispatchPriority priority) { m_workQueue->Append(std::move(func), priority); },
+                [this](std::function<void(Napi::Env)> func, std::chrono::steady_clock::time_point dueTime) { m_workQueue->AppendAt(std::move(func), dueTime); });
+            StartupProfiler::Initialize(env);
         });
     }
 
@@ -18,6 +25,7 @@ namespace Babylon
 
     void AppRuntime::Run(Napi::Env env)
     {
+        StartupProfiler::Record("JavaScript engine initialization", "AppRuntime", m_creationTime, StartupProfiler::Clock::now());
         m_workQueue->Run(env);
     }
 
@@ -31,8 +39,8 @@ namespace Babylon
         m_workQueue->Resume();
     }
 
-    void AppRuntime::Dispatch(std::function<void(Napi::Env)> func)
+    void AppRuntime::Dispatch(std::function<void(Napi::Env)> func, JsRuntime::DispatchPriority priority)
     {
-        m_workQueue->Append(std::move(func));
+        m_workQueue->Append(std::move(func), priority);
     }
 }
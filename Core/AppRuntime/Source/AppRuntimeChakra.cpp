@@ -53,9 +53,11 @@ namespace Babylon
 
         Napi::Env env = Napi::Attach();
         Run(env);
-        Napi::Detach(env);
 
         ThrowIfFailed(JsSetCurrentContext(JS_INVALID_REFERENCE));
         ThrowIfFailed(JsDisposeRuntime(jsRuntime));
+
+        // The env owns the serialized scripts the runtime reads lazily, so it outlives the runtime.
+        Napi::Detach(env);
     }
 }
@@ -1,5 +1,8 @@
 #include "WorkQueue.h"
 
+#include <algorithm>
+#include <utility>
+
 namespace Babylon
 {
     WorkQueue::WorkQueue(std::function<void()> threadProcedure)
@@ -14,19 +17,34 @@ namespace Babylon
             Resume();
         }
 
-        m_cancelSource.cancel();
-        m_dispatcher.cancelled();
+        m_cancelled = true;
+        {
+            std::scoped_lock lock{m_wakeMutex};
+        }
+        m_wakeCondition.notify_one();
 
         m_thread.join();
     }
 
     void WorkQueue::Suspend()
     {
-        auto suspensionMutex = std::make_unique<std::mutex>();
+        auto suspensionMutex = std::make_shared<std::mutex>();
         m_suspensionLock.emplace(*suspensionMutex);
-        Append([suspensionMutex{std::move(suspensionMutex)}](Napi::Env) mutable {
-            std::scoped_lock lock{*suspensionMutex};
-        });
+
+        for (size_t index = 0; index < LANE_COUNT; ++index)
+        {
+            Append([this, index, suspensionMutex](Napi::Env) {
+                m_parkedLanes[index] = true;
+                if (std::all_of(m_parkedLanes.begin(), m_parkedLanes.end(), [](bool parked) { return parked; }))
+                {
+                    {
+                        std::scoped_lock lock{*suspensionMutex};
+                    }
+                    m_parkedLanes.fill(false);
+                }
+            },
+                static_cast<Priority>(index));
+        }
     }
 
     void WorkQueue::Resume()
@@ -37,14 +55,247 @@ namespace Babylon
     void WorkQueue::Run(Napi::Env env)
     {
         m_env = std::make_optional(env);
-        m_dispatcher.set_affinity(std::this_thread::get_id());
 
-        while (!m_cancelSource.cancelled())
+        using clock = std::chrono::steady_clock;
+
+        // A callback's exception ends Run and is rethrown to the platform tier. The remaining
+        // work is freed first, on this thread, while the environment it may reference is alive.
+        try
+        {
+            while (!m_cancelled)
+            {
+                bool ran = RunLane(Priority::Input, clock::time_point::max());
+                ran |= RunTimers();
+                ran |= RunLane(Priority::Frame, clock::time_point::min());
+                ran |= RunLane(Priority::Normal, clock::now() + NORMAL_BUDGET);
+                ran |= RunLane(Priority::Background, clock::now() + BACKGROUND_BUDGET);
+
+                if (!ran)
+                {
+                    Wait();
+                }
+            }
+        }
+        catch (...)
+        {
+            Clear();
+            throw;
+        }
+
+        Clear();
+    }
+
+    void WorkQueue::Lane::Enqueue(Work* work)
+    {
+        work->Next.store(nullptr, std::memory_order_relaxed);
+        Work* previous = m_head.exchange(work);
+        previous->Next.store(work);
+    }
+
+    WorkQueue::Work* WorkQueue::Lane::TryPop()
+    {
+        Work* tail = m_tail;
+        Work* next = tail->Next.load();
+
+        if (tail == &m_stub)
+        {
+            if (next == nullptr)
+            {
+                return nullptr;
+            }
+
+            m_tail = next;
+            tail = next;
+            next = next->Next.load();
+        }
+
+        if (next != nullptr)
+        {
+            m_tail = next;
+            return tail;
+        }
+
+        // Either the lane holds exactly one item, or a producer has swapped m_head but not yet
+        // linked its item. In the latter case the item will be picked up on a later pass.
+        if (tail != m_head.load())
         {
-            m_dispatcher.blocking_tick(m_cancelSource);
+            return nullptr;
         }
 
-        m_dispatcher.clear();
-        m_task = arcana::task_from_result<std::exception_ptr>();
+        Enqueue(&m_stub);
+
+        next = tail->Next.load();
+        if (next != nullptr)
+        {
+            m_tail = next;
+            return tail;
+        }
+
+        return nullptr;
+    }
+
+    bool WorkQueue::Lane::IsEmpty() const
+    {
+        // A producer that has swapped m_head but not yet linked its item counts as non-empty.
+        return m_tail == &m_stub && m_head.load() == &m_stub;
+    }
+
+    void WorkQueue::Push(Work* work, Priority priority)
+    {
+        m_lanes[static_cast<size_t>(priority)].Enqueue(work);
+        Wake();
+    }
+
+    void WorkQueue::PushTimer(Work* work, std::chrono::steady_clock::time_point dueTime)
+    {
+        {
+            std::scoped_lock lock{m_timerMutex};
+            m_timers.push({dueTime, m_timerSequence++, work});
+        }
+
+        // The sleeper may be waiting on a later deadline; waking it makes it re-read the heap.
+        Wake();
+    }
+
+    void WorkQueue::Wake()
+    {
+        // Only pay for the mutex when the JavaScript thread has declared itself asleep. The
+        // lock/unlock pair orders this notification after the sleeper has entered its wait.
+        if (m_sleeping.exchange(false))
+        {
+            {
+                std::scoped_lock lock{m_wakeMutex};
+            }
+            m_wakeCondition.notify_one();
+        }
+    }
+
+    void WorkQueue::Invoke(Work* work)
+    {
+        // The item is freed whether or not its callback throws.
+        std::unique_ptr<Work> owner{work};
+        owner->Invoke(m_env.value());
+    }
+
+    bool WorkQueue::RunLane(Priority priority, std::chrono::steady_clock::time_point deadline)
+    {
+        const auto index = static_cast<size_t>(priority);
+        auto& lane = m_lanes[index];
+
+        bool ran = false;
+        while (!m_cancelled && !m_parkedLanes[index])
+        {
+            if (priority != Priority::Input)
+            {
+                ran |= RunLane(Priority::Input, std::chrono::steady_clock::time_point::max());
+            }
+
+            Work* work = lane.TryPop();
+            if (work == nullptr)
+            {
+                break;
+            }
+
+            Invoke(work);
+            ran = true;
+
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                break;
+            }
+        }
+
+        return ran;
+    }
+
+    bool WorkQueue::RunTimers()
+    {
+        {
+            std::scoped_lock lock{m_timerMutex};
+            const auto now = std::chrono::steady_clock::now();
+            while (!m_timers.empty() && m_timers.top().DueTime <= now)
+            {
+                m_dueTimers.push_back(m_timers.top().Item);
+                m_timers.pop();
+            }
+        }
+
+        if (m_dueTimers.empty())
+        {
+            return false;
+        }
+
+        // Each entry is released before it runs, so that Clear frees only the timers a throwing
+        // callback left behind.
+        for (Work*& work : m_dueTimers)
+        {
+            Invoke(std::exchange(work, nullptr));
+        }
+
+        m_dueTimers.clear();
+        return true;
+    }
+
+    void WorkQueue::Wait()
+    {
+        std::unique_lock lock{m_wakeMutex};
+        m_sleeping = true;
+
+        // Re-check after publishing the sleeping flag so that a producer that finished
+        // enqueuing before seeing the flag cannot be missed. Parked lanes are held until the
+        // remaining lanes reach their suspension markers, so their work does not count.
+        for (size_t index = 0; index < LANE_COUNT; ++index)
+        {
+            if (!m_parkedLanes[index] && !m_lanes[index].IsEmpty())
+            {
+                m_sleeping = false;
+                return;
+            }
+        }
+
+        std::optional<std::chrono::steady_clock::time_point> nextDueTime{};
+        {
+            std::scoped_lock timerLock{m_timerMutex};
+            if (!m_timers.empty())
+            {
+                nextDueTime = m_timers.top().DueTime;
+            }
+        }
+
+        const auto wakePredicate = [this] { return !m_sleeping || m_cancelled; };
+        if (nextDueTime.has_value())
+        {
+            m_wakeCondition.wait_until(lock, nextDueTime.value(), wakePredicate);
+        }
+        else
+        {
+            m_wakeCondition.wait(lock, wakePredicate);
+        }
+
+        m_sleeping = false;
+    }
+
+    void WorkQueue::Clear()
+    {
+        for (auto& lane : m_lanes)
+        {
+            while (Work* work = lane.TryPop())
+            {
+                delete work;
+            }
+        }
+
+        for (Work* work : m_dueTimers)
+        {
+            delete work;
+        }
+        m_dueTimers.clear();
+
+        std::scoped_lock lock{m_timerMutex};
+        while (!m_timers.empty())
+        {
+            delete m_timers.top().Item;
+            m_timers.pop();
+        }
     }
 }
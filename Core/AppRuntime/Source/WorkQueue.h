@@ -1,42 +1,152 @@
 #pragma once
 
-#include <arcana/threading/dispatcher.h>
-#include <arcana/threading/task.h>
+#include <Babylon/JsRuntime.h>
+
 #include <napi/env.h>
 
-#include <future>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
 
 namespace Babylon
 {
     class WorkQueue
     {
     public:
+        using Priority = JsRuntime::DispatchPriority;
+
+        // Each pass of Run drains the input lane, fires due timers, runs at most one frame
+        // callback, then gives the normal and background lanes a time slice each. Input is
+        // re-checked before every item, and a pending frame callback waits at most for the two
+        // slices plus one item.
+        static constexpr std::chrono::milliseconds NORMAL_BUDGET{8};
+        static constexpr std::chrono::milliseconds BACKGROUND_BUDGET{4};
+
         WorkQueue(std::function<void()> threadProcedure);
         ~WorkQueue();
 
+        // Safe to call concurrently from any number of threads. Appending never takes a lock
+        // unless the JavaScript thread is asleep waiting for work, in which case the appending
+        // thread briefly acquires the wake mutex to signal it.
+        template<typename CallableT>
+        void Append(CallableT callable, Priority priority = Priority::Normal)
+        {
+            Push(new CallableWork<CallableT>{std::move(callable)}, priority);
+        }
+
+        // Runs the callable once dueTime has passed. Pending timers bound the JavaScript
+        // thread's sleep, so no polling happens while only timers are outstanding.
         template<typename CallableT>
-        void Append(CallableT callable)
+        void AppendAt(CallableT callable, std::chrono::steady_clock::time_point dueTime)
         {
-            std::scoped_lock lock{m_appendMutex};
-            m_task = m_task.then(m_dispatcher, m_cancelSource, [this, callable = std::move(callable)]() mutable {
-                callable(m_env.value());
-            });
+            PushTimer(new CallableWork<CallableT>{std::move(callable)}, dueTime);
         }
 
+        // Blocks the JavaScript thread once everything appended before the call has run, on
+        // every lane, and holds back everything appended after it until Resume. Each lane stops
+        // at its own marker, so higher priority lanes cannot run ahead past the suspension.
         void Suspend();
         void Resume();
         void Run(Napi::Env);
 
     private:
-        std::optional<Napi::Env> m_env{};
+        struct Work
+        {
+            virtual ~Work() = default;
+            virtual void Invoke(Napi::Env) = 0;
+
+            std::atomic<Work*> Next{};
+        };
 
-        std::mutex m_appendMutex{};
+        template<typename CallableT>
+        struct CallableWork final : public Work
+        {
+            CallableWork(CallableT&& callable)
+                : Callable{std::move(callable)}
+            {
+            }
+
+            void Invoke(Napi::Env env) override
+            {
+                Callable(env);
+            }
+
+            CallableT Callable;
+        };
+
+        struct StubWork final : public Work
+        {
+            void Invoke(Napi::Env) override
+            {
+            }
+        };
+
+        // Intrusive multi-producer single-consumer queue (D. Vyukov). Producers only ever
+        // touch m_head; the JavaScript thread is the sole owner of m_tail.
+        class Lane final
+        {
+        public:
+            void Enqueue(Work* work);
+            Work* TryPop();
+            bool IsEmpty() const;
+
+        private:
+            StubWork m_stub{};
+            std::atomic<Work*> m_head{&m_stub};
+            Work* m_tail{&m_stub};
+        };
+
+        static constexpr size_t LANE_COUNT{static_cast<size_t>(Priority::Background) + 1};
+
+        struct Timer
+        {
+            std::chrono::steady_clock::time_point DueTime{};
+            uint64_t Sequence{};
+            Work* Item{};
+
+            // Orders the priority queue as a min-heap on due time, FIFO for equal times.
+            bool operator<(const Timer& other) const
+            {
+                return DueTime != other.DueTime ? DueTime > other.DueTime : Sequence > other.Sequence;
+            }
+        };
+
+        void Push(Work* work, Priority priority);
+        void PushTimer(Work* work, std::chrono::steady_clock::time_point dueTime);
+        void Wake();
+        void Invoke(Work* work);
+        bool RunTimers();
+        bool RunLane(Priority priority, std::chrono::steady_clock::time_point deadline);
+        void Wait();
+        void Clear();
+
+        std::optional<Napi::Env> m_env{};
 
         std::optional<std::scoped_lock<std::mutex>> m_suspensionLock{};
 
-        arcana::cancellation_source m_cancelSource{};
-        arcana::task<void, std::exception_ptr> m_task = arcana::task_from_result<std::exception_ptr>();
-        arcana::manual_dispatcher<128> m_dispatcher{};
+        std::array<Lane, LANE_COUNT> m_lanes{};
+
+        // Lanes that have reached a suspension marker. Only the JavaScript thread touches these.
+        std::array<bool, LANE_COUNT> m_parkedLanes{};
+
+        std::mutex m_timerMutex{};
+        std::priority_queue<Timer> m_timers{};
+        uint64_t m_timerSequence{};
+        std::vector<Work*> m_dueTimers{};
+
+        std::atomic<bool> m_sleeping{false};
+        std::atomic<bool> m_cancelled{false};
+        std::mutex m_wakeMutex{};
+        std::condition_variable m_wakeCondition{};
 
         std::thread m_thread;
     };
@@ -2,8 +2,8 @@
 
 #include <napi/env.h>
 
+#include <chrono>
 #include <functional>
-#include <mutex>
 
 namespace Babylon
 {
@@ -11,25 +11,47 @@ namespace Babylon
     {
     public:
         static constexpr auto JS_NATIVE_NAME = "_native";
+
+        // Lanes of the JavaScript thread's work queue, highest priority first. Hosts whose
+        // dispatch function has no notion of priority simply ignore it.
+        enum class DispatchPriority
+        {
+            Input,
+            Frame,
+            Normal,
+            Background,
+        };
+
         using DispatchFunctionT = std::function<void(std::function<void(Napi::Env)>)>;
+        using PriorityDispatchFunctionT = std::function<void(std::function<void(Napi::Env)>, DispatchPriority)>;
+        using DelayedDispatchFunctionT = std::function<void(std::function<void(Napi::Env)>, std::chrono::steady_clock::time_point)>;
 
         // Note: It is the contract of JsRuntime that its dispatch function must be usable
         // at the moment of construction. JsRuntime cannot be built with dispatch function
         // that captures a refence to a not-yet-completed object that will be completed
         // later -- an instance of an inheriting type, for example. The dispatch function
         // must be safely callable as soon as it is passed to the JsRuntime constructor.
+        // It must also be safe to call concurrently from multiple threads; JsRuntime does
+        // not serialize calls to it.
         static JsRuntime& CreateForJavaScript(Napi::Env, DispatchFunctionT);
+        static JsRuntime& CreateForJavaScript(Napi::Env, PriorityDispatchFunctionT);
+        static JsRuntime& CreateForJavaScript(Napi::Env, PriorityDispatchFunctionT, DelayedDispatchFunctionT);
         static JsRuntime& GetFromJavaScript(Napi::Env);
-        void Dispatch(std::function<void(Napi::Env)>);
+        void Dispatch(std::function<void(Napi::Env)>, DispatchPriority priority = DispatchPriority::Normal);
+
+        // Runs the function on the JavaScript thread no earlier than dueTime. Hosts that do not
+        // provide a delayed dispatch function get a fallback that re-dispatches at background
+        // priority until the time has passed.
+        void DispatchAt(std::function<void(Napi::Env)>, std::chrono::steady_clock::time_point dueTime);
 
     protected:
         JsRuntime(const JsRuntime&) = delete;
         JsRuntime(JsRuntime&&) = delete;
 
     private:
-        JsRuntime(Napi::Env, DispatchFunctionT);
+        JsRuntime(Napi::Env, PriorityDispatchFunctionT, DelayedDispatchFunctionT);
 
-        DispatchFunctionT m_dispatchFunction{};
-        std::mutex m_mutex{};
+        PriorityDispatchFunctionT m_dispatchFunction{};
+        DelayedDispatchFunctionT m_delayedDispatchFunction{};
     };
 }
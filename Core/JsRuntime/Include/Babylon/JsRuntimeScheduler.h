@@ -11,8 +11,9 @@ namespace Babylon
     class JsRuntimeScheduler
     {
     public:
-        explicit JsRuntimeScheduler(JsRuntime& runtime)
+        explicit JsRuntimeScheduler(JsRuntime& runtime, JsRuntime::DispatchPriority priority = JsRuntime::DispatchPriority::Normal)
             : m_runtime{runtime}
+            , m_priority{priority}
         {
         }
 
@@ -21,10 +22,11 @@ namespace Babylon
         {
             m_runtime.Dispatch([callable{std::forward<CallableT>(callable)}](Napi::Env){
                 callable();
-            });
+            }, m_priority);
         }
 
     private:
         JsRuntime& m_runtime;
+        JsRuntime::DispatchPriority m_priority;
     };
 }
@@ -8,8 +8,9 @@ namespace Babylon
         static constexpr auto JS_WINDOW_NAME = "window";
     }
 
-    JsRuntime::JsRuntime(Napi::Env env, DispatchFunctionT dispatchFunction)
+    JsRuntime::JsRuntime(Napi::Env env, PriorityDispatchFunctionT dispatchFunction, DelayedDispatchFunctionT delayedDispatchFunction)
         : m_dispatchFunction{std::move(dispatchFunction)}
+        , m_delayedDispatchFunction{std::move(delayedDispatchFunction)}
     {
         auto global = env.Global();
 
@@ -27,7 +28,19 @@ namespace Babylon
 
     JsRuntime& JsRuntime::CreateForJavaScript(Napi::Env env, DispatchFunctionT dispatchFunction)
     {
-        auto* runtime = new JsRuntime(env, std::move(dispatchFunction));
+        return CreateForJavaScript(env, [dispatchFunction = std::move(dispatchFunction)](std::function<void(Napi::Env)> function, DispatchPriority) {
+            dispatchFunction(std::move(function));
+        });
+    }
+
+    JsRuntime& JsRuntime::CreateForJavaScript(Napi::Env env, PriorityDispatchFunctionT dispatchFunction)
+    {
+        return CreateForJavaScript(env, std::move(dispatchFunction), {});
+    }
+
+    JsRuntime& JsRuntime::CreateForJavaScript(Napi::Env env, PriorityDispatchFunctionT dispatchFunction, DelayedDispatchFunctionT delayedDispatchFunction)
+    {
+        auto* runtime = new JsRuntime(env, std::move(dispatchFunction), std::move(delayedDispatchFunction));
         return *runtime;
     }
 
@@ -41,9 +54,30 @@ namespace Babylon
                     .Data();
     }
 
-    void JsRuntime::Dispatch(std::function<void(Napi::Env)> function)
+    void JsRuntime::Dispatch(std::function<void(Napi::Env)> function, DispatchPriority priority)
     {
-        std::scoped_lock lock{m_mutex};
-        m_dispatchFunction(std::move(function));
+        m_dispatchFunction(std::move(function), priority);
+    }
+
+    void JsRuntime::DispatchAt(std::function<void(Napi::Env)> function, std::chrono::steady_clock::time_point dueTime)
+    {
+        if (m_delayedDispatchFunction)
+        {
+            m_delayedDispatchFunction(std::move(function), dueTime);
+        }
+        else
+        {
+            m_dispatchFunction([this, function = std::move(function), dueTime](Napi::Env env) mutable {
+                if (std::chrono::steady_clock::now() >= dueTime)
+                {
+                    function(env);
+                }
+                else
+                {
+                    DispatchAt(std::move(function), dueTime);
+                }
+            },
+                DispatchPriority::Background);
+        }
     }
 }
@@ -13,6 +13,17 @@ namespace Babylon
     public:
         using DispatchFunctionT = std::function<void(std::function<void(Napi::Env)>)>;
 
+        struct ScriptStats
+        {
+            std::string Url{};
+            size_t SourceBytes{};
+
+            // Bytes written by the copies made between where the script lived and what the engine
+            // compiled, the engine's own string included at the width it stores it. Zero when a
+            // memory-mapped local file was handed to the engine as an external string.
+            size_t BytesCopied{};
+        };
+
         ScriptLoader(DispatchFunctionT dispatchFunction);
 
         template<typename T>
@@ -23,6 +34,14 @@ namespace Babylon
 
         ~ScriptLoader();
 
+        // Opt-in: scripts loaded or evaluated after this call keep the engine's compiled code in
+        // the given existing directory, keyed by a SHA-256 digest of their source, and reuse it on later runs.
+        void EnableCodeCache(std::string directory);
+
+        // Called on the JavaScript thread after each script loaded or evaluated after this call runs.
+        void SetScriptStatsCallback(std::function<void(const ScriptStats&)> callback);
+
+        // file:// URLs are memory-mapped rather than read through UrlLib.
         void LoadScript(std::string url);
         void Eval(std::string source, std::string url);
 
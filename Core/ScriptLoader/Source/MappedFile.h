@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Babylon
+{
+    // Read-only mapping of an entire local file. Throws if the file cannot be opened or mapped.
+    class MappedFile final
+    {
+    public:
+        MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* Data() const
+        {
+            return m_data;
+        }
+
+        size_t Size() const
+        {
+            return m_size;
+        }
+
+    private:
+        const char* m_data{};
+        size_t m_size{};
+    };
+}
@@ -0,0 +1,57 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace Babylon
+{
+    MappedFile::MappedFile(const std::string& path)
+    {
+        int fd = open(path.data(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            throw std::runtime_error{"Failed to open " + path};
+        }
+
+        struct stat info{};
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            throw std::runtime_error{"Failed to stat " + path};
+        }
+
+        m_size = static_cast<size_t>(info.st_size);
+        if (m_size == 0)
+        {
+            close(fd);
+            m_data = "";
+            return;
+        }
+
+        // The mapping stays valid after the descriptor is closed.
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error{"Failed to map " + path};
+        }
+
+        // Scripts are parsed front to back exactly once.
+        madvise(data, m_size, MADV_SEQUENTIAL);
+
+        m_data = static_cast<const char*>(data);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (m_size != 0)
+        {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#include "MappedFile.h"
+
+#include <Windows.h>
+
+#include <stdexcept>
+#include <vector>
+
+namespace Babylon
+{
+    MappedFile::MappedFile(const std::string& path)
+    {
+        int length = MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()), nullptr, 0);
+        std::vector<wchar_t> widePath(static_cast<size_t>(length) + 1);
+        MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()), widePath.data(), length);
+
+        HANDLE file = CreateFile2(widePath.data(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error{"Failed to open " + path};
+        }
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            throw std::runtime_error{"Failed to get the size of " + path};
+        }
+
+        m_size = static_cast<size_t>(size.QuadPart);
+        if (m_size == 0)
+        {
+            CloseHandle(file);
+            m_data = "";
+            return;
+        }
+
+        // The view keeps the mapping object and the file alive once their handles are closed.
+        HANDLE mapping = CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+        {
+            throw std::runtime_error{"Failed to map " + path};
+        }
+
+        void* data = MapViewOfFileFromApp(mapping, FILE_MAP_READ, 0, 0);
+        CloseHandle(mapping);
+        if (data == nullptr)
+        {
+            throw std::runtime_error{"Failed to map " + path};
+        }
+
+        m_data = static_cast<const char*>(data);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (m_size != 0)
+        {
+            UnmapViewOfFile(m_data);
+        }
+    }
+}
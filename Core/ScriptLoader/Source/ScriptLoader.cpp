@@ -1,9 +1,166 @@
 #include <Babylon/ScriptLoader.h>
+#include <Babylon/StartupProfiler.h>
+#include "MappedFile.h"
+#include "Sha256.h"
 #include <UrlLib/UrlLib.h>
 #include <arcana/threading/task.h>
+#include <arcana/threading/task_schedulers.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <vector>
 
 namespace Babylon
 {
+    namespace
+    {
+        constexpr std::string_view FILE_URL_SCHEME{"file://"};
+
+        std::optional<std::string> GetLocalFilePath(std::string_view url)
+        {
+            if (url.substr(0, FILE_URL_SCHEME.size()) != FILE_URL_SCHEME)
+            {
+                return {};
+            }
+
+            url.remove_prefix(FILE_URL_SCHEME.size());
+
+            // file:///C:/path on Windows; the leading slash is not part of the path.
+            if (url.size() > 2 && url[0] == '/' && url[2] == ':')
+            {
+                url.remove_prefix(1);
+            }
+
+            std::string path{};
+            path.reserve(url.size());
+            for (size_t index = 0; index < url.size(); ++index)
+            {
+                if (url[index] == '%' && index + 2 < url.size() && std::isxdigit(url[index + 1]) && std::isxdigit(url[index + 2]))
+                {
+                    path.push_back(static_cast<char>(std::strtol(std::string{url.substr(index + 1, 2)}.data(), nullptr, 16)));
+                    index += 2;
+                }
+                else
+                {
+                    path.push_back(url[index]);
+                }
+            }
+
+            return path;
+        }
+
+        bool IsAscii(const char* data, size_t size)
+        {
+            // Branch-free so the compiler can vectorize it; scripts are megabytes long.
+            unsigned char bits{};
+            for (size_t index = 0; index < size; ++index)
+            {
+                bits |= static_cast<unsigned char>(data[index]);
+            }
+            return (bits & 0x80) == 0;
+        }
+
+        size_t GetEngineStringBytes(const char* data, size_t size)
+        {
+            if (IsAscii(data, size))
+            {
+                return size;
+            }
+
+            // Engines keep text beyond ASCII as UTF-16, one unit per UTF-8 lead byte and two for
+            // the four-byte sequences that need a surrogate pair.
+            size_t units{};
+            for (size_t index = 0; index < size; ++index)
+            {
+                const auto byte = static_cast<unsigned char>(data[index]);
+                units += ((byte & 0xC0) != 0x80) + (byte >= 0xF0);
+            }
+            return units * sizeof(char16_t);
+        }
+
+        struct CodeCacheEntry
+        {
+            std::string Path{};
+            std::vector<uint8_t> Data{};
+        };
+
+        CodeCacheEntry ReadCodeCache(const std::string& directory, std::string_view source)
+        {
+            // Engines only check a cheap hash and the length of the source against the cache they
+            // are given (V8 included), so the entry must be keyed by a digest of the whole source;
+            // a weaker key would let one script run another's compiled code.
+            static constexpr char HEX_DIGITS[]{"0123456789abcdef"};
+            std::string fileName{};
+            for (const auto byte : Sha256(source))
+            {
+                fileName.push_back(HEX_DIGITS[byte >> 4]);
+                fileName.push_back(HEX_DIGITS[byte & 0xF]);
+            }
+            fileName += ".jscache";
+
+            CodeCacheEntry entry{directory + "/" + fileName};
+
+            std::ifstream file{entry.Path, std::ios::binary};
+            if (file)
+            {
+                entry.Data.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+            }
+
+            return entry;
+        }
+
+        void WriteCodeCache(const std::string& path, const std::vector<uint8_t>& data)
+        {
+            // Write to a temporary file first so a concurrent or interrupted run never sees a torn entry.
+            const std::string temporaryPath{path + ".tmp"};
+            {
+                std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+                if (!file.write(reinterpret_cast<const char*>(data.data()), data.size()))
+                {
+                    return;
+                }
+            }
+
+            std::remove(path.data());
+            std::rename(temporaryPath.data(), path.data());
+        }
+
+        // Returns the number of bytes the engine binding copied out of the source string to evaluate it.
+        size_t EvalWithCodeCache(Napi::Env env, Napi::String source, size_t sourceBytes, const char* url, std::optional<CodeCacheEntry> codeCache)
+        {
+            const auto start = StartupProfiler::Clock::now();
+
+            size_t bytesCopied{};
+            std::vector<uint8_t> producedData{};
+            if (codeCache.has_value())
+            {
+                Napi::Eval(env, source, url, codeCache->Data, producedData, bytesCopied);
+            }
+            else
+            {
+                Napi::Eval(env, source, url, bytesCopied);
+            }
+
+            StartupProfiler::Record(url, "eval", start, StartupProfiler::Clock::now(),
+                {{"bytes", static_cast<int64_t>(sourceBytes)}, {"codeCacheBytes", codeCache.has_value() ? static_cast<int64_t>(codeCache->Data.size()) : 0}});
+
+            if (!producedData.empty())
+            {
+                arcana::make_task(arcana::threadpool_scheduler, arcana::cancellation::none(), [path{std::move(codeCache->Path)}, producedData{std::move(producedData)}]() {
+                    WriteCodeCache(path, producedData);
+                });
+            }
+
+            return bytesCopied;
+        }
+    }
+
     class ScriptLoader::Impl
     {
     public:
@@ -13,15 +170,55 @@ namespace Babylon
         {
         }
 
+        void EnableCodeCache(std::string directory)
+        {
+            m_codeCacheDirectory = std::move(directory);
+        }
+
+        void SetScriptStatsCallback(std::function<void(const ScriptStats&)> callback)
+        {
+            m_scriptStatsCallback = std::move(callback);
+        }
+
         void LoadScript(std::string url)
         {
+            if (auto path = GetLocalFilePath(url))
+            {
+                LoadLocalScript(std::move(path.value()), std::move(url));
+                return;
+            }
+
             UrlLib::UrlRequest request;
             request.Open(UrlLib::UrlMethod::Get, url);
             request.ResponseType(UrlLib::UrlResponseType::String);
-            m_task = arcana::when_all(m_task, request.SendAsync()).then(arcana::inline_scheduler, arcana::cancellation::none(), [dispatchFunction{m_dispatchFunction}, request{std::move(request)}, url{std::move(url)}](auto) {
+            request.Priority(UrlLib::UrlPriority::Script);
+
+            // Fetches overlap each other and earlier evaluations, so they are recorded as async spans.
+            auto sendTask = request.SendAsync().then(arcana::inline_scheduler, arcana::cancellation::none(), [request, url, start{StartupProfiler::Clock::now()}]() {
+                StartupProfiler::Record(url, "fetch", start, StartupProfiler::Clock::now(), {{"bytes", static_cast<int64_t>(request.ResponseString().size())}}, true);
+            });
+
+            m_task = arcana::when_all(m_task, sendTask).then(arcana::inline_scheduler, arcana::cancellation::none(), [dispatchFunction{m_dispatchFunction}, codeCacheDirectory{m_codeCacheDirectory}, scriptStatsCallback{m_scriptStatsCallback}, request{std::move(request)}, url{std::move(url)}](auto) {
+                // Read the cache here rather than on the JavaScript thread.
+                std::optional<CodeCacheEntry> codeCache{};
+                if (codeCacheDirectory.has_value())
+                {
+                    const auto source = request.ResponseString();
+                    codeCache = ReadCodeCache(codeCacheDirectory.value(), {source.data(), static_cast<size_t>(source.size())});
+                }
+
                 arcana::task_completion_source<void, std::exception_ptr> taskCompletionSource{};
-                dispatchFunction([taskCompletionSource, request{std::move(request)}, url{std::move(url)}](Napi::Env env) mutable {
-                    Napi::Eval(env, request.ResponseString().data(), url.data());
+                dispatchFunction([taskCompletionSource, scriptStatsCallback{std::move(scriptStatsCallback)}, request{std::move(request)}, url{std::move(url)}, codeCache{std::move(codeCache)}](Napi::Env env) mutable {
+                    const auto source = request.ResponseString();
+                    const auto sourceBytes = static_cast<size_t>(source.size());
+                    const size_t evalBytesCopied = EvalWithCodeCache(env, Napi::String::New(env, source.data(), sourceBytes), sourceBytes, url.data(), std::move(codeCache));
+
+                    if (scriptStatsCallback)
+                    {
+                        // The response string, the engine's copy of it, then whatever evaluation copied.
+                        scriptStatsCallback({std::move(url), sourceBytes, sourceBytes + GetEngineStringBytes(source.data(), sourceBytes) + evalBytesCopied});
+                    }
+
                     taskCompletionSource.complete();
                 });
                 return taskCompletionSource.as_task();
@@ -30,10 +227,23 @@ namespace Babylon
 
         void Eval(std::string source, std::string url)
         {
-            m_task = m_task.then(arcana::inline_scheduler, arcana::cancellation::none(), [dispatchFunction{m_dispatchFunction}, source{std::move(source)}, url{std::move(url)}](auto) {
+            m_task = m_task.then(arcana::inline_scheduler, arcana::cancellation::none(), [dispatchFunction{m_dispatchFunction}, codeCacheDirectory{m_codeCacheDirectory}, scriptStatsCallback{m_scriptStatsCallback}, source{std::move(source)}, url{std::move(url)}](auto) {
+                std::optional<CodeCacheEntry> codeCache{};
+                if (codeCacheDirectory.has_value())
+                {
+                    codeCache = ReadCodeCache(codeCacheDirectory.value(), source);
+                }
+
                 arcana::task_completion_source<void, std::exception_ptr> taskCompletionSource{};
-                dispatchFunction([taskCompletionSource, source{std::move(source)}, url{std::move(url)}](Napi::Env env) mutable {
-                    Napi::Eval(env, source.data(), url.data());
+                dispatchFunction([taskCompletionSource, scriptStatsCallback{std::move(scriptStatsCallback)}, source{std::move(source)}, url{std::move(url)}, codeCache{std::move(codeCache)}](Napi::Env env) mutable {
+                    const size_t evalBytesCopied = EvalWithCodeCache(env, Napi::String::New(env, source), source.size(), url.data(), std::move(codeCache));
+
+                    if (scriptStatsCallback)
+                    {
+                        // The engine's copy of the source, then whatever evaluation copied.
+                        scriptStatsCallback({std::move(url), source.size(), GetEngineStringBytes(source.data(), source.size()) + evalBytesCopied});
+                    }
+
                     taskCompletionSource.complete();
                 });
                 return taskCompletionSource.as_task();
@@ -41,7 +251,54 @@ namespace Babylon
         }
 
     private:
+        void LoadLocalScript(std::string path, std::string url)
+        {
+            m_task = m_task.then(arcana::threadpool_scheduler, arcana::cancellation::none(), [dispatchFunction{m_dispatchFunction}, codeCacheDirectory{m_codeCacheDirectory}, scriptStatsCallback{m_scriptStatsCallback}, path{std::move(path)}, url{std::move(url)}](auto) {
+                const auto start = StartupProfiler::Clock::now();
+
+                // Shared so that an external string can keep the mapping alive for as long as the
+                // engine references it, which may be past the end of this load.
+                auto file = std::make_shared<const MappedFile>(path);
+                const bool isAscii = IsAscii(file->Data(), file->Size());
+
+                std::optional<CodeCacheEntry> codeCache{};
+                if (codeCacheDirectory.has_value())
+                {
+                    codeCache = ReadCodeCache(codeCacheDirectory.value(), {file->Data(), file->Size()});
+                }
+
+                StartupProfiler::Record(url, "fetch", start, StartupProfiler::Clock::now(), {{"bytes", static_cast<int64_t>(file->Size())}}, true);
+
+                arcana::task_completion_source<void, std::exception_ptr> taskCompletionSource{};
+                dispatchFunction([taskCompletionSource, scriptStatsCallback{std::move(scriptStatsCallback)}, file{std::move(file)}, isAscii, url{std::move(url)}, codeCache{std::move(codeCache)}](Napi::Env env) mutable {
+                    // ASCII is valid as both UTF-8 and latin1, which engines can reference in place.
+                    size_t bytesCopied{};
+                    Napi::String source = isAscii
+                        ? Napi::CreateExternalLatin1String(env, file->Data(), file->Size(), [file]() {}, bytesCopied)
+                        : Napi::String::New(env, file->Data(), file->Size());
+
+                    bytesCopied += EvalWithCodeCache(env, source, file->Size(), url.data(), std::move(codeCache));
+
+                    if (scriptStatsCallback)
+                    {
+                        // Text that could not be referenced in place was copied by the engine.
+                        if (!isAscii)
+                        {
+                            bytesCopied += GetEngineStringBytes(file->Data(), file->Size());
+                        }
+
+                        scriptStatsCallback({std::move(url), file->Size(), bytesCopied});
+                    }
+
+                    taskCompletionSource.complete();
+                });
+                return taskCompletionSource.as_task();
+            });
+        }
+
         DispatchFunctionT m_dispatchFunction{};
+        std::optional<std::string> m_codeCacheDirectory{};
+        std::function<void(const ScriptStats&)> m_scriptStatsCallback{};
         arcana::task<void, std::exception_ptr> m_task{};
     };
 
@@ -54,6 +311,16 @@ namespace Babylon
     {
     }
 
+    void ScriptLoader::EnableCodeCache(std::string directory)
+    {
+        m_impl->EnableCodeCache(std::move(directory));
+    }
+
+    void ScriptLoader::SetScriptStatsCallback(std::function<void(const ScriptStats&)> callback)
+    {
+        m_impl->SetScriptStatsCallback(std::move(callback));
+    }
+
     void ScriptLoader::LoadScript(std::string url)
     {
         m_impl->LoadScript(std::move(url));
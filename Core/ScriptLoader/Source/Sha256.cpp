@@ -0,0 +1,110 @@
+#include "Sha256.h"
+
+#include <cstring>
+
+namespace Babylon
+{
+    namespace
+    {
+        constexpr size_t BLOCK_SIZE{64};
+
+        constexpr std::array<uint32_t, 64> ROUND_CONSTANTS{
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        uint32_t RotateRight(uint32_t value, uint32_t count)
+        {
+            return (value >> count) | (value << (32 - count));
+        }
+
+        void ProcessBlock(std::array<uint32_t, 8>& state, const uint8_t* block)
+        {
+            std::array<uint32_t, 64> schedule;
+            for (size_t index = 0; index < 16; ++index)
+            {
+                schedule[index] = (uint32_t{block[index * 4]} << 24) | (uint32_t{block[index * 4 + 1]} << 16) | (uint32_t{block[index * 4 + 2]} << 8) | uint32_t{block[index * 4 + 3]};
+            }
+            for (size_t index = 16; index < 64; ++index)
+            {
+                const uint32_t s0 = RotateRight(schedule[index - 15], 7) ^ RotateRight(schedule[index - 15], 18) ^ (schedule[index - 15] >> 3);
+                const uint32_t s1 = RotateRight(schedule[index - 2], 17) ^ RotateRight(schedule[index - 2], 19) ^ (schedule[index - 2] >> 10);
+                schedule[index] = schedule[index - 16] + s0 + schedule[index - 7] + s1;
+            }
+
+            auto [a, b, c, d, e, f, g, h] = state;
+            for (size_t index = 0; index < 64; ++index)
+            {
+                const uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+                const uint32_t choice = (e & f) ^ (~e & g);
+                const uint32_t temp1 = h + s1 + choice + ROUND_CONSTANTS[index] + schedule[index];
+                const uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+                const uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+                const uint32_t temp2 = s0 + majority;
+
+                h = g;
+                g = f;
+                f = e;
+                e = d + temp1;
+                d = c;
+                c = b;
+                b = a;
+                a = temp1 + temp2;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+    std::array<uint8_t, 32> Sha256(std::string_view data)
+    {
+        std::array<uint32_t, 8> state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+        const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+        const size_t fullBlocks = data.size() / BLOCK_SIZE;
+        for (size_t index = 0; index < fullBlocks; ++index)
+        {
+            ProcessBlock(state, bytes + index * BLOCK_SIZE);
+        }
+
+        // The remaining bytes, a single set bit, zero padding and the message length in bits fill one or two final blocks.
+        std::array<uint8_t, BLOCK_SIZE * 2> tail{};
+        const size_t remaining = data.size() - fullBlocks * BLOCK_SIZE;
+        std::memcpy(tail.data(), bytes + fullBlocks * BLOCK_SIZE, remaining);
+        tail[remaining] = 0x80;
+
+        const size_t tailSize = remaining + 1 + 8 <= BLOCK_SIZE ? BLOCK_SIZE : BLOCK_SIZE * 2;
+        const uint64_t bitLength = static_cast<uint64_t>(data.size()) * 8;
+        for (size_t index = 0; index < 8; ++index)
+        {
+            tail[tailSize - 1 - index] = static_cast<uint8_t>(bitLength >> (index * 8));
+        }
+
+        for (size_t offset = 0; offset < tailSize; offset += BLOCK_SIZE)
+        {
+            ProcessBlock(state, tail.data() + offset);
+        }
+
+        std::array<uint8_t, 32> digest{};
+        for (size_t index = 0; index < state.size(); ++index)
+        {
+            digest[index * 4] = static_cast<uint8_t>(state[index] >> 24);
+            digest[index * 4 + 1] = static_cast<uint8_t>(state[index] >> 16);
+            digest[index * 4 + 2] = static_cast<uint8_t>(state[index] >> 8);
+            digest[index * 4 + 3] = static_cast<uint8_t>(state[index]);
+        }
+        return digest;
+    }
+}
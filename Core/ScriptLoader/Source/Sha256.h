@@ -0,0 +1,11 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace Babylon
+{
+    // SHA-256 digest of the given bytes (FIPS 180-4).
+    std::array<uint8_t, 32> Sha256(std::string_view data);
+}
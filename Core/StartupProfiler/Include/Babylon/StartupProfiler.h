@@ -0,0 +1,67 @@
+#pragma once
+
+#include <napi/env.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Babylon::StartupProfiler
+{
+    using Clock = std::chrono::steady_clock;
+    using Args = std::vector<std::pair<std::string, int64_t>>;
+
+    struct Event
+    {
+        std::string Name{};
+        std::string Category{};
+        Clock::time_point Start{};
+
+        // Equal to Start for instant events recorded with Mark.
+        Clock::time_point End{};
+
+        // Small sequential id of the recording thread, stable for the life of the process.
+        uint32_t ThreadId{};
+
+        // Async events may overlap others on the same thread, e.g. concurrent script fetches.
+        bool Async{};
+
+        Args Arguments{};
+    };
+
+    // The timeline is process-wide and every function here is safe to call from any thread.
+    // Recording stops silently once MAX_EVENTS is reached so a long session cannot grow it
+    // without bound.
+    constexpr size_t MAX_EVENTS{4096};
+
+    void Record(std::string name, std::string category, Clock::time_point start, Clock::time_point end, Args arguments = {}, bool async = false);
+    void Mark(std::string name, std::string category, Args arguments = {});
+
+    std::vector<Event> GetEvents();
+
+    // Chrome trace event format (JSON object form), loadable in chrome://tracing and Perfetto.
+    // Timestamps are microseconds since the profiler was loaded during static initialization.
+    std::string ToChromeTrace();
+
+    // Exposes the timeline to JavaScript as _native.startupProfiler with mark(name),
+    // getEvents() and toChromeTrace().
+    void Initialize(Napi::Env env);
+
+    // Records a span covering the lifetime of the scope.
+    class Scope final
+    {
+    public:
+        Scope(std::string name, std::string category);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        std::string m_name;
+        std::string m_category;
+        Clock::time_point m_start;
+    };
+}
@@ -0,0 +1,237 @@
+#include "StartupProfiler.h"
+
+#include <Babylon/JsRuntime.h>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+namespace Babylon::StartupProfiler
+{
+    namespace
+    {
+        constexpr auto JS_STARTUP_PROFILER_NAME = "startupProfiler";
+
+        struct Timeline
+        {
+            const Clock::time_point Origin{Clock::now()};
+            std::mutex Mutex{};
+            std::vector<Event> Events{};
+        };
+
+        Timeline& GetTimeline()
+        {
+            static Timeline timeline{};
+            return timeline;
+        }
+
+        // Touch the timeline during static initialization so that timestamps count from process
+        // start rather than from the first recorded event.
+        [[maybe_unused]] const Timeline& s_timeline{GetTimeline()};
+
+        uint32_t GetThreadId()
+        {
+            static std::atomic<uint32_t> nextThreadId{1};
+            thread_local const uint32_t threadId{nextThreadId++};
+            return threadId;
+        }
+
+        void Append(Event event)
+        {
+            auto& timeline = GetTimeline();
+            std::scoped_lock lock{timeline.Mutex};
+            if (timeline.Events.size() < MAX_EVENTS)
+            {
+                timeline.Events.push_back(std::move(event));
+            }
+        }
+
+        double ToMicroseconds(Clock::time_point time)
+        {
+            return std::chrono::duration<double, std::micro>(time - GetTimeline().Origin).count();
+        }
+
+        void AppendJsonString(std::string& json, const std::string& value)
+        {
+            json += '"';
+            for (char c : value)
+            {
+                switch (c)
+                {
+                    case '"':
+                        json += "\\\"";
+                        break;
+                    case '\\':
+                        json += "\\\\";
+                        break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20)
+                        {
+                            char escaped[8];
+                            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                            json += escaped;
+                        }
+                        else
+                        {
+                            json += c;
+                        }
+                        break;
+                }
+            }
+            json += '"';
+        }
+
+        void AppendJsonEvent(std::string& json, const Event& event, const char* phase, double timestamp, size_t asyncId)
+        {
+            char buffer[64];
+
+            json += json.back() == '[' ? "\n" : ",\n";
+            json += "{\"name\":";
+            AppendJsonString(json, event.Name);
+            json += ",\"cat\":";
+            AppendJsonString(json, event.Category);
+            std::snprintf(buffer, sizeof(buffer), ",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u", phase, timestamp, event.ThreadId);
+            json += buffer;
+
+            if (phase[0] == 'X')
+            {
+                std::snprintf(buffer, sizeof(buffer), ",\"dur\":%.3f", ToMicroseconds(event.End) - timestamp);
+                json += buffer;
+            }
+            else if (phase[0] == 'i')
+            {
+                json += ",\"s\":\"p\"";
+            }
+            else
+            {
+                std::snprintf(buffer, sizeof(buffer), ",\"id\":%zu", asyncId);
+                json += buffer;
+            }
+
+            if (!event.Arguments.empty() && phase[0] != 'e')
+            {
+                json += ",\"args\":{";
+                for (size_t index = 0; index < event.Arguments.size(); ++index)
+                {
+                    if (index > 0)
+                    {
+                        json += ',';
+                    }
+                    AppendJsonString(json, event.Arguments[index].first);
+                    std::snprintf(buffer, sizeof(buffer), ":%lld", static_cast<long long>(event.Arguments[index].second));
+                    json += buffer;
+                }
+                json += '}';
+            }
+
+            json += '}';
+        }
+
+        double ToMilliseconds(Clock::time_point time)
+        {
+            return std::chrono::duration<double, std::milli>(time - GetTimeline().Origin).count();
+        }
+    }
+
+    void Record(std::string name, std::string category, Clock::time_point start, Clock::time_point end, Args arguments, bool async)
+    {
+        Append({std::move(name), std::move(category), start, end, GetThreadId(), async, std::move(arguments)});
+    }
+
+    void Mark(std::string name, std::string category, Args arguments)
+    {
+        const auto now = Clock::now();
+        Append({std::move(name), std::move(category), now, now, GetThreadId(), false, std::move(arguments)});
+    }
+
+    std::vector<Event> GetEvents()
+    {
+        auto& timeline = GetTimeline();
+        std::scoped_lock lock{timeline.Mutex};
+        return timeline.Events;
+    }
+
+    std::string ToChromeTrace()
+    {
+        const auto events = GetEvents();
+
+        std::string json{"{\"displayTimeUnit\":\"ms\",\"traceEvents\":["};
+        for (size_t index = 0; index < events.size(); ++index)
+        {
+            const auto& event = events[index];
+            const double start = ToMicroseconds(event.Start);
+
+            if (event.Async)
+            {
+                AppendJsonEvent(json, event, "b", start, index + 1);
+                AppendJsonEvent(json, event, "e", ToMicroseconds(event.End), index + 1);
+            }
+            else if (event.Start == event.End)
+            {
+                AppendJsonEvent(json, event, "i", start, 0);
+            }
+            else
+            {
+                AppendJsonEvent(json, event, "X", start, 0);
+            }
+        }
+        json += "\n]}\n";
+
+        return json;
+    }
+
+    void Initialize(Napi::Env env)
+    {
+        auto startupProfiler = Napi::Object::New(env);
+
+        startupProfiler.Set("mark", Napi::Function::New(env, [](const Napi::CallbackInfo& info) {
+            Mark(info[0].As<Napi::String>().Utf8Value(), "JavaScript");
+        }, "mark"));
+
+        startupProfiler.Set("getEvents", Napi::Function::New(env, [](const Napi::CallbackInfo& info) -> Napi::Value {
+            const auto env = info.Env();
+            const auto events = GetEvents();
+
+            auto jsEvents = Napi::Array::New(env, events.size());
+            for (uint32_t index = 0; index < events.size(); ++index)
+            {
+                const auto& event = events[index];
+
+                auto jsEvent = Napi::Object::New(env);
+                jsEvent.Set("name", Napi::String::New(env, event.Name));
+                jsEvent.Set("category", Napi::String::New(env, event.Category));
+                jsEvent.Set("start", Napi::Value::From(env, ToMilliseconds(event.Start)));
+                jsEvent.Set("end", Napi::Value::From(env, ToMilliseconds(event.End)));
+
+                auto jsArguments = Napi::Object::New(env);
+                for (const auto& [key, value] : event.Arguments)
+                {
+                    jsArguments.Set(key, Napi::Value::From(env, static_cast<double>(value)));
+                }
+                jsEvent.Set("args", jsArguments);
+
+                jsEvents.Set(index, jsEvent);
+            }
+
+            return jsEvents;
+        }, "getEvents"));
+
+        startupProfiler.Set("toChromeTrace", Napi::Function::New(env, [](const Napi::CallbackInfo& info) -> Napi::Value {
+            return Napi::String::New(info.Env(), ToChromeTrace());
+        }, "toChromeTrace"));
+
+        env.Global().Get(JsRuntime::JS_NATIVE_NAME).As<Napi::Object>().Set(JS_STARTUP_PROFILER_NAME, startupProfiler);
+    }
+
+    Scope::Scope(std::string name, std::string category)
+        : m_name{std::move(name)}
+        , m_category{std::move(category)}
+        , m_start{Clock::now()}
+    {
+    }
+
+    Scope::~Scope()
+    {
+        Record(std::move(m_name), std::move(m_category), m_start, Clock::now());
+    }
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <arcana/threading/task.h>
 
@@ -22,9 +25,40 @@ namespace UrlLib
         Buffer,
     };
 
+    // Orders requests waiting for a transfer slot. Requests of equal priority start in the
+    // order they were sent.
+    enum class UrlPriority
+    {
+        Script,
+        Geometry,
+        Normal,
+        Texture,
+        Prefetch,
+    };
+
+    struct UrlRequestStats
+    {
+        // Requests that joined an identical request already in flight instead of transferring.
+        uint64_t CoalescedRequests{};
+
+        // Requests answered from the HTTP cache without a transfer, and stale entries that the
+        // server confirmed with 304 Not Modified.
+        uint64_t CacheHits{};
+        uint64_t CacheRevalidations{};
+
+        // Transfers that have started, and how long they waited for a slot under the
+        // concurrency cap.
+        uint64_t StartedTransfers{};
+        std::chrono::microseconds TotalQueueWait{};
+        std::chrono::microseconds MaxQueueWait{};
+    };
+
     class UrlRequest final
     {
     public:
+        using ProgressCallbackT = std::function<void(size_t bytesLoaded, size_t bytesTotal)>;
+        using DataCallbackT = std::function<void(gsl::span<const std::byte> data)>;
+
         UrlRequest();
 
         UrlRequest(const UrlRequest&);
@@ -33,6 +67,22 @@ namespace UrlLib
 
         ~UrlRequest();
 
+        // Caps how many requests transfer at the same time; the rest wait in the order they
+        // were sent. Only the curl backend pools its own connections, so this is a no-op on
+        // platforms whose networking stack manages concurrency itself.
+        static void SetMaxConcurrentRequests(size_t count);
+
+        // Keeps HTTP(S) GET response bodies in the given directory across sessions, bounded to
+        // maxSizeBytes with least recently used eviction. Entries are reused while Cache-Control
+        // max-age allows and revalidated with If-None-Match/If-Modified-Since after that.
+        // Responses that carry Vary are not cached. Only the curl backend implements this; the
+        // other platforms' networking stacks keep their own HTTP cache.
+        static void EnableCache(std::string directory, size_t maxSizeBytes);
+
+        // Process-wide counters since startup. Only the curl backend coalesces and queues
+        // requests itself; elsewhere all counters stay at zero.
+        static UrlRequestStats GetStats();
+
         void Abort();
 
         void Open(UrlMethod method, std::string url);
@@ -41,6 +91,18 @@ namespace UrlLib
 
         void ResponseType(UrlResponseType value);
 
+        UrlPriority Priority() const;
+
+        void Priority(UrlPriority value);
+
+        // Both callbacks run on a background thread while the response body arrives and must be
+        // set before SendAsync. bytesTotal is 0 when the server did not send a Content-Length.
+        // Backends that cannot stream call each callback once with the whole body just before
+        // SendAsync completes. The response is still accumulated either way.
+        void SetProgressCallback(ProgressCallbackT callback);
+
+        void SetDataCallback(DataCallbackT callback);
+
         arcana::task<void, std::exception_ptr> SendAsync();
 
         UrlStatusCode StatusCode() const;
@@ -14,6 +14,19 @@ namespace UrlLib
             Abort();
         }
 
+        static void SetMaxConcurrentRequests(size_t)
+        {
+        }
+
+        static void EnableCache(std::string, size_t)
+        {
+        }
+
+        static UrlRequestStats GetStats()
+        {
+            return {};
+        }
+
         void Abort()
         {
             m_cancellationSource.cancel();
@@ -35,6 +48,27 @@ namespace UrlLib
             m_responseType = value;
         }
 
+        // The platform's networking stack schedules requests itself.
+        UrlPriority Priority() const
+        {
+            return m_priority;
+        }
+
+        void Priority(UrlPriority value)
+        {
+            m_priority = value;
+        }
+
+        void SetProgressCallback(ProgressCallbackT callback)
+        {
+            m_progressCallback = std::move(callback);
+        }
+
+        void SetDataCallback(DataCallbackT callback)
+        {
+            m_dataCallback = std::move(callback);
+        }
+
         arcana::task<void, std::exception_ptr> SendAsync()
         {
             __block arcana::task_completion_source<void, std::exception_ptr> taskCompletionSource{};
@@ -90,6 +124,7 @@ namespace UrlLib
                     }
                 }
                 
+                ReportResponse();
                 taskCompletionSource.complete();
             }};
 
@@ -120,8 +155,40 @@ namespace UrlLib
         }
 
     private:
+        // This backend only sees the body once it is complete, so it is reported as a single chunk.
+        void ReportResponse()
+        {
+            gsl::span<const std::byte> data{};
+            switch (m_responseType)
+            {
+                case UrlResponseType::String:
+                {
+                    data = {reinterpret_cast<const std::byte*>(m_responseString.data()), static_cast<std::ptrdiff_t>(m_responseString.size())};
+                    break;
+                }
+                case UrlResponseType::Buffer:
+                {
+                    data = ResponseBuffer();
+                    break;
+                }
+            }
+
+            if (m_dataCallback)
+            {
+                m_dataCallback(data);
+            }
+
+            if (m_progressCallback)
+            {
+                m_progressCallback(static_cast<size_t>(data.size()), static_cast<size_t>(data.size()));
+            }
+        }
+
         arcana::cancellation_source m_cancellationSource{};
+        ProgressCallbackT m_progressCallback{};
+        DataCallbackT m_dataCallback{};
         UrlResponseType m_responseType{UrlResponseType::String};
+        UrlPriority m_priority{UrlPriority::Normal};
         UrlMethod m_method{UrlMethod::Get};
         std::string m_url{};
         UrlStatusCode m_statusCode{UrlStatusCode::None};
@@ -13,6 +13,21 @@ namespace UrlLib
 
     UrlRequest::~UrlRequest() = default;
 
+    void UrlRequest::SetMaxConcurrentRequests(size_t count)
+    {
+        Impl::SetMaxConcurrentRequests(count);
+    }
+
+    void UrlRequest::EnableCache(std::string directory, size_t maxSizeBytes)
+    {
+        Impl::EnableCache(std::move(directory), maxSizeBytes);
+    }
+
+    UrlRequestStats UrlRequest::GetStats()
+    {
+        return Impl::GetStats();
+    }
+
     void UrlRequest::Abort()
     {
         m_impl->Abort();
@@ -33,6 +48,26 @@ namespace UrlLib
         m_impl->ResponseType(value);
     }
 
+    UrlPriority UrlRequest::Priority() const
+    {
+        return m_impl->Priority();
+    }
+
+    void UrlRequest::Priority(UrlPriority value)
+    {
+        m_impl->Priority(value);
+    }
+
+    void UrlRequest::SetProgressCallback(ProgressCallbackT callback)
+    {
+        m_impl->SetProgressCallback(std::move(callback));
+    }
+
+    void UrlRequest::SetDataCallback(DataCallbackT callback)
+    {
+        m_impl->SetDataCallback(std::move(callback));
+    }
+
     arcana::task<void, std::exception_ptr> UrlRequest::SendAsync()
     {
         return m_impl->SendAsync();
@@ -0,0 +1,308 @@
+#include "CurlMulti.h"
+
+#include <algorithm>
+
+#if LIBCURL_VERSION_NUM < CURL_MULTI_POLL_VERSION_NUM
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace UrlLib
+{
+    namespace
+    {
+        // Upper bound on how long the transfer thread sleeps when curl has no timeout of its own.
+        constexpr int MAX_POLL_TIMEOUT_MS{1000};
+    }
+
+    CurlMulti& CurlMulti::GetInstance()
+    {
+        static CurlMulti instance{};
+        return instance;
+    }
+
+    CurlMulti::CurlMulti()
+    {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+
+        m_multi = curl_multi_init();
+        curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(m_multi, CURLMOPT_MAXCONNECTS, static_cast<long>(m_maxConcurrency));
+
+#if LIBCURL_VERSION_NUM < CURL_MULTI_POLL_VERSION_NUM
+        // Non-blocking on both ends: a full pipe already guarantees a wake-up, and draining
+        // stops once it is empty.
+        if (pipe(m_wakePipe) == 0)
+        {
+            for (int fd : m_wakePipe)
+            {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+        }
+#endif
+
+        m_thread = std::thread{[this] { Run(); }};
+    }
+
+    CurlMulti::~CurlMulti()
+    {
+        {
+            std::scoped_lock lock{m_mutex};
+            m_shutdown = true;
+        }
+        Wake();
+        m_thread.join();
+
+        // Whatever is left belongs to requests that outlived the process's static destruction;
+        // their easy handles are owned by the requests themselves.
+        for (const auto& [easy, transfer] : m_active)
+        {
+            curl_multi_remove_handle(m_multi, easy);
+        }
+
+        curl_multi_cleanup(m_multi);
+        curl_global_cleanup();
+
+#if LIBCURL_VERSION_NUM < CURL_MULTI_POLL_VERSION_NUM
+        for (int fd : m_wakePipe)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    uint64_t CurlMulti::Add(CURL* easy, UrlPriority priority, CompletionT completion)
+    {
+        uint64_t transferId{};
+        {
+            std::scoped_lock lock{m_mutex};
+            transferId = m_nextTransferId++;
+            m_queued[static_cast<size_t>(priority)].push_back({easy, transferId, std::move(completion), std::chrono::steady_clock::now()});
+        }
+        Wake();
+        return transferId;
+    }
+
+    void CurlMulti::SetPriority(uint64_t transferId, UrlPriority priority)
+    {
+        std::scoped_lock lock{m_mutex};
+        auto& target = m_queued[static_cast<size_t>(priority)];
+        for (auto& queue : m_queued)
+        {
+            auto it = std::find_if(queue.begin(), queue.end(), [transferId](const Transfer& transfer) { return transfer.Id == transferId; });
+            if (it != queue.end())
+            {
+                if (&queue != &target)
+                {
+                    // Keeps FIFO order among the target priority's transfers by queue time.
+                    Transfer transfer{std::move(*it)};
+                    queue.erase(it);
+                    auto position = std::upper_bound(target.begin(), target.end(), transfer.QueueTime, [](const auto& time, const Transfer& other) { return time < other.QueueTime; });
+                    target.insert(position, std::move(transfer));
+                }
+                return;
+            }
+        }
+    }
+
+    void CurlMulti::Cancel(uint64_t transferId)
+    {
+        {
+            std::scoped_lock lock{m_mutex};
+            m_cancelled.push_back(transferId);
+        }
+        Wake();
+    }
+
+    void CurlMulti::SetMaxConcurrency(size_t maxConcurrency)
+    {
+        {
+            std::scoped_lock lock{m_mutex};
+            m_maxConcurrency = std::max<size_t>(maxConcurrency, 1);
+        }
+        Wake();
+    }
+
+    CurlMulti::QueueStats CurlMulti::GetQueueStats() const
+    {
+        std::scoped_lock lock{m_mutex};
+        return m_queueStats;
+    }
+
+    void CurlMulti::Run()
+    {
+        while (true)
+        {
+            {
+                std::scoped_lock lock{m_mutex};
+                if (m_shutdown)
+                {
+                    return;
+                }
+            }
+
+            ProcessCancellations();
+            StartQueuedTransfers();
+
+            int running{};
+            curl_multi_perform(m_multi, &running);
+            if (ProcessCompletions())
+            {
+                // Finished transfers freed slots that queued ones can take right away.
+                continue;
+            }
+
+            // Wakes on socket activity, on curl's own timers, or on Wake from Add,
+            // Cancel and shutdown.
+            long timeout{-1};
+            curl_multi_timeout(m_multi, &timeout);
+            if (timeout < 0 || timeout > MAX_POLL_TIMEOUT_MS)
+            {
+                timeout = MAX_POLL_TIMEOUT_MS;
+            }
+
+            if (timeout > 0)
+            {
+                Poll(static_cast<int>(timeout));
+            }
+        }
+    }
+
+    void CurlMulti::Wake()
+    {
+#if LIBCURL_VERSION_NUM >= CURL_MULTI_POLL_VERSION_NUM
+        curl_multi_wakeup(m_multi);
+#else
+        const char byte{};
+        [[maybe_unused]] auto written = write(m_wakePipe[1], &byte, 1);
+#endif
+    }
+
+    void CurlMulti::Poll(int timeoutMs)
+    {
+#if LIBCURL_VERSION_NUM >= CURL_MULTI_POLL_VERSION_NUM
+        curl_multi_poll(m_multi, nullptr, 0, timeoutMs, nullptr);
+#else
+        // Unlike curl_multi_poll, curl_multi_wait returns at once when it has no descriptors,
+        // which the wake pipe also prevents while no transfer is active.
+        curl_waitfd wakeFd{m_wakePipe[0], CURL_WAIT_POLLIN, 0};
+        curl_multi_wait(m_multi, &wakeFd, 1, timeoutMs, nullptr);
+
+        char buffer[64];
+        while (read(m_wakePipe[0], buffer, sizeof(buffer)) > 0)
+        {
+        }
+#endif
+    }
+
+    void CurlMulti::StartQueuedTransfers()
+    {
+        std::vector<Transfer> starting{};
+        {
+            std::scoped_lock lock{m_mutex};
+            const auto now = std::chrono::steady_clock::now();
+            for (auto& queue : m_queued)
+            {
+                while (!queue.empty() && m_active.size() + starting.size() < m_maxConcurrency)
+                {
+                    const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(now - queue.front().QueueTime);
+                    ++m_queueStats.StartedTransfers;
+                    m_queueStats.TotalQueueWait += wait;
+                    m_queueStats.MaxQueueWait = std::max(m_queueStats.MaxQueueWait, wait);
+
+                    starting.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+            }
+            curl_multi_setopt(m_multi, CURLMOPT_MAXCONNECTS, static_cast<long>(m_maxConcurrency));
+        }
+
+        for (auto& transfer : starting)
+        {
+            if (curl_multi_add_handle(m_multi, transfer.Easy) != CURLM_OK)
+            {
+                transfer.Completion(CURLE_FAILED_INIT);
+                continue;
+            }
+
+            CURL* easy = transfer.Easy;
+            m_active.emplace(easy, std::move(transfer));
+        }
+    }
+
+    void CurlMulti::ProcessCancellations()
+    {
+        std::vector<uint64_t> cancelled{};
+        std::vector<CompletionT> completions{};
+        {
+            std::scoped_lock lock{m_mutex};
+            cancelled.swap(m_cancelled);
+
+            // Transfers that never started only need to leave the queue.
+            for (uint64_t transferId : cancelled)
+            {
+                for (auto& queue : m_queued)
+                {
+                    auto it = std::find_if(queue.begin(), queue.end(), [transferId](const Transfer& transfer) { return transfer.Id == transferId; });
+                    if (it != queue.end())
+                    {
+                        completions.push_back(std::move(it->Completion));
+                        queue.erase(it);
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (uint64_t transferId : cancelled)
+        {
+            auto it = std::find_if(m_active.begin(), m_active.end(), [transferId](const auto& entry) { return entry.second.Id == transferId; });
+            if (it != m_active.end())
+            {
+                curl_multi_remove_handle(m_multi, it->first);
+                completions.push_back(std::move(it->second.Completion));
+                m_active.erase(it);
+            }
+        }
+
+        for (auto& completion : completions)
+        {
+            completion(CURLE_ABORTED_BY_CALLBACK);
+        }
+    }
+
+    bool CurlMulti::ProcessCompletions()
+    {
+        bool completed{false};
+        int remaining{};
+        while (CURLMsg* message = curl_multi_info_read(m_multi, &remaining))
+        {
+            if (message->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+
+            CURL* easy = message->easy_handle;
+            CURLcode result = message->data.result;
+
+            // message is invalidated by removing the handle, so read it first.
+            curl_multi_remove_handle(m_multi, easy);
+
+            auto it = m_active.find(easy);
+            if (it != m_active.end())
+            {
+                auto completion = std::move(it->second.Completion);
+                m_active.erase(it);
+                completion(result);
+            }
+
+            completed = true;
+        }
+
+        return completed;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <UrlLib/UrlLib.h>
+#include <curl/curl.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// libcurl 7.68.0, the first version with curl_multi_poll and curl_multi_wakeup.
+#define CURL_MULTI_POLL_VERSION_NUM 0x074400
+
+namespace UrlLib
+{
+    // One curl multi handle shared by every request in the process, driven by a single thread.
+    // Connections, TLS sessions and HTTP/2 streams are reused across requests, and no thread
+    // pool thread blocks on network I/O.
+    class CurlMulti final
+    {
+    public:
+        using CompletionT = std::function<void(CURLcode)>;
+
+        static constexpr size_t DEFAULT_MAX_CONCURRENCY{16};
+
+        static CurlMulti& GetInstance();
+
+        struct QueueStats
+        {
+            uint64_t StartedTransfers{};
+            std::chrono::microseconds TotalQueueWait{};
+            std::chrono::microseconds MaxQueueWait{};
+        };
+
+        // Takes over driving the easy handle until the completion runs. Transfers beyond the
+        // concurrency limit wait by priority, then in FIFO order. The completion is called on
+        // the transfer thread after the handle has been detached, so it may clean the handle up
+        // or reuse it. The returned id identifies this transfer for Cancel and SetPriority.
+        uint64_t Add(CURL* easy, UrlPriority priority, CompletionT completion);
+
+        // Moves a transfer that is still waiting for a slot to another priority's queue.
+        void SetPriority(uint64_t transferId, UrlPriority priority);
+
+        // The completion of a pending or active transfer is called with CURLE_ABORTED_BY_CALLBACK.
+        // Does nothing if the transfer already completed.
+        void Cancel(uint64_t transferId);
+
+        void SetMaxConcurrency(size_t maxConcurrency);
+
+        QueueStats GetQueueStats() const;
+
+    private:
+        struct Transfer
+        {
+            CURL* Easy{};
+            uint64_t Id{};
+            CompletionT Completion{};
+            std::chrono::steady_clock::time_point QueueTime{};
+        };
+
+        static constexpr size_t PRIORITY_COUNT{static_cast<size_t>(UrlPriority::Prefetch) + 1};
+
+        CurlMulti();
+        ~CurlMulti();
+
+        CurlMulti(const CurlMulti&) = delete;
+        CurlMulti& operator=(const CurlMulti&) = delete;
+
+        void Run();
+        void Wake();
+        void Poll(int timeoutMs);
+        void StartQueuedTransfers();
+        void ProcessCancellations();
+        bool ProcessCompletions();
+
+        CURLM* m_multi{};
+
+#if LIBCURL_VERSION_NUM < CURL_MULTI_POLL_VERSION_NUM
+        // curl_multi_poll and curl_multi_wakeup need libcurl 7.68. Older versions wait with
+        // curl_multi_wait on this pipe as well, and waking writes a byte to it.
+        int m_wakePipe[2]{-1, -1};
+#endif
+
+        mutable std::mutex m_mutex{};
+        std::array<std::deque<Transfer>, PRIORITY_COUNT> m_queued{};
+        std::vector<uint64_t> m_cancelled{};
+        uint64_t m_nextTransferId{1};
+        size_t m_maxConcurrency{DEFAULT_MAX_CONCURRENCY};
+        bool m_shutdown{false};
+        QueueStats m_queueStats{};
+
+        // Only touched on the transfer thread.
+        std::unordered_map<CURL*, Transfer> m_active{};
+
+        std::thread m_thread{};
+    };
+}
@@ -0,0 +1,478 @@
+#include "HttpCache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace UrlLib
+{
+    namespace
+    {
+        constexpr const char* BODY_EXTENSION{".body"};
+        constexpr const char* METADATA_EXTENSION{".meta"};
+
+        std::string GetKey(const std::string& url)
+        {
+            // FNV-1a. The metadata records the full URL, so a collision is only ever a miss.
+            uint64_t hash{14695981039346656037ull};
+            for (char c : url)
+            {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 1099511628211ull;
+            }
+
+            char key[17]{};
+            std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+            return key;
+        }
+
+        std::string GetPath(const std::string& directory, const std::string& key, const char* extension)
+        {
+            return directory + "/" + key + extension;
+        }
+
+        int64_t Now()
+        {
+            return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        struct CachePolicy
+        {
+            bool NoStore{};
+            int64_t MaxAge{};
+        };
+
+        CachePolicy ParseCacheControl(const std::string& cacheControl)
+        {
+            std::string value{cacheControl};
+            std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+            CachePolicy policy{};
+            bool noCache{false};
+            size_t start{0};
+            while (start < value.size())
+            {
+                size_t end = value.find(',', start);
+                if (end == std::string::npos)
+                {
+                    end = value.size();
+                }
+
+                std::string directive{value.substr(start, end - start)};
+                directive.erase(0, directive.find_first_not_of(" \t"));
+                directive.erase(directive.find_last_not_of(" \t") + 1);
+
+                if (directive == "no-store")
+                {
+                    policy.NoStore = true;
+                }
+                else if (directive == "no-cache")
+                {
+                    noCache = true;
+                }
+                else if (directive.compare(0, 8, "max-age=") == 0)
+                {
+                    policy.MaxAge = std::max<int64_t>(std::strtoll(directive.c_str() + 8, nullptr, 10), 0);
+                }
+
+                start = end + 1;
+            }
+
+            // Every directive is parsed so that a no-store anywhere in the header is seen, and
+            // no-cache overrides a max-age in either order.
+            if (noCache)
+            {
+                policy.MaxAge = 0;
+            }
+
+            return policy;
+        }
+
+        // mkdir -p. POSIX calls rather than std::filesystem, which needs stdc++fs on older
+        // toolchains.
+        void CreateDirectories(const std::string& directory)
+        {
+            for (size_t end = directory.find('/', 1); ; end = directory.find('/', end + 1))
+            {
+                const std::string parent{directory.substr(0, end)};
+                if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST)
+                {
+                    return;
+                }
+
+                if (end == std::string::npos)
+                {
+                    return;
+                }
+            }
+        }
+
+        std::optional<std::chrono::system_clock::time_point> GetModificationTime(const std::string& path)
+        {
+            struct stat status{};
+            if (stat(path.c_str(), &status) != 0)
+            {
+                return {};
+            }
+
+            return std::chrono::system_clock::from_time_t(status.st_mtime);
+        }
+
+        // Writes data next to path under a unique temporary name, so that readers never observe a
+        // partial file once it is renamed into place. Returns the temporary path.
+        std::optional<std::string> WriteTemporaryFile(const std::string& path, gsl::span<const std::byte> data)
+        {
+            static std::atomic<uint64_t> s_tempFileCounter{};
+            std::string tempPath{path + "." + std::to_string(s_tempFileCounter++) + ".tmp"};
+
+            {
+                std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+                if (!file)
+                {
+                    return {};
+                }
+
+                file.write(reinterpret_cast<const char*>(data.data()), data.size());
+                if (!file)
+                {
+                    file.close();
+                    std::remove(tempPath.c_str());
+                    return {};
+                }
+            }
+
+            return tempPath;
+        }
+
+        bool WriteFileAtomically(const std::string& path, gsl::span<const std::byte> data)
+        {
+            const auto tempPath = WriteTemporaryFile(path, data);
+            if (!tempPath.has_value())
+            {
+                return false;
+            }
+
+            if (std::rename(tempPath->c_str(), path.c_str()) != 0)
+            {
+                std::remove(tempPath->c_str());
+                return false;
+            }
+
+            return true;
+        }
+    }
+
+    HttpCache::MappedBody::MappedBody(void* data, size_t size)
+        : m_data{data}
+        , m_size{size}
+    {
+    }
+
+    HttpCache::MappedBody::~MappedBody()
+    {
+        if (m_data != nullptr)
+        {
+            munmap(m_data, m_size);
+        }
+    }
+
+    gsl::span<const std::byte> HttpCache::MappedBody::Data() const
+    {
+        return {static_cast<const std::byte*>(m_data), static_cast<std::ptrdiff_t>(m_size)};
+    }
+
+    HttpCache& HttpCache::GetInstance()
+    {
+        static HttpCache instance{};
+        return instance;
+    }
+
+    void HttpCache::Enable(std::string directory, size_t maxSize)
+    {
+        CreateDirectories(directory);
+
+        std::unordered_map<std::string, IndexEntry> index{};
+        size_t totalSize{0};
+        if (DIR* entries = opendir(directory.c_str()))
+        {
+            const size_t extensionLength{std::strlen(METADATA_EXTENSION)};
+            while (const dirent* file = readdir(entries))
+            {
+                const std::string name{file->d_name};
+                if (name.size() <= extensionLength || name.compare(name.size() - extensionLength, extensionLength, METADATA_EXTENSION) != 0)
+                {
+                    continue;
+                }
+
+                const std::string key{name.substr(0, name.size() - extensionLength)};
+                auto metadata = ReadMetadata(directory, key);
+                if (!metadata.has_value())
+                {
+                    continue;
+                }
+
+                // The metadata file's modification time doubles as the entry's last use.
+                auto lastUse = GetModificationTime(GetPath(directory, key, METADATA_EXTENSION));
+                if (!lastUse.has_value())
+                {
+                    continue;
+                }
+
+                index[key] = {metadata->Size, lastUse.value()};
+                totalSize += metadata->Size;
+            }
+            closedir(entries);
+        }
+
+        std::scoped_lock lock{m_mutex};
+        m_directory = std::move(directory);
+        m_maxSize = maxSize;
+        m_index = std::move(index);
+        m_totalSize = totalSize;
+        Evict();
+    }
+
+    bool HttpCache::IsEnabled() const
+    {
+        std::scoped_lock lock{m_mutex};
+        return m_directory.has_value();
+    }
+
+    bool HttpCache::IsCacheable(const std::string& url) const
+    {
+        return (url.rfind("http://", 0) == 0 || url.rfind("https://", 0) == 0) && IsEnabled();
+    }
+
+    std::optional<HttpCache::Entry> HttpCache::Find(const std::string& url)
+    {
+        const std::string key{GetKey(url)};
+
+        std::scoped_lock lock{m_mutex};
+        if (!m_directory.has_value())
+        {
+            return {};
+        }
+
+        auto indexEntry = m_index.find(key);
+        if (indexEntry == m_index.end())
+        {
+            return {};
+        }
+
+        auto metadata = ReadMetadata(m_directory.value(), key);
+        if (!metadata.has_value() || metadata->Url != url)
+        {
+            return {};
+        }
+
+        const int file = open(GetPath(m_directory.value(), key, BODY_EXTENSION).c_str(), O_RDONLY | O_CLOEXEC);
+        if (file == -1)
+        {
+            Remove(key);
+            return {};
+        }
+
+        struct stat status{};
+        void* data{nullptr};
+        bool valid = fstat(file, &status) == 0 && static_cast<size_t>(status.st_size) == metadata->Size;
+        if (valid && metadata->Size > 0)
+        {
+            data = mmap(nullptr, metadata->Size, PROT_READ, MAP_PRIVATE, file, 0);
+            valid = data != MAP_FAILED;
+        }
+        close(file);
+
+        if (!valid)
+        {
+            // An interrupted write or an outside modification; the entry can't be trusted.
+            Remove(key);
+            return {};
+        }
+
+        indexEntry->second.LastUse = std::chrono::system_clock::now();
+        utimensat(AT_FDCWD, GetPath(m_directory.value(), key, METADATA_EXTENSION).c_str(), nullptr, 0);
+
+        return Entry{
+            std::make_shared<const MappedBody>(data, metadata->Size),
+            std::move(metadata->ETag),
+            std::move(metadata->LastModified),
+            Now() < metadata->Expiry,
+        };
+    }
+
+    void HttpCache::Store(const std::string& url, gsl::span<const std::byte> body, const Headers& headers)
+    {
+        const std::string key{GetKey(url)};
+        const CachePolicy policy{ParseCacheControl(headers.CacheControl)};
+        const size_t size{static_cast<size_t>(body.size())};
+        const bool reusable = policy.MaxAge > 0 || !headers.ETag.empty() || !headers.LastModified.empty();
+
+        // Requests carry no headers that a response could vary on, but a response that names any
+        // may still differ between clients, so it is not shared through the cache.
+        const bool varies = !headers.Vary.empty();
+
+        std::string directory{};
+        {
+            std::scoped_lock lock{m_mutex};
+            if (!m_directory.has_value())
+            {
+                return;
+            }
+
+            if (policy.NoStore || varies || !reusable || size > m_maxSize)
+            {
+                Remove(key);
+                return;
+            }
+
+            directory = m_directory.value();
+        }
+
+        // Bodies can be large, so they are written without holding the lock. Both files are
+        // renamed into place under the lock, so that Find never pairs a new body with old
+        // metadata. Concurrent stores of the same URL each commit a complete pair; the last wins.
+        const std::string bodyPath{GetPath(directory, key, BODY_EXTENSION)};
+        const std::string metadataPath{GetPath(directory, key, METADATA_EXTENSION)};
+        const auto bodyTempPath = WriteTemporaryFile(bodyPath, body);
+        std::optional<std::string> metadataTempPath{};
+        if (bodyTempPath.has_value())
+        {
+            const std::string contents{SerializeMetadata({url, headers.ETag, headers.LastModified, Now() + policy.MaxAge, size})};
+            metadataTempPath = WriteTemporaryFile(metadataPath, {reinterpret_cast<const std::byte*>(contents.data()), static_cast<std::ptrdiff_t>(contents.size())});
+        }
+
+        std::scoped_lock lock{m_mutex};
+        const bool written = metadataTempPath.has_value() &&
+            m_directory == directory &&
+            std::rename(bodyTempPath->c_str(), bodyPath.c_str()) == 0 &&
+            std::rename(metadataTempPath->c_str(), metadataPath.c_str()) == 0;
+
+        if (!written)
+        {
+            for (const auto& tempPath : {bodyTempPath, metadataTempPath})
+            {
+                if (tempPath.has_value())
+                {
+                    std::remove(tempPath->c_str());
+                }
+            }
+
+            if (m_directory == directory)
+            {
+                Remove(key);
+            }
+            return;
+        }
+
+        auto& indexEntry = m_index[key];
+        m_totalSize = m_totalSize - indexEntry.Size + size;
+        indexEntry = {size, std::chrono::system_clock::now()};
+        Evict();
+    }
+
+    void HttpCache::Refresh(const std::string& url, const Headers& headers)
+    {
+        const std::string key{GetKey(url)};
+        const CachePolicy policy{ParseCacheControl(headers.CacheControl)};
+
+        std::scoped_lock lock{m_mutex};
+        if (!m_directory.has_value())
+        {
+            return;
+        }
+
+        auto metadata = ReadMetadata(m_directory.value(), key);
+        if (!metadata.has_value() || metadata->Url != url)
+        {
+            return;
+        }
+
+        if (policy.NoStore || !headers.Vary.empty())
+        {
+            Remove(key);
+            return;
+        }
+
+        // A 304 may carry updated validators; the ones it omits stay as they were.
+        if (!headers.ETag.empty())
+        {
+            metadata->ETag = headers.ETag;
+        }
+        if (!headers.LastModified.empty())
+        {
+            metadata->LastModified = headers.LastModified;
+        }
+        metadata->Expiry = Now() + policy.MaxAge;
+
+        WriteMetadata(m_directory.value(), key, metadata.value());
+
+        auto indexEntry = m_index.find(key);
+        if (indexEntry != m_index.end())
+        {
+            indexEntry->second.LastUse = std::chrono::system_clock::now();
+        }
+    }
+
+    std::optional<HttpCache::Metadata> HttpCache::ReadMetadata(const std::string& directory, const std::string& key)
+    {
+        std::ifstream file{GetPath(directory, key, METADATA_EXTENSION)};
+
+        Metadata metadata{};
+        if (!std::getline(file, metadata.Url) || !std::getline(file, metadata.ETag) || !std::getline(file, metadata.LastModified) || !(file >> metadata.Expiry >> metadata.Size))
+        {
+            return {};
+        }
+
+        return metadata;
+    }
+
+    std::string HttpCache::SerializeMetadata(const Metadata& metadata)
+    {
+        // Header values and URLs cannot contain line breaks, so one field per line is unambiguous.
+        return metadata.Url + "\n" + metadata.ETag + "\n" + metadata.LastModified + "\n" + std::to_string(metadata.Expiry) + "\n" + std::to_string(metadata.Size) + "\n";
+    }
+
+    bool HttpCache::WriteMetadata(const std::string& directory, const std::string& key, const Metadata& metadata)
+    {
+        const std::string contents{SerializeMetadata(metadata)};
+        return WriteFileAtomically(GetPath(directory, key, METADATA_EXTENSION), {reinterpret_cast<const std::byte*>(contents.data()), static_cast<std::ptrdiff_t>(contents.size())});
+    }
+
+    void HttpCache::Remove(const std::string& key)
+    {
+        // Mapped bodies stay readable after their file is unlinked.
+        std::remove(GetPath(m_directory.value(), key, METADATA_EXTENSION).c_str());
+        std::remove(GetPath(m_directory.value(), key, BODY_EXTENSION).c_str());
+
+        auto indexEntry = m_index.find(key);
+        if (indexEntry != m_index.end())
+        {
+            m_totalSize -= indexEntry->second.Size;
+            m_index.erase(indexEntry);
+        }
+    }
+
+    void HttpCache::Evict()
+    {
+        while (m_totalSize > m_maxSize && !m_index.empty())
+        {
+            auto leastRecentlyUsed = std::min_element(m_index.begin(), m_index.end(), [](const auto& a, const auto& b) {
+                return a.second.LastUse < b.second.LastUse;
+            });
+
+            const std::string key{leastRecentlyUsed->first};
+            Remove(key);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <gsl/gsl>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace UrlLib
+{
+    // Persistent cache of HTTP response bodies, keyed by URL. Each entry is a body file plus a
+    // small metadata file holding the URL, validators and expiry. The total body size is bounded;
+    // the least recently used entries are evicted first.
+    class HttpCache final
+    {
+    public:
+        // The response headers that decide whether and for how long a body may be reused.
+        struct Headers
+        {
+            std::string ETag{};
+            std::string LastModified{};
+            std::string CacheControl{};
+            std::string Vary{};
+        };
+
+        // A read-only view of a cached body, memory-mapped for as long as it is referenced.
+        // Evicting or replacing the entry does not invalidate an existing mapping.
+        class MappedBody final
+        {
+        public:
+            MappedBody(void* data, size_t size);
+            ~MappedBody();
+
+            MappedBody(const MappedBody&) = delete;
+            MappedBody& operator=(const MappedBody&) = delete;
+
+            gsl::span<const std::byte> Data() const;
+
+        private:
+            void* m_data{};
+            size_t m_size{};
+        };
+
+        struct Entry
+        {
+            std::shared_ptr<const MappedBody> Body{};
+            std::string ETag{};
+            std::string LastModified{};
+
+            // A fresh entry may be served without contacting the server; a stale one must be
+            // revalidated with its validators first.
+            bool Fresh{};
+        };
+
+        static constexpr size_t DEFAULT_MAX_SIZE{256 * 1024 * 1024};
+
+        static HttpCache& GetInstance();
+
+        // Loads the index of an existing cache directory, creating the directory if needed.
+        // Until this is called the cache stores and finds nothing.
+        void Enable(std::string directory, size_t maxSize);
+
+        bool IsEnabled() const;
+
+        // Whether responses for url are looked up and stored; only HTTP(S) is cached.
+        bool IsCacheable(const std::string& url) const;
+
+        std::optional<Entry> Find(const std::string& url);
+
+        // Stores the body of a 200 response, unless the headers forbid it, give no way to ever
+        // reuse it, or say that it varies with request headers.
+        void Store(const std::string& url, gsl::span<const std::byte> body, const Headers& headers);
+
+        // Extends the lifetime of an entry after the server answered 304 Not Modified.
+        void Refresh(const std::string& url, const Headers& headers);
+
+    private:
+        struct IndexEntry
+        {
+            size_t Size{};
+            std::chrono::system_clock::time_point LastUse{};
+        };
+
+        struct Metadata
+        {
+            std::string Url{};
+            std::string ETag{};
+            std::string LastModified{};
+            int64_t Expiry{};
+            size_t Size{};
+        };
+
+        HttpCache() = default;
+
+        static std::optional<Metadata> ReadMetadata(const std::string& directory, const std::string& key);
+        static std::string SerializeMetadata(const Metadata& metadata);
+        static bool WriteMetadata(const std::string& directory, const std::string& key, const Metadata& metadata);
+        void Remove(const std::string& key);
+        void Evict();
+
+        mutable std::mutex m_mutex{};
+        std::optional<std::string> m_directory{};
+        size_t m_maxSize{DEFAULT_MAX_SIZE};
+        size_t m_totalSize{};
+        std::unordered_map<std::string, IndexEntry> m_index{};
+    };
+}
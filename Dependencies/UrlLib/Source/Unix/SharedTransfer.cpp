@@ -0,0 +1,439 @@
+#include "SharedTransfer.h"
+#include "CurlMulti.h"
+
+#include <arcana/threading/task.h>
+#include <arcana/threading/task_schedulers.h>
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <system_error>
+
+namespace UrlLib
+{
+    namespace
+    {
+        // Larger Content-Length values are not trusted for preallocation.
+        constexpr curl_off_t MAX_PREALLOCATION{1 << 30};
+
+        constexpr long HTTP_OK{200};
+        constexpr long HTTP_NOT_MODIFIED{304};
+
+        // Downloads in flight by URL. Lock before any transfer's own mutex.
+        std::mutex s_inFlightMutex{};
+        std::unordered_map<std::string, std::weak_ptr<SharedTransfer>> s_inFlight{};
+
+        std::exception_ptr MakeCanceledError()
+        {
+            return std::make_exception_ptr(std::system_error{std::make_error_code(std::errc::operation_canceled)});
+        }
+    }
+
+    SharedTransfer::SharedTransfer(std::string url, std::optional<HttpCache::Entry> cached, UrlPriority priority)
+        : m_url{std::move(url)}
+        , m_cached{std::move(cached)}
+        , m_priority{priority}
+    {
+    }
+
+    SharedTransfer::~SharedTransfer()
+    {
+        if (m_curl != nullptr)
+        {
+            curl_easy_cleanup(m_curl);
+        }
+
+        curl_slist_free_all(m_requestHeaders);
+    }
+
+    void SharedTransfer::Join(const std::string& url, std::optional<HttpCache::Entry> cached, UrlPriority priority, Subscriber subscriber, const JoinedT& joined)
+    {
+        auto subscription = std::make_shared<Subscription>();
+        subscription->Callbacks = std::move(subscriber);
+
+        // Taken before the subscription becomes visible to the transfer thread, which then waits
+        // for the bytes that arrived earlier to be delivered before it delivers newer ones, and
+        // for joined to return before it completes the subscription.
+        std::unique_lock delivery{subscription->DeliveryMutex};
+
+        std::shared_ptr<SharedTransfer> transfer{};
+        uint64_t subscriptionId{};
+        std::shared_ptr<const std::vector<std::byte>> receivedOwner{};
+        gsl::span<const std::byte> received{};
+        size_t total{};
+        bool isJoined{false};
+        {
+            std::scoped_lock inFlightLock{s_inFlightMutex};
+            auto inFlight = s_inFlight.find(url);
+            if (inFlight != s_inFlight.end())
+            {
+                transfer = inFlight->second.lock();
+            }
+
+            if (transfer)
+            {
+                std::scoped_lock lock{transfer->m_mutex};
+                if (!transfer->m_cancelled && !transfer->m_completed)
+                {
+                    // The bytes up to the current size stay where they are, whatever arrives next.
+                    receivedOwner = transfer->m_body;
+                    received = {receivedOwner->data(), static_cast<std::ptrdiff_t>(receivedOwner->size())};
+                    total = transfer->m_contentLength.value_or(0);
+
+                    if (priority < transfer->m_priority)
+                    {
+                        transfer->m_priority = priority;
+                        CurlMulti::GetInstance().SetPriority(transfer->m_transferId, priority);
+                    }
+
+                    subscriptionId = transfer->m_nextSubscriptionId++;
+                    transfer->m_subscriptions.emplace(subscriptionId, subscription);
+                    ++s_coalescedRequests;
+                    isJoined = true;
+                }
+            }
+
+            if (!isJoined)
+            {
+                // Nothing to join, or the download is already being torn down.
+                transfer = std::shared_ptr<SharedTransfer>{new SharedTransfer{url, std::move(cached), priority}};
+                subscriptionId = transfer->m_nextSubscriptionId++;
+                transfer->m_subscriptions.emplace(subscriptionId, subscription);
+                s_inFlight[url] = transfer;
+            }
+        }
+
+        joined(transfer, subscriptionId);
+
+        if (isJoined)
+        {
+            if (!received.empty())
+            {
+                Deliver(*subscription, received, static_cast<size_t>(received.size()), total);
+            }
+            return;
+        }
+
+        // Start may complete the download right away, which delivers to this subscription.
+        delivery.unlock();
+        transfer->Start();
+    }
+
+    void SharedTransfer::Leave(uint64_t subscriptionId)
+    {
+        std::shared_ptr<Subscription> subscription{};
+        {
+            std::scoped_lock lock{m_mutex};
+            auto it = m_subscriptions.find(subscriptionId);
+            if (it == m_subscriptions.end())
+            {
+                return;
+            }
+
+            subscription = std::move(it->second);
+            m_subscriptions.erase(it);
+
+            if (m_subscriptions.empty() && !m_completed)
+            {
+                m_cancelled = true;
+                CurlMulti::GetInstance().Cancel(m_transferId);
+            }
+        }
+
+        Complete(*subscription, MakeCanceledError(), {});
+    }
+
+    void SharedTransfer::Deliver(Subscription& subscription, gsl::span<const std::byte> data, size_t received, size_t total)
+    {
+        std::scoped_lock delivery{subscription.DeliveryMutex};
+        if (!subscription.Completed && subscription.Callbacks.DataCallback)
+        {
+            subscription.Callbacks.DataCallback(data);
+        }
+
+        // The data callback may have left the download.
+        if (!subscription.Completed && subscription.Callbacks.ProgressCallback)
+        {
+            subscription.Callbacks.ProgressCallback(received, total);
+        }
+    }
+
+    void SharedTransfer::Complete(Subscription& subscription, std::exception_ptr error, const Response& response)
+    {
+        std::scoped_lock delivery{subscription.DeliveryMutex};
+        if (!subscription.Completed)
+        {
+            subscription.Completed = true;
+            subscription.Callbacks.Completion(std::move(error), response);
+        }
+    }
+
+    uint64_t SharedTransfer::GetCoalescedRequests()
+    {
+        return s_coalescedRequests;
+    }
+
+    uint64_t SharedTransfer::GetCacheRevalidations()
+    {
+        return s_cacheRevalidations;
+    }
+
+    void SharedTransfer::Start()
+    {
+        m_curl = curl_easy_init();
+        if (m_curl == nullptr)
+        {
+            OnComplete(CURLE_FAILED_INIT);
+            return;
+        }
+
+        curl_easy_setopt(m_curl, CURLOPT_URL, m_url.data());
+        curl_easy_setopt(m_curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(m_curl, CURLOPT_NOSIGNAL, 1L);
+
+        // Prefer waiting for an HTTP/2 connection that is still being set up over opening
+        // a parallel one to the same host.
+        curl_easy_setopt(m_curl, CURLOPT_PIPEWAIT, 1L);
+
+        curl_write_callback callback = [](char* buffer, size_t /*size*/, size_t nitems, void* userData) -> size_t {
+            auto& transfer = *static_cast<SharedTransfer*>(userData);
+            try
+            {
+                transfer.OnData(buffer, nitems);
+                return nitems;
+            }
+            catch (...)
+            {
+                // Exceptions must not unwind through curl; a short write fails the transfer.
+                return 0;
+            }
+        };
+
+        curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, callback);
+        curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, this);
+
+        curl_write_callback headerCallback = [](char* buffer, size_t size, size_t nitems, void* userData) -> size_t {
+            auto& transfer = *static_cast<SharedTransfer*>(userData);
+            transfer.OnHeader({buffer, size * nitems});
+            return size * nitems;
+        };
+
+        curl_easy_setopt(m_curl, CURLOPT_HEADERFUNCTION, headerCallback);
+        curl_easy_setopt(m_curl, CURLOPT_HEADERDATA, this);
+
+        // A stale cache entry is revalidated rather than downloaded again.
+        if (m_cached.has_value())
+        {
+            if (!m_cached->ETag.empty())
+            {
+                m_requestHeaders = curl_slist_append(m_requestHeaders, ("If-None-Match: " + m_cached->ETag).data());
+            }
+
+            if (!m_cached->LastModified.empty())
+            {
+                m_requestHeaders = curl_slist_append(m_requestHeaders, ("If-Modified-Since: " + m_cached->LastModified).data());
+            }
+
+            curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, m_requestHeaders);
+        }
+
+        {
+            std::scoped_lock lock{m_mutex};
+
+            // The completion holds a reference so that the easy handle and the body stay alive
+            // for as long as the transfer thread can touch them.
+            if (!m_cancelled)
+            {
+                m_transferId = CurlMulti::GetInstance().Add(m_curl, m_priority, [self{shared_from_this()}](CURLcode result) {
+                    self->OnComplete(result);
+                });
+                return;
+            }
+        }
+
+        // Every subscriber left before the download could be queued.
+        OnComplete(CURLE_ABORTED_BY_CALLBACK);
+    }
+
+    void SharedTransfer::OnData(char* buffer, size_t size)
+    {
+        auto bytes = reinterpret_cast<const std::byte*>(buffer);
+        std::vector<std::shared_ptr<Subscription>> subscriptions{};
+        size_t received{};
+        size_t total{};
+        {
+            std::scoped_lock lock{m_mutex};
+
+            // Headers are complete by the time the first body bytes arrive, so this is the
+            // earliest point at which the final size is known.
+            if (!m_contentLength.has_value())
+            {
+                curl_off_t contentLength{-1};
+                curl_easy_getinfo(m_curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+                m_contentLength = contentLength > 0 ? static_cast<size_t>(contentLength) : 0;
+
+                if (contentLength > 0 && contentLength <= MAX_PREALLOCATION)
+                {
+                    m_body->reserve(static_cast<size_t>(contentLength));
+                }
+            }
+
+            Append(bytes, size);
+            received = m_body->size();
+            total = m_contentLength.value();
+
+            subscriptions.reserve(m_subscriptions.size());
+            for (const auto& [subscriptionId, subscription] : m_subscriptions)
+            {
+                subscriptions.push_back(subscription);
+            }
+        }
+
+        for (const auto& subscription : subscriptions)
+        {
+            Deliver(*subscription, {bytes, static_cast<std::ptrdiff_t>(size)}, received, total);
+        }
+    }
+
+    void SharedTransfer::Append(const std::byte* data, size_t size)
+    {
+        if (m_body->size() + size > m_body->capacity())
+        {
+            // Late joiners may still be reading the current vector, so it is replaced rather than
+            // reallocated in place. Doubling keeps the copies linear in the body size.
+            auto body = std::make_shared<std::vector<std::byte>>();
+            body->reserve(std::max(m_body->capacity() * 2, m_body->size() + size));
+            body->insert(body->end(), m_body->begin(), m_body->end());
+            m_body = std::move(body);
+        }
+
+        m_body->insert(m_body->end(), data, data + size);
+    }
+
+    void SharedTransfer::OnHeader(std::string_view line)
+    {
+        // Each response in a redirect chain starts with its own status line.
+        if (line.compare(0, 5, "HTTP/") == 0)
+        {
+            m_responseHeaders = {};
+            return;
+        }
+
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+        {
+            return;
+        }
+
+        std::string name{line.substr(0, colon)};
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        std::string_view value{line.substr(colon + 1)};
+        const size_t valueStart = value.find_first_not_of(" \t");
+        const size_t valueEnd = value.find_last_not_of(" \t\r\n");
+        value = valueStart == std::string_view::npos ? std::string_view{} : value.substr(valueStart, valueEnd - valueStart + 1);
+
+        if (name == "etag")
+        {
+            m_responseHeaders.ETag = value;
+        }
+        else if (name == "last-modified")
+        {
+            m_responseHeaders.LastModified = value;
+        }
+        else if (name == "cache-control")
+        {
+            m_responseHeaders.CacheControl = value;
+        }
+        else if (name == "vary")
+        {
+            m_responseHeaders.Vary = value;
+        }
+    }
+
+    void SharedTransfer::OnComplete(CURLcode result)
+    {
+        std::exception_ptr error{};
+        long responseCode{};
+        std::string responseUrl{};
+        if (result == CURLE_OK)
+        {
+            curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &responseCode);
+
+            char* effectiveUrl{};
+            if (curl_easy_getinfo(m_curl, CURLINFO_EFFECTIVE_URL, &effectiveUrl) == CURLE_OK && effectiveUrl != nullptr)
+            {
+                responseUrl = effectiveUrl;
+            }
+        }
+        else if (result == CURLE_ABORTED_BY_CALLBACK)
+        {
+            error = MakeCanceledError();
+        }
+        else
+        {
+            error = std::make_exception_ptr(std::runtime_error{curl_easy_strerror(result)});
+        }
+
+        // Requests sent from now on start a download of their own.
+        Subscriptions subscriptions{};
+        {
+            std::scoped_lock inFlightLock{s_inFlightMutex};
+            auto inFlight = s_inFlight.find(m_url);
+            if (inFlight != s_inFlight.end() && inFlight->second.lock().get() == this)
+            {
+                s_inFlight.erase(inFlight);
+            }
+
+            std::scoped_lock lock{m_mutex};
+            m_completed = true;
+            subscriptions.swap(m_subscriptions);
+        }
+
+        // Continuations must not run on the transfer thread, where they would stall every
+        // other download.
+        arcana::make_task(arcana::threadpool_scheduler, arcana::cancellation::none(), [self{shared_from_this()}, error{std::move(error)}, responseCode, responseUrl{std::move(responseUrl)}, subscriptions{std::move(subscriptions)}]() mutable {
+            self->Finish(std::move(error), responseCode, std::move(responseUrl), std::move(subscriptions));
+        });
+    }
+
+    void SharedTransfer::Finish(std::exception_ptr error, long responseCode, std::string responseUrl, Subscriptions subscriptions)
+    {
+        Response response{std::move(responseUrl), responseCode == 0 ? HTTP_OK : responseCode};
+        if (!error)
+        {
+            // The cache is updated once per download, however many requests shared it.
+            if (responseCode == HTTP_NOT_MODIFIED && m_cached.has_value())
+            {
+                HttpCache::GetInstance().Refresh(m_url, m_responseHeaders);
+                ++s_cacheRevalidations;
+
+                response.StatusCode = HTTP_OK;
+                response.Owner = m_cached->Body;
+                response.Body = m_cached->Body->Data();
+
+                // The body never came over the network, so nobody has seen it yet.
+                const auto size = static_cast<size_t>(response.Body.size());
+                for (const auto& [subscriptionId, subscription] : subscriptions)
+                {
+                    Deliver(*subscription, response.Body, size, size);
+                }
+            }
+            else
+            {
+                if (responseCode == HTTP_OK && HttpCache::GetInstance().IsCacheable(m_url))
+                {
+                    HttpCache::GetInstance().Store(m_url, *m_body, m_responseHeaders);
+                }
+
+                response.Owner = m_body;
+                response.Body = *m_body;
+            }
+        }
+
+        for (const auto& [subscriptionId, subscription] : subscriptions)
+        {
+            Complete(*subscription, error, response);
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "HttpCache.h"
+
+#include <UrlLib/UrlLib.h>
+#include <curl/curl.h>
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace UrlLib
+{
+    // One download of a URL, shared by every request for that URL sent while it is in flight.
+    // Each request subscribes to it; the download is cancelled once every subscriber has left.
+    class SharedTransfer final : public std::enable_shared_from_this<SharedTransfer>
+    {
+    public:
+        struct Response
+        {
+            std::string Url{};
+
+            // The final response's HTTP status, 200 for a revalidated cache entry and for schemes
+            // without one, such as file://.
+            long StatusCode{};
+
+            // Keeps Body alive. It is either the downloaded bytes or a cached file's mapping,
+            // and is shared by all subscribers rather than copied for each.
+            std::shared_ptr<const void> Owner{};
+            gsl::span<const std::byte> Body{};
+        };
+
+        using CompletionT = std::function<void(std::exception_ptr error, const Response& response)>;
+
+        // The callbacks run without any of the transfer's locks held, so they may join or leave
+        // downloads. Data and progress run on the transfer thread, except that a subscriber that
+        // joins late first receives the bytes that arrived before it on the joining thread.
+        // Delivery to each subscriber is in order and nothing follows its completion.
+        struct Subscriber
+        {
+            UrlRequest::DataCallbackT DataCallback{};
+            UrlRequest::ProgressCallbackT ProgressCallback{};
+            CompletionT Completion{};
+        };
+
+        ~SharedTransfer();
+
+        // Receives the download and the subscription id, before anything is delivered to the
+        // subscriber and before a new download starts, so that the caller can record them first.
+        using JoinedT = std::function<void(const std::shared_ptr<SharedTransfer>& transfer, uint64_t subscriptionId)>;
+
+        // Subscribes to the in-flight download of url, or starts one. cached is a stale cache
+        // entry to revalidate, if there is one. A subscriber of higher priority than the
+        // download's raises it.
+        static void Join(const std::string& url, std::optional<HttpCache::Entry> cached, UrlPriority priority, Subscriber subscriber, const JoinedT& joined);
+
+        // Completes the subscription with operation_canceled, unless it has already completed.
+        void Leave(uint64_t subscriptionId);
+
+        static uint64_t GetCoalescedRequests();
+        static uint64_t GetCacheRevalidations();
+
+    private:
+        SharedTransfer(std::string url, std::optional<HttpCache::Entry> cached, UrlPriority priority);
+
+        void Start();
+        void OnData(char* buffer, size_t size);
+        void OnHeader(std::string_view line);
+        void OnComplete(CURLcode result);
+
+        struct Subscription
+        {
+            Subscriber Callbacks{};
+
+            // Held while calling back, so that data from the transfer thread cannot overtake the
+            // bytes a late joiner is still receiving. Recursive since a callback may leave.
+            std::recursive_mutex DeliveryMutex{};
+            bool Completed{false};
+        };
+
+        using Subscriptions = std::unordered_map<uint64_t, std::shared_ptr<Subscription>>;
+
+        static void Deliver(Subscription& subscription, gsl::span<const std::byte> data, size_t received, size_t total);
+        static void Complete(Subscription& subscription, std::exception_ptr error, const Response& response);
+
+        void Append(const std::byte* data, size_t size);
+        void Finish(std::exception_ptr error, long responseCode, std::string responseUrl, Subscriptions subscriptions);
+
+        static inline std::atomic<uint64_t> s_coalescedRequests{};
+        static inline std::atomic<uint64_t> s_cacheRevalidations{};
+
+        const std::string m_url;
+        const std::optional<HttpCache::Entry> m_cached;
+
+        CURL* m_curl{};
+        curl_slist* m_requestHeaders{};
+
+        // Only touched on the transfer thread until the download completes.
+        HttpCache::Headers m_responseHeaders{};
+
+        std::mutex m_mutex{};
+        UrlPriority m_priority;
+        uint64_t m_transferId{};
+        Subscriptions m_subscriptions{};
+        uint64_t m_nextSubscriptionId{1};
+
+        // Bytes already received are never moved or modified, so that late joiners can share them
+        // without a copy. Appending within the capacity leaves them in place, and growing beyond it
+        // moves the body to a new vector while subscribers keep the old one alive.
+        std::shared_ptr<std::vector<std::byte>> m_body{std::make_shared<std::vector<std::byte>>()};
+        std::optional<size_t> m_contentLength{};
+        bool m_cancelled{false};
+        bool m_completed{false};
+    };
+}
@@ -1,22 +1,63 @@
 #include <UrlLib/UrlLib.h>
 #include <arcana/threading/task.h>
 #include <arcana/threading/task_schedulers.h>
-#include <curl/curl.h>
+#include "CurlMulti.h"
+#include "HttpCache.h"
+#include "SharedTransfer.h"
+#include <atomic>
+#include <mutex>
+#include <optional>
 
 namespace UrlLib
 {
-    class UrlRequest::Impl
+    class UrlRequest::Impl : public std::enable_shared_from_this<UrlRequest::Impl>
     {
-        using ByteArray = std::vector<std::byte>;
     public:
         ~Impl()
         {
             Abort();
         }
 
+        static void EnableCache(std::string directory, size_t maxSizeBytes)
+        {
+            HttpCache::GetInstance().Enable(std::move(directory), maxSizeBytes);
+        }
+
+        static void SetMaxConcurrentRequests(size_t count)
+        {
+            CurlMulti::GetInstance().SetMaxConcurrency(count);
+        }
+
+        static UrlRequestStats GetStats()
+        {
+            const auto queueStats = CurlMulti::GetInstance().GetQueueStats();
+            return {
+                SharedTransfer::GetCoalescedRequests(),
+                s_cacheHits,
+                SharedTransfer::GetCacheRevalidations(),
+                queueStats.StartedTransfers,
+                queueStats.TotalQueueWait,
+                queueStats.MaxQueueWait,
+            };
+        }
+
         void Abort()
         {
             m_cancellationSource.cancel();
+
+            std::shared_ptr<SharedTransfer> transfer{};
+            uint64_t subscriptionId{};
+            {
+                std::scoped_lock lock{m_transferMutex};
+                transfer = std::move(m_transfer);
+                subscriptionId = m_subscriptionId;
+            }
+
+            // Other requests sharing the download are unaffected.
+            if (transfer)
+            {
+                transfer->Leave(subscriptionId);
+            }
         }
 
         void Open(UrlMethod method, std::string url)
@@ -35,23 +76,59 @@ namespace UrlLib
             m_responseType = value;
         }
 
+        UrlPriority Priority() const
+        {
+            return m_priority;
+        }
+
+        void Priority(UrlPriority value)
+        {
+            m_priority = value;
+        }
+
+        void SetProgressCallback(ProgressCallbackT callback)
+        {
+            m_progressCallback = std::move(callback);
+        }
+
+        void SetDataCallback(DataCallbackT callback)
+        {
+            m_dataCallback = std::move(callback);
+        }
+
         arcana::task<void, std::exception_ptr> SendAsync()
         {
-            return arcana::make_task(arcana::threadpool_scheduler, m_cancellationSource, [this]()
+            m_responseOwner.reset();
+            m_response = {};
+
+            if (m_method != UrlMethod::Get || !HttpCache::GetInstance().IsCacheable(m_url))
             {
-                switch (m_responseType)
+                return Subscribe({});
+            }
+
+            // Looking up the cache touches the disk, so it happens off the calling thread.
+            return arcana::task_from_result<std::exception_ptr>().then(arcana::threadpool_scheduler, m_cancellationSource, [this, self{shared_from_this()}]() {
+                auto cached = HttpCache::GetInstance().Find(m_url);
+                if (cached.has_value() && cached->Fresh)
                 {
-                    case UrlResponseType::String:
+                    ++s_cacheHits;
+
+                    const auto data = cached->Body->Data();
+                    if (m_dataCallback)
                     {
-                        LoadFile(m_responseString);
-                        break;
+                        m_dataCallback(data);
                     }
-                    case UrlResponseType::Buffer:
+
+                    if (m_progressCallback)
                     {
-                        LoadFile(m_responseBuffer);
-                        break;
+                        m_progressCallback(static_cast<size_t>(data.size()), static_cast<size_t>(data.size()));
                     }
+
+                    SetResponse(m_url, std::move(cached->Body), data, UrlStatusCode::Ok);
+                    return arcana::task_from_result<std::exception_ptr>();
                 }
+
+                return Subscribe(std::move(cached));
             });
         }
 
@@ -65,66 +142,87 @@ namespace UrlLib
             return m_responseUrl;
         }
 
+        // Both views share one immutable body: the downloaded bytes, shared with every request
+        // that coalesced onto the same download, or the mapping of a cached file. Neither is
+        // null-terminated.
         gsl::cstring_span<> ResponseString()
         {
-            return m_responseString;
+            if (m_response.empty())
+            {
+                return {""};
+            }
+
+            return {reinterpret_cast<const char*>(m_response.data()), m_response.size()};
         }
 
         gsl::span<const std::byte> ResponseBuffer() const
         {
-            return m_responseBuffer;
+            return m_response;
         }
 
     private:
-
-        static void Append(std::string& string, char* buffer, size_t nitems)
-        {
-            string.insert(string.end(), buffer, buffer + nitems);
-        }
-
-        static void Append(ByteArray& byteArray, char* buffer, size_t nitems)
-        {
-            auto bytes = reinterpret_cast<std::byte const*>(buffer);
-            byteArray.insert(byteArray.end(), bytes, bytes + nitems);   
-        }
-
-        template<typename DataT> void LoadFile(DataT& data)
+        arcana::task<void, std::exception_ptr> Subscribe(std::optional<HttpCache::Entry> cached)
         {
-            auto curl = curl_easy_init();
-            if (curl)
-            {
-                data.clear();
-                curl_easy_setopt(curl, CURLOPT_URL, m_url.data());
-                curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+            arcana::task_completion_source<void, std::exception_ptr> taskCompletionSource{};
 
-                curl_write_callback callback = [](char* buffer, size_t /*size*/, size_t nitems, void* userData) {
-                    auto& data = *static_cast<DataT*>(userData);
-                    Append(data, buffer, nitems);
-                    return nitems;
-                };
-
-                curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, callback);
-                curl_easy_setopt(curl, CURLOPT_WRITEDATA, &data);
+            SharedTransfer::Subscriber subscriber{m_dataCallback, m_progressCallback, [this, self{shared_from_this()}, taskCompletionSource](std::exception_ptr error, const SharedTransfer::Response& response) mutable {
+                {
+                    std::scoped_lock lock{m_transferMutex};
+                    m_transfer.reset();
+                }
 
-                auto result = curl_easy_perform(curl);
-                if (result != CURLE_OK)
+                if (error)
                 {
-                    throw std::exception();
+                    taskCompletionSource.complete(arcana::make_unexpected(error));
+                    return;
                 }
 
-                curl_easy_cleanup(curl);
-                m_statusCode = UrlStatusCode::Ok;
+                SetResponse(response.Url, response.Owner, response.Body, static_cast<UrlStatusCode>(response.StatusCode));
+                taskCompletionSource.complete();
+            }};
+
+            // The transfer is recorded before anything can be delivered or completed, so that the
+            // completion above always clears it and Abort always finds it.
+            SharedTransfer::Join(m_url, std::move(cached), m_priority, std::move(subscriber), [this](const std::shared_ptr<SharedTransfer>& transfer, uint64_t subscriptionId) {
+                std::scoped_lock lock{m_transferMutex};
+                m_transfer = transfer;
+                m_subscriptionId = subscriptionId;
+            });
+
+            // An Abort that ran before the transfer was recorded could not leave it.
+            if (m_cancellationSource.cancelled())
+            {
+                Abort();
             }
+
+            return taskCompletionSource.as_task();
         }
 
+        void SetResponse(std::string url, std::shared_ptr<const void> owner, gsl::span<const std::byte> body, UrlStatusCode statusCode)
+        {
+            m_responseUrl = std::move(url);
+            m_responseOwner = std::move(owner);
+            m_response = body;
+            m_statusCode = statusCode;
+        }
+
+        static inline std::atomic<uint64_t> s_cacheHits{};
+
         arcana::cancellation_source m_cancellationSource{};
         UrlResponseType m_responseType{UrlResponseType::String};
         UrlMethod m_method{UrlMethod::Get};
+        UrlPriority m_priority{UrlPriority::Normal};
         UrlStatusCode m_statusCode{UrlStatusCode::None};
         std::string m_url{};
         std::string m_responseUrl{};
-        std::string m_responseString{};
-        ByteArray m_responseBuffer{};
+        std::shared_ptr<const void> m_responseOwner{};
+        gsl::span<const std::byte> m_response{};
+        ProgressCallbackT m_progressCallback{};
+        DataCallbackT m_dataCallback{};
+
+        std::mutex m_transferMutex{};
+        std::shared_ptr<SharedTransfer> m_transfer{};
+        uint64_t m_subscriptionId{};
     };
 }
 
@@ -40,6 +40,19 @@ namespace UrlLib
             Abort();
         }
 
+        static void SetMaxConcurrentRequests(size_t)
+        {
+        }
+
+        static void EnableCache(std::string, size_t)
+        {
+        }
+
+        static UrlRequestStats GetStats()
+        {
+            return {};
+        }
+
         void Abort()
         {
             m_cancellationSource.cancel();
@@ -61,7 +74,59 @@ namespace UrlLib
             m_responseType = value;
         }
 
+        // The platform's networking stack schedules requests itself.
+        UrlPriority Priority() const
+        {
+            return m_priority;
+        }
+
+        void Priority(UrlPriority value)
+        {
+            m_priority = value;
+        }
+
+        void SetProgressCallback(ProgressCallbackT callback)
+        {
+            m_progressCallback = std::move(callback);
+        }
+
+        void SetDataCallback(DataCallbackT callback)
+        {
+            m_dataCallback = std::move(callback);
+        }
+
         arcana::task<void, std::exception_ptr> SendAsync()
+        {
+            return SendRequestAsync().then(arcana::inline_scheduler, m_cancellationSource, [this]() {
+                ReportResponse();
+            });
+        }
+
+        UrlStatusCode StatusCode() const
+        {
+            return m_statusCode;
+        }
+
+        gsl::cstring_span<> ResponseUrl()
+        {
+            return m_responseUrl;
+        }
+
+        gsl::cstring_span<> ResponseString()
+        {
+            return m_responseString;
+        }
+
+        gsl::span<const std::byte> ResponseBuffer() const
+        {
+            std::byte* bytes;
+            auto bufferByteAccess = m_responseBuffer.as<::Windows::Storage::Streams::IBufferByteAccess>();
+            winrt::check_hresult(bufferByteAccess->Buffer(reinterpret_cast<byte**>(&bytes)));
+            return {bytes, gsl::narrow_cast<std::ptrdiff_t>(m_responseBuffer.Length())};
+        }
+
+    private:
+        arcana::task<void, std::exception_ptr> SendRequestAsync()
         {
             Foundation::Uri url{winrt::to_hstring(m_url)};
 
@@ -126,30 +191,39 @@ namespace UrlLib
             }
         }
 
-        UrlStatusCode StatusCode() const
-        {
-            return m_statusCode;
-        }
-
-        gsl::cstring_span<> ResponseUrl()
+        // This backend only sees the body once it is complete, so it is reported as a single chunk.
+        void ReportResponse()
         {
-            return m_responseUrl;
-        }
+            gsl::span<const std::byte> data{};
+            switch (m_responseType)
+            {
+                case UrlResponseType::String:
+                {
+                    data = {reinterpret_cast<const std::byte*>(m_responseString.data()), static_cast<std::ptrdiff_t>(m_responseString.size())};
+                    break;
+                }
+                case UrlResponseType::Buffer:
+                {
+                    // Unsuccessful responses never receive a buffer.
+                    if (m_responseBuffer)
+                    {
+                        data = ResponseBuffer();
+                    }
+                    break;
+                }
+            }
 
-        gsl::cstring_span<> ResponseString()
-        {
-            return m_responseString;
-        }
+            if (m_dataCallback)
+            {
+                m_dataCallback(data);
+            }
 
-        gsl::span<const std::byte> ResponseBuffer() const
-        {
-            std::byte* bytes;
-            auto bufferByteAccess = m_responseBuffer.as<::Windows::Storage::Streams::IBufferByteAccess>();
-            winrt::check_hresult(bufferByteAccess->Buffer(reinterpret_cast<byte**>(&bytes)));
-            return {bytes, gsl::narrow_cast<std::ptrdiff_t>(m_responseBuffer.Length())};
+            if (m_progressCallback)
+            {
+                m_progressCallback(static_cast<size_t>(data.size()), static_cast<size_t>(data.size()));
+            }
         }
 
-    private:
         arcana::task<void, std::exception_ptr> LoadFileAsync(Storage::StorageFile file)
         {
             switch (m_responseType)
@@ -179,7 +253,10 @@ namespace UrlLib
 
 
         arcana::cancellation_source m_cancellationSource{};
+        ProgressCallbackT m_progressCallback{};
+        DataCallbackT m_dataCallback{};
         UrlResponseType m_responseType{UrlResponseType::String};
+        UrlPriority m_priority{UrlPriority::Normal};
         UrlMethod m_method{UrlMethod::Get};
         std::string m_url{};
         UrlStatusCode m_statusCode{UrlStatusCode::None};
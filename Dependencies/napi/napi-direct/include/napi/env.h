@@ -2,6 +2,10 @@
 
 #include "napi.h"
 
+#include <cstdint>
+#include <functional>
+#include <vector>
+
 namespace Napi
 {
     template<typename ...Ts> Napi::Env Attach(Ts... args);
@@ -9,6 +13,24 @@ namespace Napi
     void Detach(Napi::Env);
 
     Napi::Value Eval(Napi::Env env, const char* source, const char* sourceUrl);
+    Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl);
+
+    // Evaluates the source using cachedData from an earlier run when the engine accepts it.
+    // producedData receives a fresh cache whenever the engine compiled the script from scratch
+    // and supports code caching; it is left empty otherwise.
+    Napi::Value Eval(Napi::Env env, const char* source, const char* sourceUrl, const std::vector<uint8_t>& cachedData, std::vector<uint8_t>& producedData);
+    Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl, const std::vector<uint8_t>& cachedData, std::vector<uint8_t>& producedData);
+
+    // Same as the overloads above, but bytesCopied is set to the number of bytes written copying
+    // the source out of the string before the engine could read it, zero when it reads it in place.
+    Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl, size_t& bytesCopied);
+    Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl, const std::vector<uint8_t>& cachedData, std::vector<uint8_t>& producedData, size_t& bytesCopied);
+
+    // Creates a string that references latin1 data without copying it when the engine supports
+    // external strings. bytesCopied is set to the number of bytes written copying the data, the
+    // engine's own copy and any widened intermediate included, and release runs once the engine
+    // no longer needs the data, which is before this returns when bytesCopied is not zero.
+    Napi::String CreateExternalLatin1String(Napi::Env env, const char* data, size_t length, std::function<void()> release, size_t& bytesCopied);
 
     template<typename T> T GetContext(Napi::Env env);
 }
@@ -71,6 +71,21 @@ NAPI_EXTERN napi_status napi_create_string_latin1(napi_env env,
                                                   const char* str,
                                                   size_t length,
                                                   napi_value* result);
+// Babylon extension, deliberately outside the napi_/node_api_ namespaces so it
+// cannot clash with Node-API's own node_api_create_external_string_latin1.
+// Creates a string over latin1 bytes owned by the caller. Engines that support
+// external strings reference the bytes directly and call finalize_callback once
+// the string is collected; others copy them and call finalize_callback before
+// returning. *bytes_copied is set to the number of bytes written by those copies,
+// including the engine's own and any widened intermediate, zero when referenced.
+NAPI_EXTERN napi_status
+babylon_create_external_string_latin1(napi_env env,
+                                      char* str,
+                                      size_t length,
+                                      napi_finalize finalize_callback,
+                                      void* finalize_hint,
+                                      napi_value* result,
+                                      size_t* bytes_copied);
 NAPI_EXTERN napi_status napi_create_string_utf8(napi_env env,
                                                 const char* str,
                                                 size_t length,
@@ -442,6 +457,20 @@ NAPI_EXTERN napi_status napi_run_script(napi_env env,
                                         const char* source_url,
                                         napi_value* result);
 
+// Like napi_run_script, but hands the engine a code cache produced by an earlier
+// run of the same source. When the cache is missing or rejected and the engine
+// can serialize its compiled code, produce_cb is called with a fresh cache before
+// this function returns. Engines without a code cache ignore both and simply
+// run the script.
+NAPI_EXTERN napi_status napi_run_script_with_cache(napi_env env,
+                                                   napi_value script,
+                                                   const char* source_url,
+                                                   const uint8_t* cached_data,
+                                                   size_t cached_data_length,
+                                                   napi_code_cache_callback produce_cb,
+                                                   void* produce_hint,
+                                                   napi_value* result);
+
 // Memory management
 NAPI_EXTERN napi_status napi_adjust_external_memory(napi_env env,
                                                     int64_t change_in_bytes,
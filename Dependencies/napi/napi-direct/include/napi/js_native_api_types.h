@@ -93,6 +93,10 @@ typedef void (*napi_finalize)(napi_env env,
                               void* finalize_data,
                               void* finalize_hint);
 
+typedef void (*napi_code_cache_callback)(const uint8_t* data,
+                                         size_t length,
+                                         void* hint);
+
 typedef struct {
   // One of utf8name or name should be NULL.
   const char* utf8name;
@@ -4,8 +4,63 @@ namespace Napi
 {
     Napi::Value Eval(Napi::Env env, const char* string, const char* sourceUrl)
     {
+        return Eval(env, Napi::String::New(env, string), sourceUrl);
+    }
+
+    Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl)
+    {
+        napi_value result;
+        NAPI_THROW_IF_FAILED(env, napi_run_script(env, source, sourceUrl, &result));
+        return{ env, result };
+    }
+
+    Napi::Value Eval(Napi::Env env, const char* string, const char* sourceUrl, const std::vector<uint8_t>& cachedData, std::vector<uint8_t>& producedData)
+    {
+        return Eval(env, Napi::String::New(env, string), sourceUrl, cachedData, producedData);
+    }
+
+    Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl, const std::vector<uint8_t>& cachedData, std::vector<uint8_t>& producedData)
+    {
+        napi_code_cache_callback produce = [](const uint8_t* data, size_t length, void* hint) {
+            static_cast<std::vector<uint8_t>*>(hint)->assign(data, data + length);
+        };
+
+        napi_value result;
+        NAPI_THROW_IF_FAILED(env, napi_run_script_with_cache(env, source, sourceUrl, cachedData.data(), cachedData.size(), produce, &producedData, &result));
+        return{ env, result };
+    }
+
+    Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl, size_t& bytesCopied)
+    {
+        // The engines behind this API compile straight from their own string.
+        bytesCopied = 0;
+        return Eval(env, source, sourceUrl);
+    }
+
+    Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl, const std::vector<uint8_t>& cachedData, std::vector<uint8_t>& producedData, size_t& bytesCopied)
+    {
+        bytesCopied = 0;
+        return Eval(env, source, sourceUrl, cachedData, producedData);
+    }
+
+    Napi::String CreateExternalLatin1String(Napi::Env env, const char* data, size_t length, std::function<void()> release, size_t& bytesCopied)
+    {
+        napi_finalize finalize = [](napi_env, void*, void* hint) {
+            auto* release = static_cast<std::function<void()>*>(hint);
+            (*release)();
+            delete release;
+        };
+
+        // The engine never writes through the pointer; the C API just predates const correctness.
+        auto* hint = new std::function<void()>(std::move(release));
+
         napi_value result;
-        NAPI_THROW_IF_FAILED(env, napi_run_script(env, Napi::String::New(env, string), sourceUrl, &result));
+        napi_status status = babylon_create_external_string_latin1(env, const_cast<char*>(data), length, finalize, hint, &result, &bytesCopied);
+        if (status != napi_ok)
+        {
+            delete hint;
+        }
+        NAPI_THROW_IF_FAILED(env, status);
         return{ env, result };
     }
 }
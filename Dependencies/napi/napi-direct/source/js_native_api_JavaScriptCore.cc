@@ -1148,6 +1148,36 @@ napi_status napi_create_string_latin1(napi_env env,
   return napi_ok;
 }
 
+napi_status babylon_create_external_string_latin1(napi_env env,
+                                                   char* str,
+                                                   size_t length,
+                                                   napi_finalize finalize_callback,
+                                                   void* finalize_hint,
+                                                   napi_value* result,
+                                                   size_t* bytes_copied) {
+  CHECK_ENV(env);
+  CHECK_ARG(env, str);
+  CHECK_ARG(env, result);
+
+  // The public C API has no external strings, so widen the bytes and let
+  // JavaScriptCore copy them. JSStringCreateWithCharactersNoCopy would avoid
+  // the second copy but is private API.
+  const auto* bytes = reinterpret_cast<const unsigned char*>(str);
+  std::u16string u16str(bytes, bytes + length);
+  *result = ToNapi(JSValueMakeString(
+    env->context,
+    JSString(reinterpret_cast<const JSChar*>(u16str.data()), u16str.size())));
+
+  if (finalize_callback != nullptr) {
+    finalize_callback(env, str, finalize_hint);
+  }
+  if (bytes_copied != nullptr) {
+    // The widened temporary, then the engine's copy of it.
+    *bytes_copied = 2 * u16str.size() * sizeof(char16_t);
+  }
+  return napi_ok;
+}
+
 napi_status napi_create_string_utf8(napi_env env,
                                     const char* str,
                                     size_t length,
@@ -2381,6 +2411,18 @@ napi_status napi_run_script(napi_env env,
   return napi_ok;
 }
 
+napi_status napi_run_script_with_cache(napi_env env,
+                                       napi_value script,
+                                       const char* source_url,
+                                       const uint8_t* /*cached_data*/,
+                                       size_t /*cached_data_length*/,
+                                       napi_code_cache_callback /*produce_cb*/,
+                                       void* /*produce_hint*/,
+                                       napi_value* result) {
+  // JavaScriptCore's bytecode cache is not exposed through its public C API.
+  return napi_run_script(env, script, source_url, result);
+}
+
 napi_status napi_add_finalizer(napi_env env,
                                napi_value js_object,
                                void* native_object,
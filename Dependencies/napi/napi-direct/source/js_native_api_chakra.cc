@@ -975,6 +975,35 @@ napi_status napi_create_string_latin1(napi_env env,
   return napi_ok;
 }
 
+napi_status babylon_create_external_string_latin1(napi_env env,
+                                                   char* str,
+                                                   size_t length,
+                                                   napi_finalize finalize_callback,
+                                                   void* finalize_hint,
+                                                   napi_value* result,
+                                                   size_t* bytes_copied) {
+  CHECK_ENV(env);
+  CHECK_ARG(env, str);
+  CHECK_ARG(env, result);
+
+  // JsRT only creates strings from its own copy of UTF-16 data, so the bytes are
+  // widened into a temporary first.
+  std::wstring wstr = NarrowToWide({ str, length }, CP_LATIN1);
+  CHECK_JSRT(env, JsPointerToString(
+    wstr.data(),
+    wstr.size(),
+    reinterpret_cast<JsValueRef*>(result)));
+
+  if (finalize_callback != nullptr) {
+    finalize_callback(env, str, finalize_hint);
+  }
+  if (bytes_copied != nullptr) {
+    // The widened temporary, then the engine's copy of it.
+    *bytes_copied = 2 * wstr.size() * sizeof(wchar_t);
+  }
+  return napi_ok;
+}
+
 napi_status napi_create_string_utf8(napi_env env,
                                     const char* str,
                                     size_t length,
@@ -2399,6 +2428,79 @@ napi_status napi_run_script(napi_env env,
   return napi_ok;
 }
 
+namespace {
+// The source of a script run from a serialized buffer, referenced until Chakra unloads it.
+struct SerializedScriptSource {
+  JsValueRef value;
+  const wchar_t* chars;
+};
+}  // end of anonymous namespace
+
+napi_status napi_run_script_with_cache(napi_env env,
+                                       napi_value script,
+                                       const char* source_url,
+                                       const uint8_t* cached_data,
+                                       size_t cached_data_length,
+                                       napi_code_cache_callback produce_cb,
+                                       void* produce_hint,
+                                       napi_value* result) {
+  CHECK_ARG(env, script);
+  CHECK_ARG(env, result);
+  JsValueRef scriptVar = reinterpret_cast<JsValueRef>(script);
+
+  const wchar_t* scriptStr;
+  size_t scriptStrLen;
+  CHECK_JSRT(env, JsStringToPointer(scriptVar, &scriptStr, &scriptStrLen));
+  const std::wstring url = NarrowToWide({ source_url });
+
+  if (cached_data != nullptr && cached_data_length > 0) {
+    std::vector<uint8_t> buffer{ cached_data, cached_data + cached_data_length };
+
+    // Chakra asks for the source whenever a function in the script needs it and says when it
+    // no longer will, so the source is referenced until then rather than for the runtime's life.
+    CHECK_JSRT(env, JsAddRef(scriptVar, nullptr));
+    auto* source = new SerializedScriptSource{ scriptVar, scriptStr };
+
+    JsErrorCode run_error = JsRunSerializedScriptWithCallback(
+      [](JsSourceContext context, const wchar_t** script) {
+        *script = reinterpret_cast<SerializedScriptSource*>(context)->chars;
+        return true;
+      },
+      [](JsSourceContext context) {
+        auto* source = reinterpret_cast<SerializedScriptSource*>(context);
+        JsRelease(source->value, nullptr);
+        delete source;
+      },
+      buffer.data(), reinterpret_cast<JsSourceContext>(source), url.data(), reinterpret_cast<JsValueRef*>(result));
+
+    // Any outcome but a rejected buffer may have created functions that later read the buffer.
+    if (run_error != JsErrorBadSerializedScript) {
+      env->serialized_scripts.push_back(std::move(buffer));
+      CHECK_JSRT_EXPECTED(env, run_error, napi_string_expected);
+      return napi_ok;
+    }
+
+    // A rejected buffer was never loaded, so Chakra will not call back for its source.
+    JsRelease(scriptVar, nullptr);
+    delete source;
+  }
+
+  CHECK_JSRT_EXPECTED(env, JsRunScript(scriptStr, ++env->source_context, url.data(), reinterpret_cast<JsValueRef*>(result)), napi_string_expected);
+
+  // Serializing parses the script once more, which only happens when the cache was missing or rejected.
+  if (produce_cb != nullptr) {
+    unsigned long size = 0;
+    if (JsSerializeScript(scriptStr, nullptr, &size) == JsNoError && size > 0) {
+      std::vector<uint8_t> produced(size);
+      if (JsSerializeScript(scriptStr, produced.data(), &size) == JsNoError) {
+        produce_cb(produced.data(), size, produce_hint);
+      }
+    }
+  }
+
+  return napi_ok;
+}
+
 napi_status napi_add_finalizer(napi_env env,
                                napi_value js_object,
                                void* native_object,
@@ -2,11 +2,18 @@
 
 #include <jsrt.h>
 #include <napi/js_native_api_types.h>
+#include <cstdint>
+#include <vector>
 
 struct napi_env__ {
   JsSourceContext source_context = JS_SOURCE_CONTEXT_NONE;
   napi_extended_error_info last_error{ nullptr, nullptr, 0, napi_ok };
   JsValueRef has_own_property_function = JS_INVALID_REFERENCE;
+
+  // Chakra reads serialized scripts lazily for as long as the runtime lives, so the
+  // buffers handed to JsRunSerializedScript are kept here and the env must only be
+  // detached after the runtime is disposed.
+  std::vector<std::vector<uint8_t>> serialized_scripts{};
 };
 
 #define RETURN_STATUS_IF_FALSE(env, condition, status)                  \
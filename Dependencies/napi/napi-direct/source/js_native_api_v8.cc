@@ -1,6 +1,7 @@
 #include <climits>  // INT_MAX
 #include <cmath>
 #include <algorithm>
+#include <memory>
 #define NAPI_EXPERIMENTAL
 #include "js_native_api_v8.h"
 #include <napi/js_native_api.h>
@@ -1371,6 +1372,78 @@ napi_status napi_create_string_latin1(napi_env env,
   return napi_clear_last_error(env);
 }
 
+namespace v8impl {
+namespace {
+
+class ExternalOneByteStringResource
+    : public v8::String::ExternalOneByteStringResource {
+ public:
+  ExternalOneByteStringResource(napi_env env,
+                                char* str,
+                                size_t length,
+                                napi_finalize finalize_callback,
+                                void* finalize_hint)
+      : _env(env),
+        _str(str),
+        _length(length),
+        _finalize_callback(finalize_callback),
+        _finalize_hint(finalize_hint) {}
+
+  // Runs from the garbage collector, so the finalizer must not call into JS.
+  ~ExternalOneByteStringResource() override {
+    if (_finalize_callback != nullptr) {
+      _finalize_callback(_env, _str, _finalize_hint);
+    }
+  }
+
+  const char* data() const override { return _str; }
+  size_t length() const override { return _length; }
+
+  void ClearFinalizer() { _finalize_callback = nullptr; }
+
+ private:
+  napi_env _env;
+  char* _str;
+  size_t _length;
+  napi_finalize _finalize_callback;
+  void* _finalize_hint;
+};
+
+}  // end of anonymous namespace
+}  // end of namespace v8impl
+
+napi_status babylon_create_external_string_latin1(
+    napi_env env,
+    char* str,
+    size_t length,
+    napi_finalize finalize_callback,
+    void* finalize_hint,
+    napi_value* result,
+    size_t* bytes_copied) {
+  CHECK_ENV(env);
+  CHECK_ARG(env, str);
+  CHECK_ARG(env, result);
+  RETURN_STATUS_IF_FALSE(env,
+      length != NAPI_AUTO_LENGTH && length <= v8::String::kMaxLength,
+      napi_invalid_arg);
+
+  auto resource = new v8impl::ExternalOneByteStringResource(
+      env, str, length, finalize_callback, finalize_hint);
+  auto str_maybe = v8::String::NewExternalOneByte(env->isolate, resource);
+  if (str_maybe.IsEmpty()) {
+    // V8 does not take ownership on failure; the caller keeps the bytes.
+    resource->ClearFinalizer();
+    delete resource;
+    return napi_set_last_error(env, napi_generic_failure);
+  }
+
+  *result = v8impl::JsValueFromV8LocalValue(str_maybe.ToLocalChecked());
+  if (bytes_copied != nullptr) {
+    *bytes_copied = 0;
+  }
+  return napi_clear_last_error(env);
+}
+
 napi_status napi_create_string_utf8(napi_env env,
                                     const char* str,
                                     size_t length,
@@ -2965,6 +3038,65 @@ napi_status napi_run_script(napi_env env,
   return napi_run_script(env, script, result);
 }
 
+napi_status napi_run_script_with_cache(napi_env env,
+                                       napi_value script,
+                                       const char* source_url,
+                                       const uint8_t* cached_data,
+                                       size_t cached_data_length,
+                                       napi_code_cache_callback produce_cb,
+                                       void* produce_hint,
+                                       napi_value* result) {
+  NAPI_PREAMBLE(env);
+  CHECK_ARG(env, script);
+  CHECK_ARG(env, result);
+
+  v8::Local<v8::Value> v8_script = v8impl::V8LocalValueFromJsValue(script);
+
+  if (!v8_script->IsString()) {
+    return napi_set_last_error(env, napi_string_expected);
+  }
+
+  v8::Local<v8::Context> context = env->context();
+
+  v8::Local<v8::String> v8_source_url;
+  CHECK_NEW_FROM_UTF8(env, v8_source_url, source_url);
+  v8::ScriptOrigin origin(v8_source_url);
+
+  // The source takes ownership of the CachedData object but not of the buffer.
+  v8::ScriptCompiler::CachedData* consumed = nullptr;
+  v8::ScriptCompiler::CompileOptions options =
+      v8::ScriptCompiler::kNoCompileOptions;
+  if (cached_data != nullptr && cached_data_length > 0) {
+    consumed = new v8::ScriptCompiler::CachedData(
+        cached_data, static_cast<int>(cached_data_length));
+    options = v8::ScriptCompiler::kConsumeCodeCache;
+  }
+
+  v8::ScriptCompiler::Source source(
+      v8::Local<v8::String>::Cast(v8_script), origin, consumed);
+
+  auto maybe_script = v8::ScriptCompiler::Compile(context, &source, options);
+  CHECK_MAYBE_EMPTY(env, maybe_script, napi_generic_failure);
+
+  v8::Local<v8::Script> compiled = maybe_script.ToLocalChecked();
+  auto script_result = compiled->Run(context);
+  CHECK_MAYBE_EMPTY(env, script_result, napi_generic_failure);
+
+  // Serialize after running so that functions compiled lazily during the
+  // first run are part of the cache as well.
+  if (produce_cb != nullptr && (consumed == nullptr || consumed->rejected)) {
+    std::unique_ptr<v8::ScriptCompiler::CachedData> produced{
+        v8::ScriptCompiler::CreateCodeCache(compiled->GetUnboundScript())};
+    if (produced != nullptr && produced->length > 0) {
+      produce_cb(produced->data, static_cast<size_t>(produced->length),
+                 produce_hint);
+    }
+  }
+
+  *result = v8impl::JsValueFromV8LocalValue(script_result.ToLocalChecked());
+  return GET_RETURN_STATUS(env);
+}
+
 napi_status napi_add_finalizer(napi_env env,
                                napi_value js_object,
                                void* native_object,
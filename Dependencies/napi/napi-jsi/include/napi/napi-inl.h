@@ -797,7 +797,10 @@ inline ArrayBuffer ArrayBuffer::New(napi_env env,
                                     void* externalData,
                                     size_t byteLength,
                                     Finalizer finalizeCallback) {
-  return New(env, externalData, byteLength, finalizeCallback, nullptr);
+  // jsi copies external data (see above), so the caller's buffer is released right away
+  ArrayBuffer arrayBuffer{New(env, externalData, byteLength)};
+  finalizeCallback(Env(env), externalData);
+  return arrayBuffer;
 }
 
 template <typename Finalizer, typename Hint>
@@ -806,12 +809,10 @@ inline ArrayBuffer ArrayBuffer::New(napi_env env,
                                     size_t byteLength,
                                     Finalizer finalizeCallback,
                                     Hint* finalizeHint) {
-  (void)env;
-  (void)externalData;
-  (void)byteLength;
-  (void)finalizeCallback;
-  (void)finalizeHint;
-  throw std::runtime_error{"TODO"};
+  // jsi copies external data (see above), so the caller's buffer is released right away
+  ArrayBuffer arrayBuffer{New(env, externalData, byteLength)};
+  finalizeCallback(Env(env), externalData, finalizeHint);
+  return arrayBuffer;
 }
 
 inline ArrayBuffer::ArrayBuffer() {
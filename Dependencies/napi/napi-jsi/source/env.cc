@@ -18,4 +18,46 @@ namespace Napi
     napi_env__* env_ptr{env};
     return {env_ptr, env_ptr->rt.evaluateJavaScript(std::make_shared<facebook::jsi::StringBuffer>(string), sourceUrl)};
   }
+
+  Napi::Value Eval(Napi::Env env, const char* string, const char* sourceUrl, const std::vector<uint8_t>& /*cachedData*/, std::vector<uint8_t>& /*producedData*/)
+  {
+    // JSI has no portable code cache API; engines that support one use it internally.
+    return Eval(env, string, sourceUrl);
+  }
+
+  Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl)
+  {
+    size_t bytesCopied{};
+    return Eval(env, source, sourceUrl, bytesCopied);
+  }
+
+  Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl, const std::vector<uint8_t>& /*cachedData*/, std::vector<uint8_t>& /*producedData*/)
+  {
+    return Eval(env, source, sourceUrl);
+  }
+
+  Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl, size_t& bytesCopied)
+  {
+    // JSI only evaluates buffers, so the source is copied out of the string once and the
+    // buffer takes ownership of that copy.
+    napi_env__* env_ptr{env};
+    auto buffer = std::make_shared<facebook::jsi::StringBuffer>(source.Utf8Value());
+    bytesCopied = buffer->size();
+    return {env_ptr, env_ptr->rt.evaluateJavaScript(std::move(buffer), sourceUrl)};
+  }
+
+  Napi::Value Eval(Napi::Env env, Napi::String source, const char* sourceUrl, const std::vector<uint8_t>& /*cachedData*/, std::vector<uint8_t>& /*producedData*/, size_t& bytesCopied)
+  {
+    return Eval(env, source, sourceUrl, bytesCopied);
+  }
+
+  Napi::String CreateExternalLatin1String(Napi::Env env, const char* data, size_t length, std::function<void()> release, size_t& bytesCopied)
+  {
+    // Latin1 data passed here is expected to be ASCII, which is also valid UTF-8 and is kept
+    // one byte per character by the engine's copy.
+    auto result = Napi::String::New(env, data, length);
+    release();
+    bytesCopied = length;
+    return result;
+  }
 }
@@ -2,6 +2,9 @@
 
 #include <napi/env.h>
 
+#include <cstddef>
+#include <string>
+
 namespace Babylon::Plugins::NativeEngine
 {
     void InitializeGraphics(void* windowPtr, size_t width, size_t height);
@@ -11,4 +14,31 @@ namespace Babylon::Plugins::NativeEngine
     void Reinitialize(Napi::Env env, void* windowPtr, size_t width, size_t height);
 
     void DeinitializeGraphics();
+
+    // Stores compiled shaders in an existing, writable directory so that later launches can
+    // skip shader compilation. Call before any program is created.
+    enum class ShaderOptimization
+    {
+        None,
+        Performance,
+        Size
+    };
+
+    // Chooses how shaders are optimized between glslang and SPIRV-Cross, which takes longer to
+    // compile but can make the generated shaders smaller and faster. Has no effect unless built
+    // with BABYLON_NATIVE_SPIRV_OPTIMIZER. Call before any program is created; loaded shader packs
+    // only apply if they were compiled with the same optimization.
+    void SetShaderOptimization(ShaderOptimization optimization);
+
+    void EnableShaderCache(std::string directory);
+
+    // Makes the programs in a pack written by the ShaderPackCompiler tool available without
+    // compiling them. Packs only apply to the renderer they were compiled for. Throws if the file
+    // cannot be read or is not a shader pack of this version.
+    void LoadShaderPack(const std::string& path);
+
+    // Stores the program binaries produced by the graphics driver, where the renderer supports it,
+    // so that later launches can skip linking. The directory is created if needed; the least
+    // recently used binaries are removed once the total exceeds maxSize bytes.
+    void EnableProgramBinaryCache(std::string directory, size_t maxSize = 64 * 1024 * 1024);
 }
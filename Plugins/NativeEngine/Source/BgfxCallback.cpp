@@ -1,4 +1,5 @@
 #include "BgfxCallback.h"
+#include "ProgramBinaryCache.h"
 #include <bx/bx.h>
 #include <bx/string.h>
 #include <bx/platform.h>
@@ -71,18 +72,19 @@ namespace Babylon
     {
     }
 
-    uint32_t BgfxCallback::cacheReadSize(uint64_t /*id*/)
+    uint32_t BgfxCallback::cacheReadSize(uint64_t id)
     {
-        return 0;
+        return ProgramBinaryCache::GetInstance().GetSize(id);
     }
 
-    bool BgfxCallback::cacheRead(uint64_t /*id*/, void* /*data*/, uint32_t /*size*/)
+    bool BgfxCallback::cacheRead(uint64_t id, void* data, uint32_t size)
     {
-        return false;
+        return ProgramBinaryCache::GetInstance().Read(id, {static_cast<uint8_t*>(data), static_cast<std::ptrdiff_t>(size)});
     }
 
-    void BgfxCallback::cacheWrite(uint64_t /*id*/, const void* /*data*/, uint32_t /*size*/)
+    void BgfxCallback::cacheWrite(uint64_t id, const void* data, uint32_t size)
     {
+        ProgramBinaryCache::GetInstance().Write(id, {static_cast<const uint8_t*>(data), static_cast<std::ptrdiff_t>(size)});
     }
 
     void BgfxCallback::screenShot(const char* /*filePath*/, uint32_t width, uint32_t height, uint32_t pitch, const void* data, uint32_t /*size*/, bool yflip)
@@ -0,0 +1,177 @@
+#include "CommandBuffer.h"
+
+#include <algorithm>
+
+namespace Babylon
+{
+    namespace
+    {
+        // A handle is its slot index plus one in the low bits and the slot's generation in the high bits.
+        constexpr uint32_t INDEX_BITS{20};
+        constexpr uint32_t INDEX_MASK{(1u << INDEX_BITS) - 1};
+        constexpr uint32_t GENERATION_MASK{(1u << (32 - INDEX_BITS)) - 1};
+        constexpr size_t MAX_SLOTS{INDEX_MASK};
+
+        uint32_t GetIndex(uint32_t handle)
+        {
+            return (handle & INDEX_MASK) - 1;
+        }
+
+        uint32_t GetGeneration(uint32_t handle)
+        {
+            return handle >> INDEX_BITS;
+        }
+    }
+
+    void CommandHandleTable::AddResource(void* resource, CommandHandleType type, void* owner)
+    {
+        const auto [it, inserted] = m_resources.try_emplace(resource);
+        if (!inserted)
+        {
+            return;
+        }
+
+        it->second.Type = type;
+        it->second.Owner = owner;
+
+        if (owner != nullptr)
+        {
+            const auto found = m_resources.find(owner);
+            if (found != m_resources.end())
+            {
+                found->second.Owned.push_back(resource);
+            }
+        }
+    }
+
+    void CommandHandleTable::RemoveResource(void* resource)
+    {
+        auto found = m_resources.find(resource);
+        if (found == m_resources.end())
+        {
+            return;
+        }
+
+        auto removed = std::move(found->second);
+        m_resources.erase(found);
+
+        // The handles stay allocated until script deletes them, but no longer reach the resource.
+        for (const auto index : removed.Slots)
+        {
+            m_slots[index].Target = {};
+        }
+
+        for (auto* owned : removed.Owned)
+        {
+            RemoveResource(owned);
+        }
+
+        if (removed.Owner != nullptr)
+        {
+            const auto owner = m_resources.find(removed.Owner);
+            if (owner != m_resources.end())
+            {
+                auto& owned = owner->second.Owned;
+                owned.erase(std::remove(owned.begin(), owned.end(), resource), owned.end());
+            }
+        }
+    }
+
+    void CommandHandleTable::Clear()
+    {
+        m_resources.clear();
+        for (auto& slot : m_slots)
+        {
+            slot.Target = {};
+        }
+    }
+
+    uint32_t CommandHandleTable::Create(void* resource)
+    {
+        const auto found = m_resources.find(resource);
+        if (found == m_resources.end())
+        {
+            return 0;
+        }
+
+        uint32_t index{};
+        if (!m_freeSlots.empty())
+        {
+            index = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else if (m_slots.size() < MAX_SLOTS)
+        {
+            index = static_cast<uint32_t>(m_slots.size());
+            m_slots.emplace_back();
+        }
+        else
+        {
+            return 0;
+        }
+
+        auto& slot = m_slots[index];
+        slot.Target = {resource, found->second.Type};
+        slot.Allocated = true;
+        found->second.Slots.push_back(index);
+
+        return (slot.Generation << INDEX_BITS) | (index + 1);
+    }
+
+    bool CommandHandleTable::Delete(uint32_t handle)
+    {
+        if (FindSlot(handle) == nullptr)
+        {
+            return false;
+        }
+
+        const auto index = GetIndex(handle);
+        auto& slot = m_slots[index];
+
+        const auto resource = m_resources.find(slot.Target.Resource);
+        if (resource != m_resources.end())
+        {
+            auto& slots = resource->second.Slots;
+            slots.erase(std::remove(slots.begin(), slots.end(), index), slots.end());
+        }
+
+        slot.Target = {};
+        slot.Allocated = false;
+        slot.Generation = (slot.Generation + 1) & GENERATION_MASK;
+        m_freeSlots.push_back(index);
+        return true;
+    }
+
+    const CommandHandleTable::Entry* CommandHandleTable::Find(uint32_t handle) const
+    {
+        const auto* slot = FindSlot(handle);
+        if (slot == nullptr || slot->Target.Resource == nullptr)
+        {
+            return nullptr;
+        }
+
+        return &slot->Target;
+    }
+
+    const CommandHandleTable::Slot* CommandHandleTable::FindSlot(uint32_t handle) const
+    {
+        if ((handle & INDEX_MASK) == 0)
+        {
+            return nullptr;
+        }
+
+        const auto index = GetIndex(handle);
+        if (index >= m_slots.size())
+        {
+            return nullptr;
+        }
+
+        const auto& slot = m_slots[index];
+        if (!slot.Allocated || slot.Generation != GetGeneration(handle))
+        {
+            return nullptr;
+        }
+
+        return &slot;
+    }
+}
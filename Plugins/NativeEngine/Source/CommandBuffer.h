@@ -0,0 +1,169 @@
+#pragma once
+
+#include <napi/napi.h>
+
+#include <gsl/gsl>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace Babylon
+{
+    // Commands accepted by NativeEngine::SubmitCommands. A command buffer is a sequence of
+    // little-endian 32-bit words: each command is its type followed by its arguments. Resources
+    // are referenced by the integer handles returned from createCommandHandle(resource); booleans
+    // are 0 or 1.
+    // The values are part of the JavaScript contract and must not change.
+    enum class CommandType : uint32_t
+    {
+        SetProgram = 0,           // program
+        SetState = 1,             // culling, zOffset (float), reverseSide
+        SetDepthTest = 2,         // enable
+        SetDepthWrite = 3,        // enable
+        SetColorWrite = 4,        // enable
+        SetBlendMode = 5,         // blendMode
+        SetInt = 6,               // uniform, value (int32)
+        SetFloat = 7,             // uniform, x
+        SetFloat2 = 8,            // uniform, x, y
+        SetFloat3 = 9,            // uniform, x, y, z
+        SetFloat4 = 10,           // uniform, x, y, z, w
+        SetMatrix = 11,           // uniform, 16 floats
+        SetTexture = 12,          // uniform, texture
+        BindVertexArray = 13,     // vertexArray
+        DrawIndexed = 14,         // fillMode, elementStart, elementCount
+        Draw = 15,                // fillMode, verticesStart, verticesCount
+    };
+
+    // The kind of resource a command handle refers to. Commands check it before using the
+    // resource, so a handle to one kind of resource cannot be read as another.
+    enum class CommandHandleType : uint32_t
+    {
+        Program,
+        Uniform,
+        Texture,
+        VertexArray,
+    };
+
+    // Maps the integer handles used by command buffers to the resources they refer to. Resources are
+    // added when they are created, so a handle takes its type from the resource rather than from
+    // script, and removed when they are deleted, which invalidates every handle to them. A handle
+    // also carries the generation of its slot, so a deleted handle never reaches the resource of a
+    // later handle reusing the slot. Only used on the JavaScript thread.
+    class CommandHandleTable final
+    {
+    public:
+        struct Entry
+        {
+            void* Resource{};
+            CommandHandleType Type{};
+        };
+
+        // Resources with an owner, such as the uniforms of a program, are removed with it.
+        void AddResource(void* resource, CommandHandleType type, void* owner = nullptr);
+        void RemoveResource(void* resource);
+        void Clear();
+
+        // Returns 0, which is never a valid handle, when the resource was not added or no slot is left.
+        uint32_t Create(void* resource);
+        bool Delete(uint32_t handle);
+
+        // Returns nullptr when the handle is invalid or its resource has been removed.
+        const Entry* Find(uint32_t handle) const;
+
+    private:
+        struct Slot
+        {
+            Entry Target{};
+            uint32_t Generation{};
+            bool Allocated{};
+        };
+
+        struct Resource
+        {
+            CommandHandleType Type{};
+            void* Owner{};
+            std::vector<void*> Owned{};
+            std::vector<uint32_t> Slots{};
+        };
+
+        const Slot* FindSlot(uint32_t handle) const;
+
+        std::unordered_map<void*, Resource> m_resources{};
+        std::vector<Slot> m_slots{};
+        std::vector<uint32_t> m_freeSlots{};
+    };
+
+    class CommandBufferReader final
+    {
+    public:
+        CommandBufferReader(Napi::Env env, gsl::span<const uint8_t> bytes)
+            : m_env{env}
+            , m_bytes{bytes}
+        {
+        }
+
+        bool HasCommands() const
+        {
+            return m_offset < static_cast<size_t>(m_bytes.size());
+        }
+
+        CommandType ReadCommandType()
+        {
+            return static_cast<CommandType>(Read<uint32_t>());
+        }
+
+        uint32_t ReadUint32()
+        {
+            return Read<uint32_t>();
+        }
+
+        int32_t ReadInt32()
+        {
+            return Read<int32_t>();
+        }
+
+        bool ReadBool()
+        {
+            return Read<uint32_t>() != 0;
+        }
+
+        float ReadFloat()
+        {
+            return Read<float>();
+        }
+
+        template<size_t count>
+        std::array<float, count> ReadFloats()
+        {
+            std::array<float, count> values{};
+            for (auto& value : values)
+            {
+                value = Read<float>();
+            }
+            return values;
+        }
+
+    private:
+        template<typename T>
+        T Read()
+        {
+            if (static_cast<size_t>(m_bytes.size()) - m_offset < sizeof(T))
+            {
+                throw Napi::Error::New(m_env, "Truncated command buffer.");
+            }
+
+            // The buffer may be a view at any byte offset, so words are not assumed to be aligned.
+            T value;
+            std::memcpy(&value, m_bytes.data() + m_offset, sizeof(T));
+            m_offset += sizeof(T);
+            return value;
+        }
+
+        Napi::Env m_env;
+        gsl::span<const uint8_t> m_bytes;
+        size_t m_offset{0};
+    };
+}
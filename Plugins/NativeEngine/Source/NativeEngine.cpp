@@ -1,23 +1,17 @@
 #include "NativeEngine.h"
-#include <spirv_cross.hpp>
-#include <spirv_parser.hpp>
 #include "ShaderCompiler.h"
+#include "ProgramBinaryCache.h"
+#include "ProgramCompiler.h"
 #include <arcana/threading/task.h>
 #include <arcana/threading/task_schedulers.h>
 
 #include <napi/env.h>
 
+#include <Babylon/StartupProfiler.h>
+
 #include <bgfx/bgfx.h>
 #include <bgfx/platform.h>
 
-// TODO: this needs to be fixed in bgfx
-namespace bgfx
-{
-    uint16_t attribToId(Attrib::Enum _attr);
-}
-
-#define BGFX_UNIFORM_FRAGMENTBIT UINT8_C(0x10) // Copy-pasta from bgfx_p.h
-#define BGFX_UNIFORM_SAMPLERBIT UINT8_C(0x20)  // Copy-pasta from bgfx_p.h
 #define BGFX_RESET_FLAGS (BGFX_RESET_VSYNC | BGFX_RESET_MSAA_X4 | BGFX_RESET_MAXANISOTROPY)
 
 #include <bimg/bimg.h>
@@ -26,117 +20,132 @@ namespace bgfx
 
 #include <bx/math.h>
 
+#include <memory>
+#include <optional>
 #include <queue>
 #include <regex>
 #include <sstream>
+#include <utility>
 #include <variant>
 
 namespace Babylon
 {
     namespace
     {
-        template<typename AppendageT>
-        inline void AppendBytes(std::vector<uint8_t>& bytes, const AppendageT appendage)
-        {
-            auto ptr = reinterpret_cast<const uint8_t*>(&appendage);
-            auto stride = static_cast<std::ptrdiff_t>(sizeof(AppendageT));
-            bytes.insert(bytes.end(), ptr, ptr + stride);
-        }
+        // The CommandHandleType of the resources a command handle must refer to to be read as T.
+        template<typename T>
+        struct CommandHandleTypeOf;
 
-        template<typename AppendageT = std::string&>
-        inline void AppendBytes(std::vector<uint8_t>& bytes, const std::string& string)
+        template<>
+        struct CommandHandleTypeOf<ProgramData>
         {
-            auto ptr = reinterpret_cast<const uint8_t*>(string.data());
-            auto stride = static_cast<std::ptrdiff_t>(string.length());
-            bytes.insert(bytes.end(), ptr, ptr + stride);
-        }
+            static constexpr auto Value{CommandHandleType::Program};
+        };
 
-        template<typename ElementT>
-        inline void AppendBytes(std::vector<uint8_t>& bytes, const gsl::span<ElementT>& data)
+        template<>
+        struct CommandHandleTypeOf<UniformInfo>
         {
-            auto ptr = reinterpret_cast<const uint8_t*>(data.data());
-            auto stride = static_cast<std::ptrdiff_t>(data.size() * sizeof(ElementT));
-            bytes.insert(bytes.end(), ptr, ptr + stride);
-        }
+            static constexpr auto Value{CommandHandleType::Uniform};
+        };
 
-        struct NonSamplerUniformsInfo
+        template<>
+        struct CommandHandleTypeOf<TextureData>
         {
-            struct Uniform
-            {
-                enum class TypeEnum
-                {
-                    Vec4,
-                    Mat4
-                };
-
-                std::string Name{};
-                uint32_t Offset{};
-                uint16_t RegisterSize{};
-                TypeEnum Type{};
-            };
+            static constexpr auto Value{CommandHandleType::Texture};
+        };
 
-            uint16_t ByteSize{};
-            std::vector<Uniform> Uniforms{};
+        template<>
+        struct CommandHandleTypeOf<VertexArray>
+        {
+            static constexpr auto Value{CommandHandleType::VertexArray};
         };
 
-        void AppendUniformBuffer(std::vector<uint8_t>& bytes, const NonSamplerUniformsInfo& uniformBuffer, bool isFragment)
+        void CacheUniformHandles(bgfx::ShaderHandle shader, std::unordered_map<std::string, UniformInfo>& cache)
         {
-            const uint8_t fragmentBit = (isFragment ? BGFX_UNIFORM_FRAGMENTBIT : 0);
+            const auto MAX_UNIFORMS = 256;
+            bgfx::UniformHandle uniforms[MAX_UNIFORMS];
+            auto numUniforms = bgfx::getShaderUniforms(shader, uniforms, MAX_UNIFORMS);
 
-            for (const auto& uniform : uniformBuffer.Uniforms)
+            bgfx::UniformInfo info{};
+            for (uint8_t idx = 0; idx < numUniforms; idx++)
             {
-                bgfx::UniformType::Enum bgfxType;
-
-                switch (uniform.Type)
-                {
-                    case NonSamplerUniformsInfo::Uniform::TypeEnum::Vec4:
-                        bgfxType = bgfx::UniformType::Vec4;
-                        break;
-                    case NonSamplerUniformsInfo::Uniform::TypeEnum::Mat4:
-                        bgfxType = bgfx::UniformType::Mat4;
-                        break;
-                    default:
-                        throw std::runtime_error{"Unrecognized uniform type."};
-                }
-
-                AppendBytes(bytes, static_cast<uint8_t>(uniform.Name.size()));
-                AppendBytes(bytes, uniform.Name);
-                AppendBytes(bytes, static_cast<uint8_t>(bgfxType | fragmentBit));
-                AppendBytes(bytes, static_cast<uint8_t>(0)); // Value "num" not used by D3D11 pipeline.
-                AppendBytes(bytes, static_cast<uint16_t>(uniform.Offset));
-                AppendBytes(bytes, static_cast<uint16_t>(uniform.RegisterSize));
+                bgfx::getUniformInfo(uniforms[idx], info);
+                cache[info.name].Handle = uniforms[idx];
             }
         }
 
-        void AppendSamplers(std::vector<uint8_t>& bytes, const spirv_cross::Compiler& compiler, const spirv_cross::SmallVector<spirv_cross::Resource>& samplers, bool /*isFragment*/, std::unordered_map<std::string, UniformInfo>& cache)
+        // Gives every non-sampler uniform of the program a slot in its uniform block. registerSizes
+        // holds the number of vec4 registers each uniform occupies, arrays included.
+        void LayOutUniformBlock(ProgramData& program, const std::unordered_map<std::string, uint16_t>& registerSizes)
         {
-            for (const spirv_cross::Resource& sampler : samplers)
+            uint32_t offset{0};
+            for (auto* uniforms : {&program.VertexUniformNameToInfo, &program.FragmentUniformNameToInfo})
             {
-                AppendBytes(bytes, static_cast<uint8_t>(sampler.name.size()));
-                AppendBytes(bytes, sampler.name);
-                AppendBytes(bytes, static_cast<uint8_t>(bgfx::UniformType::Sampler | BGFX_UNIFORM_SAMPLERBIT));
+                for (auto& [name, uniform] : *uniforms)
+                {
+                    if (!bgfx::isValid(uniform.Handle))
+                    {
+                        continue;
+                    }
+
+                    bgfx::UniformInfo info{};
+                    bgfx::getUniformInfo(uniform.Handle, info);
+                    if (info.type == bgfx::UniformType::Sampler)
+                    {
+                        continue;
+                    }
 
-                // TODO : These values (num, regIndex, regCount) are only used by Vulkan and should be set for that API
-                AppendBytes(bytes, static_cast<uint8_t>(0));
-                AppendBytes(bytes, static_cast<uint16_t>(0));
-                AppendBytes(bytes, static_cast<uint16_t>(0));
+                    // A uniform used by both stages has one value.
+                    const auto existing = std::find_if(program.UniformSlots.begin(), program.UniformSlots.end(), [&uniform](const auto& slot) {
+                        return slot.Handle.idx == uniform.Handle.idx;
+                    });
+                    if (existing != program.UniformSlots.end())
+                    {
+                        uniform.Slot = static_cast<uint16_t>(existing - program.UniformSlots.begin());
+                        continue;
+                    }
 
-                cache[sampler.name].Stage = static_cast<uint8_t>(compiler.get_decoration(sampler.id, spv::DecorationBinding));
+                    const uint16_t elementSize = info.type == bgfx::UniformType::Mat4 ? 16 : info.type == bgfx::UniformType::Mat3 ? 9 : 4;
+                    const auto registerSize = registerSizes.find(name);
+                    const uint32_t capacity = std::max<uint32_t>(registerSize == registerSizes.end() ? 0 : registerSize->second * 4u, elementSize * std::max<uint32_t>(info.num, 1));
+
+                    uniform.Slot = static_cast<uint16_t>(program.UniformSlots.size());
+                    program.UniformSlots.push_back({uniform.Handle, offset, capacity, elementSize});
+                    offset += capacity;
+                }
             }
+
+            program.UniformBlock.assign(offset, 0.f);
+            program.UniformValues = program.UniformBlock;
         }
 
-        void CacheUniformHandles(bgfx::ShaderHandle shader, std::unordered_map<std::string, UniformInfo>& cache)
+        void InitializeProgram(ProgramData& programData, const CompiledProgram& compiledProgram)
         {
-            const auto MAX_UNIFORMS = 256;
-            bgfx::UniformHandle uniforms[MAX_UNIFORMS];
-            auto numUniforms = bgfx::getShaderUniforms(shader, uniforms, MAX_UNIFORMS);
+            for (const auto& [name, stage] : compiledProgram.VertexSamplerStages)
+            {
+                programData.VertexUniformNameToInfo[name].Stage = stage;
+            }
 
-            bgfx::UniformInfo info{};
-            for (uint8_t idx = 0; idx < numUniforms; idx++)
+            for (const auto& [name, stage] : compiledProgram.FragmentSamplerStages)
             {
-                bgfx::getUniformInfo(uniforms[idx], info);
-                cache[info.name].Handle = uniforms[idx];
+                programData.FragmentUniformNameToInfo[name].Stage = stage;
             }
+
+            // bgfx hands out another reference to the shader and program objects of identical
+            // blobs, so a cached program costs little more than its uniform handle lookups, and
+            // stages that compile to the same blob share one bgfx::ShaderHandle. The program holds
+            // the shader references and releases them with its own.
+            const auto& vertexBytes = compiledProgram.VertexBytes;
+            auto vertexShader = bgfx::createShader(bgfx::copy(vertexBytes.data(), static_cast<uint32_t>(vertexBytes.size())));
+            CacheUniformHandles(vertexShader, programData.VertexUniformNameToInfo);
+            programData.AttributeLocations = compiledProgram.AttributeLocations;
+
+            const auto& fragmentBytes = compiledProgram.FragmentBytes;
+            auto fragmentShader = bgfx::createShader(bgfx::copy(fragmentBytes.data(), static_cast<uint32_t>(fragmentBytes.size())));
+            CacheUniformHandles(fragmentShader, programData.FragmentUniformNameToInfo);
+
+            programData.Program = bgfx::createProgram(vertexShader, fragmentShader, true);
+            LayOutUniformBlock(programData, compiledProgram.UniformRegisterSizes);
         }
 
         enum class WebGLAttribType
@@ -166,6 +175,44 @@ namespace Babylon
             }
         }
 
+        // Hands bytes over to bgfx without copying them again. They are freed once bgfx has
+        // uploaded them.
+        const bgfx::Memory* MakeRef(std::vector<uint8_t> bytes)
+        {
+            auto* owned = new std::vector<uint8_t>{std::move(bytes)};
+            return bgfx::makeRef(
+                owned->data(), static_cast<uint32_t>(owned->size()), [](void*, void* userData) {
+                    delete static_cast<std::vector<uint8_t>*>(userData);
+                },
+                owned);
+        }
+
+        // The number bgfx::frame returned last, see NativeEngine::Frame. Transient buffers compare
+        // it with the frame they were filled in, since their memory is only valid until the next
+        // bgfx::frame.
+        uint32_t s_frameNumber{};
+
+        // bgfx::VertexLayout::add may only be called between begin and end, and packs attributes
+        // in the order they are added, so the offsets and stride are set before end hashes them.
+        bgfx::VertexLayout CreateVertexLayout(gsl::span<const VertexArray::Attribute> attributes, uint16_t stride)
+        {
+            bgfx::VertexLayout layout{};
+            layout.begin();
+            for (const auto& attribute : attributes)
+            {
+                layout.add(attribute.attrib, attribute.count, attribute.type, attribute.normalized);
+            }
+
+            for (const auto& attribute : attributes)
+            {
+                layout.m_offset[attribute.attrib] = attribute.offset;
+            }
+
+            layout.m_stride = stride;
+            layout.end();
+            return layout;
+        }
+
         // Must match constants.ts in Babylon.js.
         constexpr std::array<uint64_t, 11> ALPHA_MODE{
             // ALPHA_DISABLE
@@ -298,88 +345,16 @@ namespace Babylon
             texture->Height = height;
         }
 
-        NonSamplerUniformsInfo CollectNonSamplerUniforms(spirv_cross::Parser& parser, const spirv_cross::Compiler& compiler)
+        // Command buffers carry only the components a command uses; uniforms always take four.
+        template<size_t size>
+        std::array<float, 4> ReadUniformVector(CommandBufferReader& reader)
         {
-            NonSamplerUniformsInfo info{};
-
-            const auto& resources = compiler.get_shader_resources();
-            if (resources.uniform_buffers.size() == 1)
+            std::array<float, 4> values{};
+            for (size_t index = 0; index < size; ++index)
             {
-                const auto& uniformBuffer = resources.uniform_buffers[0];
-                const auto& type = compiler.get_type(uniformBuffer.base_type_id);
-                assert(type.basetype == spirv_cross::SPIRType::BaseType::Struct);
-
-                info.ByteSize = static_cast<uint16_t>(compiler.get_declared_struct_size(type));
-
-                info.Uniforms.resize(type.member_types.size());
-                for (uint32_t index = 0; index < type.member_types.size(); ++index)
-                {
-                    auto& uniform = info.Uniforms[index];
-
-                    uniform.Name = compiler.get_member_name(uniformBuffer.base_type_id, index);
-                    uniform.Offset = compiler.get_member_decoration(uniformBuffer.base_type_id, index, spv::DecorationOffset);
-                    
-                    const auto spirType = compiler.get_type(type.member_types[index]);
-                    if (spirType.columns == 1 && 1 <= spirType.vecsize && spirType.vecsize <= 4)
-                    {
-                        uniform.Type = NonSamplerUniformsInfo::Uniform::TypeEnum::Vec4;
-                        uniform.RegisterSize = 1;
-                    }
-                    else if (spirType.columns == 4 && spirType.vecsize == 4)
-                    {
-                        uniform.Type = NonSamplerUniformsInfo::Uniform::TypeEnum::Mat4;
-                        uniform.RegisterSize = 4;
-                    }
-                    else
-                    {
-                        throw std::runtime_error{"Unrecognized uniform type."};
-                    }
-
-                    for (const auto size : spirType.array)
-                    {
-                        uniform.RegisterSize *= static_cast<uint16_t>(size);
-                    }
-                }
-            }
-            else
-            {
-                info.ByteSize = 0;
-                parser.get_parsed_ir().for_each_typed_id<spirv_cross::SPIRVariable>([&](uint32_t id, spirv_cross::SPIRVariable& var) {
-                    auto& type = compiler.get_type_from_variable(id);
-                    if (var.storage == spv::StorageClassUniformConstant &&
-                        type.basetype != spirv_cross::SPIRType::BaseType::SampledImage &&
-                        type.basetype != spirv_cross::SPIRType::BaseType::Sampler)
-                    {
-                        auto& uniform = info.Uniforms.emplace_back();
-                        uniform.Name = compiler.get_name(id);
-                        uniform.Offset = 0; // Not actually used for anything by OpenGL.
-                        
-                        if (type.columns == 1 && 1 <= type.vecsize && type.vecsize <= 4)
-                        {
-                            uniform.Type = NonSamplerUniformsInfo::Uniform::TypeEnum::Vec4;
-                            uniform.RegisterSize = 1;
-                        }
-                        else if (type.columns == 4 && type.vecsize == 4)
-                        {
-                            uniform.Type = NonSamplerUniformsInfo::Uniform::TypeEnum::Mat4;
-                            uniform.RegisterSize = 4;
-                        }
-                        else
-                        {
-                            throw std::runtime_error{"Unrecognized uniform type."};
-                        }
-
-                        for (const auto size : type.array)
-                        {
-                            uniform.RegisterSize *= static_cast<uint16_t>(size);
-                        }
-
-                        info.ByteSize += 4 * uniform.RegisterSize;
-                    }
-                });
+                values[index] = reader.ReadFloat();
             }
-
-            return info;
+            return values;
         }
     }
 
@@ -403,26 +378,123 @@ namespace Babylon
         }
     };
 
+    // A JavaScript array whose bytes bgfx reads in place rather than from a copy. The array is
+    // kept alive until bgfx no longer needs it. Created and destroyed on the JavaScript thread.
+    class ArrayReference final
+    {
+    public:
+        ArrayReference(std::shared_ptr<ArrayReferenceQueue> queue, const Napi::TypedArray& array)
+            : m_queue{std::move(queue)}
+            , m_reference{Napi::Persistent(array)}
+            , m_data{array.As<Napi::Uint8Array>().Data()}
+            , m_size{static_cast<uint32_t>(array.ByteLength())}
+        {
+        }
+
+        // Hands the reference over to bgfx. bgfx may call the release function from its render
+        // thread, so the reference goes back to the queue, which the engine drains.
+        static const bgfx::Memory* MakeRef(std::unique_ptr<ArrayReference> reference)
+        {
+            auto* released = reference.release();
+            released->m_queue->AddPending();
+            return bgfx::makeRef(
+                released->m_data, released->m_size, [](void*, void* userData) {
+                    std::unique_ptr<ArrayReference> reference{static_cast<ArrayReference*>(userData)};
+                    const auto queue = reference->m_queue;
+                    queue->Release(std::move(reference));
+                },
+                released);
+        }
+
+    private:
+        std::shared_ptr<ArrayReferenceQueue> m_queue{};
+        Napi::Reference<Napi::TypedArray> m_reference{};
+        const uint8_t* m_data{};
+        uint32_t m_size{};
+    };
+
+    ArrayReferenceQueue::~ArrayReferenceQueue() = default;
+
+    void ArrayReferenceQueue::AddPending()
+    {
+        std::scoped_lock lock{m_mutex};
+        ++m_pendingCount;
+    }
+
+    bool ArrayReferenceQueue::HasPending() const
+    {
+        std::scoped_lock lock{m_mutex};
+        return m_pendingCount != 0;
+    }
+
+    void ArrayReferenceQueue::Release(std::unique_ptr<ArrayReference> reference)
+    {
+        std::scoped_lock lock{m_mutex};
+        --m_pendingCount;
+        if (m_closed)
+        {
+            // The JavaScript runtime may be gone, so the reference can't be deleted.
+            reference.release();
+            return;
+        }
+
+        m_released.push_back(std::move(reference));
+    }
+
+    void ArrayReferenceQueue::DeleteReleased()
+    {
+        std::vector<std::unique_ptr<ArrayReference>> released{};
+        {
+            std::scoped_lock lock{m_mutex};
+            released.swap(m_released);
+        }
+    }
+
+    void ArrayReferenceQueue::Close()
+    {
+        // Closes and drains under one lock, so that no reference is left for whichever thread
+        // destroys the queue.
+        std::vector<std::unique_ptr<ArrayReference>> released{};
+        {
+            std::scoped_lock lock{m_mutex};
+            m_closed = true;
+            released.swap(m_released);
+        }
+    }
+
     class IndexBufferData final : private VariantHandleHolder<bgfx::IndexBufferHandle, bgfx::DynamicIndexBufferHandle>
     {
     public:
-        IndexBufferData(const Napi::TypedArray& bytes, uint16_t flags, bool dynamic)
+        IndexBufferData(std::shared_ptr<ArrayReferenceQueue> arrayReferences, const Napi::TypedArray& bytes, uint16_t flags, bool dynamic)
         {
-            const bgfx::Memory* memory = bgfx::copy(bytes.As<Napi::Uint8Array>().Data(), static_cast<uint32_t>(bytes.ByteLength()));
             if (!dynamic)
             {
-                m_handle = bgfx::createIndexBuffer(memory, flags);
+                // Static buffers are uploaded straight from the JavaScript array.
+                m_handle = bgfx::createIndexBuffer(ArrayReference::MakeRef(std::make_unique<ArrayReference>(std::move(arrayReferences), bytes)), flags);
             }
             else
             {
+                // Dynamic buffers are copied, as their array may change before bgfx uploads it.
+                // bgfx frees the copy afterwards.
+                const bgfx::Memory* memory = bgfx::copy(bytes.As<Napi::Uint8Array>().Data(), static_cast<uint32_t>(bytes.ByteLength()));
                 m_handle = bgfx::createDynamicIndexBuffer(memory, flags);
             }
         }
 
+        // A transient buffer, see UpdateTransient.
+        explicit IndexBufferData(bool index32)
+            : m_transient{Transient{{}, index32}}
+        {
+            m_handle = bgfx::IndexBufferHandle{bgfx::kInvalidHandle};
+        }
+
         ~IndexBufferData()
         {
             constexpr auto nonDynamic = [](auto handle) {
-                bgfx::destroy(handle);
+                if (handle.idx != bgfx::kInvalidHandle)
+                {
+                    bgfx::destroy(handle);
+                }
             };
             constexpr auto dynamic = [](auto handle) {
                 bgfx::destroy(handle);
@@ -443,8 +515,36 @@ namespace Babylon
             DoForHandleTypes(nonDynamic, dynamic);
         }
 
+        // Copies the indices into memory that bgfx reclaims at the end of the frame, so that
+        // nothing is kept between frames. The buffer must be filled again before every frame
+        // that draws it.
+        void UpdateTransient(const Napi::TypedArray& bytes)
+        {
+            if (!m_transient.has_value())
+            {
+                throw std::runtime_error("Cannot fill a non-transient index buffer.");
+            }
+
+            const uint32_t indexSize = m_transient->Index32 ? sizeof(uint32_t) : sizeof(uint16_t);
+            const uint32_t numIndices = static_cast<uint32_t>(bytes.ByteLength()) / indexSize;
+            if (bgfx::getAvailTransientIndexBuffer(numIndices, m_transient->Index32) < numIndices)
+            {
+                throw std::runtime_error("Not enough transient index buffer space left in this frame.");
+            }
+
+            bgfx::allocTransientIndexBuffer(&m_transient->Buffer, numIndices, m_transient->Index32);
+            std::memcpy(m_transient->Buffer.data, bytes.As<Napi::Uint8Array>().Data(), numIndices * indexSize);
+            m_transient->FrameNumber = s_frameNumber;
+        }
+
         void SetBgfxIndexBuffer() const
         {
+            if (const auto* transient = GetTransientBuffer())
+            {
+                bgfx::setIndexBuffer(transient);
+                return;
+            }
+
             constexpr auto nonDynamic = [](auto handle) {
                 bgfx::setIndexBuffer(handle);
             };
@@ -453,24 +553,135 @@ namespace Babylon
             };
             DoForHandleTypes(nonDynamic, dynamic);
         }
+
+        void SetBgfxIndexBuffer(uint32_t firstIndex, uint32_t numIndices) const
+        {
+            if (const auto* transient = GetTransientBuffer())
+            {
+                bgfx::setIndexBuffer(transient, firstIndex, numIndices);
+                return;
+            }
+
+            const auto nonDynamic = [firstIndex, numIndices](auto handle) {
+                bgfx::setIndexBuffer(handle, firstIndex, numIndices);
+            };
+            const auto dynamic = [firstIndex, numIndices](auto handle) {
+                bgfx::setIndexBuffer(handle, firstIndex, numIndices);
+            };
+            DoForHandleTypes(nonDynamic, dynamic);
+        }
+
+    private:
+        struct Transient
+        {
+            bgfx::TransientIndexBuffer Buffer{};
+            bool Index32{};
+            uint32_t FrameNumber{UINT32_MAX};
+        };
+
+        // Returns null for buffers that are not transient, and throws for transient buffers that
+        // were not filled in this frame.
+        const bgfx::TransientIndexBuffer* GetTransientBuffer() const
+        {
+            if (!m_transient.has_value())
+            {
+                return nullptr;
+            }
+
+            if (m_transient->FrameNumber != s_frameNumber)
+            {
+                throw std::runtime_error("Transient index buffers must be filled in the frame that draws them.");
+            }
+
+            return &m_transient->Buffer;
+        }
+
+        std::optional<Transient> m_transient{};
+    };
+
+    // Vertex layouts by their hash, the identity bgfx itself gives them. bgfx only has
+    // BGFX_CONFIG_MAX_VERTEX_LAYOUTS layout handles, so every user of a layout shares one, which is
+    // destroyed along with the last reference. Only used from the JavaScript thread.
+    class VertexLayoutCache final
+    {
+    public:
+        static VertexLayoutCache& GetInstance()
+        {
+            static VertexLayoutCache instance{};
+            return instance;
+        }
+
+        // Takes a reference to the layout, creating its handle on first use.
+        bgfx::VertexLayoutHandle Acquire(const bgfx::VertexLayout& layout)
+        {
+            auto& entry = m_entries[layout.m_hash];
+            if (entry.References++ == 0)
+            {
+                entry.Handle = bgfx::createVertexLayout(layout);
+            }
+
+            return entry.Handle;
+        }
+
+        void Release(const bgfx::VertexLayout& layout)
+        {
+            auto entry = m_entries.find(layout.m_hash);
+            if (entry != m_entries.end() && --entry->second.References == 0)
+            {
+                bgfx::destroy(entry->second.Handle);
+                m_entries.erase(entry);
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            bgfx::VertexLayoutHandle Handle{bgfx::kInvalidHandle};
+            uint32_t References{};
+        };
+
+        VertexLayoutCache() = default;
+
+        std::unordered_map<uint32_t, Entry> m_entries{};
     };
 
     class VertexBufferData final : VariantHandleHolder<bgfx::VertexBufferHandle, bgfx::DynamicVertexBufferHandle>
     {
     public:
-        VertexBufferData(const Napi::Uint8Array& bytes, bool dynamic)
-            : m_bytes{bytes.Data(), bytes.Data() + bytes.ByteLength()}
+        // The buffer is only created once its layout is known, see EnsureFinalized.
+        VertexBufferData(std::shared_ptr<ArrayReferenceQueue> arrayReferences, const Napi::Uint8Array& bytes, bool dynamic)
         {
             if (!dynamic)
             {
+                // Static buffers are uploaded straight from the JavaScript array.
+                m_reference = std::make_unique<ArrayReference>(std::move(arrayReferences), bytes);
                 m_handle = bgfx::VertexBufferHandle{bgfx::kInvalidHandle};
             }
             else
             {
+                // Dynamic buffers keep a copy, which Update may replace before the buffer is created.
+                m_bytes = {bytes.Data(), bytes.Data() + bytes.ByteLength()};
                 m_handle = bgfx::DynamicVertexBufferHandle{bgfx::kInvalidHandle};
             }
         }
 
+        // A transient buffer, see UpdateTransient.
+        explicit VertexBufferData(uint16_t byteStride)
+            : m_transient{Transient{}}
+        {
+            m_handle = bgfx::VertexBufferHandle{bgfx::kInvalidHandle};
+
+            if (byteStride == 0)
+            {
+                throw std::runtime_error("Transient vertex buffers need a stride.");
+            }
+
+            // bgfx only needs the stride to allocate transient vertices.
+            m_transient->Layout.begin();
+            m_transient->Layout.m_stride = byteStride;
+            m_transient->Layout.end();
+        }
+
         ~VertexBufferData()
         {
             constexpr auto nonDynamic = [](auto handle) {
@@ -486,25 +697,42 @@ namespace Babylon
                 }
             };
             DoForHandleTypes(nonDynamic, dynamic);
+
+            if (IsFinalized())
+            {
+                VertexLayoutCache::GetInstance().Release(m_vertexLayout);
+            }
+        }
+
+        bool IsFinalized() const
+        {
+            return bgfx::isValid(m_vertexLayoutHandle);
         }
 
+        // Creates the buffer on first use. bgfx only takes the stride from the layout, which is
+        // also what SetAsBgfxVertexBuffer reads the buffer with unless it is given another.
         void EnsureFinalized(Napi::Env /*env*/, const bgfx::VertexLayout& layout)
         {
+            if (IsFinalized())
+            {
+                return;
+            }
+
+            m_vertexLayout = layout;
+            m_vertexLayoutHandle = VertexLayoutCache::GetInstance().Acquire(layout);
+
+            if (m_transient.has_value())
+            {
+                return;
+            }
+
             const auto nonDynamic = [&layout, this](auto handle) {
                 if (handle.idx != bgfx::kInvalidHandle)
                 {
                     return;
                 }
 
-                const bgfx::Memory* memory = bgfx::makeRef(
-                    m_bytes.data(), static_cast<uint32_t>(m_bytes.size()), [](void*, void* userData) {
-                        auto* bytes = reinterpret_cast<std::vector<uint8_t>*>(userData);
-                        bytes->clear();
-                    },
-                    &m_bytes);
-
-                m_vertexLayoutHandle = bgfx::createVertexLayout(layout);
-                m_handle = bgfx::createVertexBuffer(memory, layout);
+                m_handle = bgfx::createVertexBuffer(ReleaseBytes(), layout);
             };
             const auto dynamic = [&layout, this](auto handle) {
                 if (handle.idx != bgfx::kInvalidHandle)
@@ -512,15 +740,7 @@ namespace Babylon
                     return;
                 }
 
-                const bgfx::Memory* memory = bgfx::makeRef(
-                    m_bytes.data(), static_cast<uint32_t>(m_bytes.size()), [](void*, void* userData) {
-                        auto* bytes = reinterpret_cast<std::vector<uint8_t>*>(userData);
-                        bytes->clear();
-                    },
-                    &m_bytes);
-
-                m_vertexLayoutHandle = bgfx::createVertexLayout(layout);
-                m_handle = bgfx::createDynamicVertexBuffer(memory, layout);
+                m_handle = bgfx::createDynamicVertexBuffer(ReleaseBytes(), layout);
             };
             DoForHandleTypes(nonDynamic, dynamic);
         }
@@ -548,7 +768,44 @@ namespace Babylon
 
         void SetAsBgfxVertexBuffer(uint8_t index, uint32_t startVertex) const
         {
-            bgfx::VertexLayoutHandle layout{ m_vertexLayoutHandle };
+            SetAsBgfxVertexBuffer(index, startVertex, m_vertexLayoutHandle);
+        }
+
+        // Copies the vertices into memory that bgfx reclaims at the end of the frame, so that
+        // nothing is kept between frames, unlike the shadow copy and the bgfx::copy of Update. The
+        // buffer must be filled again before every frame that draws it.
+        void UpdateTransient(const Napi::TypedArray& bytes)
+        {
+            if (!m_transient.has_value())
+            {
+                throw std::runtime_error("Cannot fill a non-transient vertex buffer.");
+            }
+
+            const auto& layout = m_transient->Layout;
+            const uint32_t numVertices = static_cast<uint32_t>(bytes.ByteLength()) / layout.getStride();
+            if (bgfx::getAvailTransientVertexBuffer(numVertices, layout) < numVertices)
+            {
+                throw std::runtime_error("Not enough transient vertex buffer space left in this frame.");
+            }
+
+            bgfx::allocTransientVertexBuffer(&m_transient->Buffer, numVertices, layout);
+            std::memcpy(m_transient->Buffer.data, bytes.As<Napi::Uint8Array>().Data(), numVertices * layout.getStride());
+            m_transient->FrameNumber = s_frameNumber;
+        }
+
+        void SetAsBgfxVertexBuffer(uint8_t index, uint32_t startVertex, bgfx::VertexLayoutHandle layout) const
+        {
+            if (m_transient.has_value())
+            {
+                if (m_transient->FrameNumber != s_frameNumber)
+                {
+                    throw std::runtime_error("Transient vertex buffers must be filled in the frame that draws them.");
+                }
+
+                bgfx::setVertexBuffer(index, &m_transient->Buffer, startVertex, UINT32_MAX, layout);
+                return;
+            }
+
             const auto nonDynamic = [index, startVertex, layout](auto handle) {
                 bgfx::setVertexBuffer(index, handle, startVertex, UINT32_MAX, layout);
             };
@@ -559,8 +816,98 @@ namespace Babylon
         }
 
     private:
+        // Nothing is kept on the CPU once bgfx has uploaded the bytes.
+        const bgfx::Memory* ReleaseBytes()
+        {
+            if (m_reference)
+            {
+                return ArrayReference::MakeRef(std::move(m_reference));
+            }
+
+            return MakeRef(std::exchange(m_bytes, {}));
+        }
+
+        struct Transient
+        {
+            bgfx::VertexLayout Layout{};
+            bgfx::TransientVertexBuffer Buffer{};
+            uint32_t FrameNumber{UINT32_MAX};
+        };
+
+        std::unique_ptr<ArrayReference> m_reference{};
         std::vector<uint8_t> m_bytes{};
-        bgfx::VertexLayoutHandle m_vertexLayoutHandle{};
+        bgfx::VertexLayout m_vertexLayout{};
+        bgfx::VertexLayoutHandle m_vertexLayoutHandle{bgfx::kInvalidHandle};
+        std::optional<Transient> m_transient{};
+    };
+
+    VertexArray::~VertexArray()
+    {
+        for (const auto& vertexBuffer : vertexBuffers)
+        {
+            VertexLayoutCache::GetInstance().Release(vertexBuffer.layout);
+        }
+    }
+
+    // Per-instance data, one row of up to five vec4s per instance, read by the shader as world0
+    // through world3 and instanceColor.
+    class InstanceBufferData final
+    {
+    public:
+        static constexpr uint32_t MAX_ROW_SIZE{5 * 4 * sizeof(float)};
+
+        InstanceBufferData(const Napi::TypedArray& bytes, uint32_t rowSize)
+            : m_rowSize{rowSize}
+        {
+            if (rowSize == 0 || rowSize % (4 * sizeof(float)) != 0 || rowSize > MAX_ROW_SIZE)
+            {
+                throw std::runtime_error{"Instance data rows must hold between one and five vec4s."};
+            }
+
+            // bgfx only uses the stride of the layout when reading instance data.
+            bgfx::VertexLayout layout{};
+            layout.begin();
+            for (uint32_t index = 0; index < rowSize / (4 * sizeof(float)); ++index)
+            {
+                layout.add(static_cast<bgfx::Attrib::Enum>(bgfx::Attrib::TexCoord7 - index), 4, bgfx::AttribType::Float);
+            }
+            layout.end();
+
+            m_instanceCount = static_cast<uint32_t>(bytes.ByteLength()) / rowSize;
+            m_handle = bgfx::createDynamicVertexBuffer(Copy(bytes), layout, BGFX_BUFFER_ALLOW_RESIZE);
+        }
+
+        ~InstanceBufferData()
+        {
+            bgfx::destroy(m_handle);
+        }
+
+        void Update(const Napi::TypedArray& bytes, uint32_t startInstance)
+        {
+            m_instanceCount = std::max(m_instanceCount, startInstance + static_cast<uint32_t>(bytes.ByteLength()) / m_rowSize);
+            bgfx::update(m_handle, startInstance, Copy(bytes));
+        }
+
+        void SetAsBgfxInstanceDataBuffer(uint32_t startInstance, uint32_t instanceCount) const
+        {
+            if (startInstance + instanceCount > m_instanceCount)
+            {
+                throw std::runtime_error{"Instance range exceeds the instance buffer."};
+            }
+
+            bgfx::setInstanceDataBuffer(m_handle, startInstance, instanceCount);
+        }
+
+    private:
+        const bgfx::Memory* Copy(const Napi::TypedArray& bytes) const
+        {
+            // A trailing partial row is dropped.
+            return bgfx::copy(bytes.As<Napi::Uint8Array>().Data(), static_cast<uint32_t>(bytes.ByteLength()) / m_rowSize * m_rowSize);
+        }
+
+        bgfx::DynamicVertexBufferHandle m_handle{bgfx::kInvalidHandle};
+        uint32_t m_rowSize{};
+        uint32_t m_instanceCount{};
     };
 
     void NativeEngine::InitializeWindow(void* nativeWindowPtr, uint32_t width, uint32_t height)
@@ -578,7 +925,10 @@ namespace Babylon
         init.resolution.height = height;
         init.resolution.reset = BGFX_RESET_FLAGS;
         init.callback = &s_bgfxCallback;
-        bgfx::init(init);
+        {
+            StartupProfiler::Scope scope{"bgfx::init", "NativeEngine"};
+            bgfx::init(init);
+        }
         bgfx::setViewClear(0, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x443355FF, 1.0f, 0);
         bgfx::setViewRect(0, 0, 0, static_cast<uint16_t>(init.resolution.width), static_cast<uint16_t>(init.resolution.height));
         bgfx::touch(0);
@@ -589,6 +939,11 @@ namespace Babylon
         bgfx::shutdown();
     }
 
+    void NativeEngine::Frame()
+    {
+        s_frameNumber = bgfx::frame();
+    }
+
     void NativeEngine::Initialize(Napi::Env env)
     {
         // Initialize the JavaScript side.
@@ -608,12 +963,22 @@ namespace Babylon
                 InstanceMethod("deleteIndexBuffer", &NativeEngine::DeleteIndexBuffer),
                 InstanceMethod("recordIndexBuffer", &NativeEngine::RecordIndexBuffer),
                 InstanceMethod("updateDynamicIndexBuffer", &NativeEngine::UpdateDynamicIndexBuffer),
+                InstanceMethod("createTransientIndexBuffer", &NativeEngine::CreateTransientIndexBuffer),
+                InstanceMethod("updateTransientIndexBuffer", &NativeEngine::UpdateTransientIndexBuffer),
                 InstanceMethod("createVertexBuffer", &NativeEngine::CreateVertexBuffer),
                 InstanceMethod("deleteVertexBuffer", &NativeEngine::DeleteVertexBuffer),
                 InstanceMethod("recordVertexBuffer", &NativeEngine::RecordVertexBuffer),
                 InstanceMethod("updateDynamicVertexBuffer", &NativeEngine::UpdateDynamicVertexBuffer),
+                InstanceMethod("createTransientVertexBuffer", &NativeEngine::CreateTransientVertexBuffer),
+                InstanceMethod("updateTransientVertexBuffer", &NativeEngine::UpdateTransientVertexBuffer),
+                InstanceMethod("createInstanceBuffer", &NativeEngine::CreateInstanceBuffer),
+                InstanceMethod("deleteInstanceBuffer", &NativeEngine::DeleteInstanceBuffer),
+                InstanceMethod("updateInstanceBuffer", &NativeEngine::UpdateInstanceBuffer),
                 InstanceMethod("createProgram", &NativeEngine::CreateProgram),
+                InstanceMethod("createProgramAsync", &NativeEngine::CreateProgramAsync),
                 InstanceMethod("getUniforms", &NativeEngine::GetUniforms),
+                InstanceMethod("getUniformBuffer", &NativeEngine::GetUniformBuffer),
+                InstanceMethod("getUniformBufferOffsets", &NativeEngine::GetUniformBufferOffsets),
                 InstanceMethod("getAttributes", &NativeEngine::GetAttributes),
                 InstanceMethod("setProgram", &NativeEngine::SetProgram),
                 InstanceMethod("setState", &NativeEngine::SetState),
@@ -657,6 +1022,8 @@ namespace Babylon
                 InstanceMethod("bindFramebuffer", &NativeEngine::BindFrameBuffer),
                 InstanceMethod("unbindFramebuffer", &NativeEngine::UnbindFrameBuffer),
                 InstanceMethod("drawIndexed", &NativeEngine::DrawIndexed),
+                InstanceMethod("drawIndexedInstanced", &NativeEngine::DrawIndexedInstanced),
+                InstanceMethod("multiDrawIndexed", &NativeEngine::MultiDrawIndexed),
                 InstanceMethod("draw", &NativeEngine::Draw),
                 InstanceMethod("clear", &NativeEngine::Clear),
                 InstanceMethod("clearColor", &NativeEngine::ClearColor),
@@ -667,7 +1034,12 @@ namespace Babylon
                 InstanceMethod("setViewPort", &NativeEngine::SetViewPort),
                 InstanceMethod("getFramebufferData", &NativeEngine::GetFramebufferData),
                 InstanceMethod("getRenderAPI", &NativeEngine::GetRenderAPI),
+                InstanceMethod("getFrameStats", &NativeEngine::GetFrameStats),
+                InstanceMethod("getShaderCacheStats", &NativeEngine::GetShaderCacheStats),
                 InstanceMethod("bindBuffer", &NativeEngine::BindBuffer),
+                InstanceMethod("createCommandHandle", &NativeEngine::CreateCommandHandle),
+                InstanceMethod("deleteCommandHandle", &NativeEngine::DeleteCommandHandle),
+                InstanceMethod("submitCommands", &NativeEngine::SubmitCommands),
             });
 
         env.Global().Get(JsRuntime::JS_NATIVE_NAME).As<Napi::Object>().Set(JS_ENGINE_CONSTRUCTOR_NAME, func);
@@ -682,6 +1054,7 @@ namespace Babylon
         : Napi::ObjectWrap<NativeEngine>{info}
         , m_runtime{JsRuntime::GetFromJavaScript(info.Env())}
         , m_runtimeScheduler{m_runtime}
+        , m_backgroundRuntimeScheduler{m_runtime, JsRuntime::DispatchPriority::Background}
         , m_engineState{BGFX_STATE_DEFAULT}
         , m_resizeCallbackTicket{nativeWindow.AddOnResizeCallback([this](size_t width, size_t height) { this->UpdateSize(width, height); })}
     {
@@ -704,7 +1077,7 @@ namespace Babylon
             bgfx::reset(w, h, BGFX_RESET_FLAGS);
             bgfx::setViewRect(0, 0, 0, w, h);
 #ifdef __APPLE__
-            bgfx::frame();
+            Frame();
 #else
             bgfx::touch(0);
 #endif
@@ -720,8 +1093,28 @@ namespace Babylon
     {
         m_cancelSource.cancel();
 
+        // A compile started by createProgramAsync may still be running on the thread pool. Its
+        // result is dropped once the engine is disposed.
+        {
+            std::unique_lock lock{m_asyncCompiles->Mutex};
+            m_asyncCompiles->Disposed = true;
+            m_asyncCompiles->Finished.wait(lock, [this]() { return m_asyncCompiles->Running == 0; });
+        }
+
         // This collection contains bgfx data, so it must be cleared before bgfx::shutdown is called.
         m_programDataCollection.clear();
+        m_commandHandles->Clear();
+
+        // bgfx releases the arrays it reads in place once the render thread has processed the frame
+        // that created their buffers. Flushing the pending frame releases the arrays of the earlier
+        // ones, which are deleted here while the JavaScript runtime is known to be alive. Arrays
+        // bgfx only releases later, at the latest when it shuts down, are leaked.
+        if (m_arrayReferences->HasPending())
+        {
+            Frame();
+        }
+
+        m_arrayReferences->Close();
     }
 
     void NativeEngine::Dispose(const Napi::CallbackInfo& /*info*/)
@@ -755,17 +1148,27 @@ namespace Babylon
             {
                 Napi::Error::New(env, ex.what()).ThrowAsJavaScriptException();
             }
-        });
+        },
+            JsRuntime::DispatchPriority::Frame);
     }
 
     Napi::Value NativeEngine::CreateVertexArray(const Napi::CallbackInfo& info)
     {
-        return Napi::External<VertexArray>::New(info.Env(), new VertexArray{});
+        auto* vertexArray = new VertexArray{};
+        m_commandHandles->AddResource(vertexArray, CommandHandleType::VertexArray);
+        return Napi::External<VertexArray>::New(info.Env(), vertexArray);
     }
 
     void NativeEngine::DeleteVertexArray(const Napi::CallbackInfo& info)
     {
-        delete info[0].As<Napi::External<VertexArray>>().Data();
+        auto* vertexArray = info[0].As<Napi::External<VertexArray>>().Data();
+        if (vertexArray == m_boundVertexArray)
+        {
+            m_boundVertexArray = nullptr;
+        }
+
+        m_commandHandles->RemoveResource(vertexArray);
+        delete vertexArray;
     }
 
     void NativeEngine::BindBuffer(const Napi::CallbackInfo& info)
@@ -778,29 +1181,50 @@ namespace Babylon
         const uint32_t type = info[5].As<Napi::Number>().Uint32Value();
         const bool normalized = info[6].As<Napi::Boolean>().Value();
 
-        bgfx::VertexLayout vertexLayout{};
-        vertexLayout.begin();
-        const bgfx::Attrib::Enum attrib = static_cast<bgfx::Attrib::Enum>(location);
-        const bgfx::AttribType::Enum attribType = ConvertAttribType(static_cast<WebGLAttribType>(type));
-        vertexLayout.add(attrib, static_cast<uint8_t>(numElements), attribType, normalized);
-        vertexLayout.m_stride = static_cast<uint16_t>(byteStride);
-        vertexLayout.end();
+        // The layout only matters the first time the buffer is used.
+        if (!vertexBufferData->IsFinalized())
+        {
+            const VertexArray::Attribute attribute{static_cast<bgfx::Attrib::Enum>(location), static_cast<uint8_t>(numElements), ConvertAttribType(static_cast<WebGLAttribType>(type)), normalized, 0};
+            vertexBufferData->EnsureFinalized(info.Env(), CreateVertexLayout({&attribute, 1}, static_cast<uint16_t>(byteStride)));
+        }
 
-        vertexBufferData->EnsureFinalized(info.Env(), vertexLayout);
         vertexBufferData->SetAsBgfxVertexBuffer(static_cast<uint8_t>(location), 0);
     }
 
     void NativeEngine::BindVertexArray(const Napi::CallbackInfo& info)
     {
-        const auto& vertexArray = *(info[0].As<Napi::External<VertexArray>>().Data());
+        ApplyVertexArray(*(info[0].As<Napi::External<VertexArray>>().Data()));
+    }
+
+    void NativeEngine::ApplyVertexArray(const VertexArray& vertexArray)
+    {
+        m_boundVertexArray = &vertexArray;
 
-        vertexArray.indexBuffer.data->SetBgfxIndexBuffer();
+        if (vertexArray.indexBuffer.data != nullptr)
+        {
+            vertexArray.indexBuffer.data->SetBgfxIndexBuffer();
+        }
 
+        ApplyVertexBuffers(vertexArray, 0);
+    }
+
+    void NativeEngine::ApplyVertexBuffers(const VertexArray& vertexArray, uint32_t baseVertex)
+    {
         const auto& vertexBuffers = vertexArray.vertexBuffers;
         for (uint8_t index = 0; index < vertexBuffers.size(); ++index)
         {
             const auto& vertexBuffer = vertexBuffers[index];
-            vertexBuffer.data->SetAsBgfxVertexBuffer(index, vertexBuffer.startVertex);
+            vertexBuffer.data->SetAsBgfxVertexBuffer(index, vertexBuffer.startVertex + baseVertex, vertexBuffer.layoutHandle);
+        }
+    }
+
+    void NativeEngine::SetIndexRange(uint32_t elementStart, uint32_t elementCount)
+    {
+        // A draw may follow a non-indexed one, which discards the index buffer, so it is set again
+        // rather than relying on the one set when the vertex array was bound.
+        if (m_boundVertexArray != nullptr && m_boundVertexArray->indexBuffer.data != nullptr)
+        {
+            m_boundVertexArray->indexBuffer.data->SetBgfxIndexBuffer(elementStart, elementCount);
         }
     }
 
@@ -811,7 +1235,7 @@ namespace Babylon
 
         const uint16_t flags = data.TypedArrayType() == napi_typedarray_type::napi_uint16_array ? 0 : BGFX_BUFFER_INDEX32;
 
-        return Napi::External<IndexBufferData>::New(info.Env(), new IndexBufferData(data, flags, dynamic));
+        return Napi::External<IndexBufferData>::New(info.Env(), new IndexBufferData(m_arrayReferences, data, flags, dynamic));
     }
 
     void NativeEngine::DeleteIndexBuffer(const Napi::CallbackInfo& info)
@@ -838,12 +1262,27 @@ namespace Babylon
         indexBufferData.Update(data, startingIdx);
     }
 
+    Napi::Value NativeEngine::CreateTransientIndexBuffer(const Napi::CallbackInfo& info)
+    {
+        const bool index32 = info[0].As<Napi::Boolean>().Value();
+
+        return Napi::External<IndexBufferData>::New(info.Env(), new IndexBufferData(index32));
+    }
+
+    void NativeEngine::UpdateTransientIndexBuffer(const Napi::CallbackInfo& info)
+    {
+        IndexBufferData& indexBufferData = *(info[0].As<Napi::External<IndexBufferData>>().Data());
+        const Napi::TypedArray data = info[1].As<Napi::TypedArray>();
+
+        indexBufferData.UpdateTransient(data);
+    }
+
     Napi::Value NativeEngine::CreateVertexBuffer(const Napi::CallbackInfo& info)
     {
         const Napi::Uint8Array data = info[0].As<Napi::Uint8Array>();
         const bool dynamic = info[1].As<Napi::Boolean>().Value();
 
-        return Napi::External<VertexBufferData>::New(info.Env(), new VertexBufferData(data, dynamic));
+        return Napi::External<VertexBufferData>::New(info.Env(), new VertexBufferData(m_arrayReferences, data, dynamic));
     }
 
     void NativeEngine::DeleteVertexBuffer(const Napi::CallbackInfo& info)
@@ -864,17 +1303,53 @@ namespace Babylon
         const uint32_t type = info[6].As<Napi::Number>().Uint32Value();
         const bool normalized = info[7].As<Napi::Boolean>().Value();
 
-        bgfx::VertexLayout vertexLayout{};
-        vertexLayout.begin();
         const bgfx::Attrib::Enum attrib = static_cast<bgfx::Attrib::Enum>(location);
         const bgfx::AttribType::Enum attribType = ConvertAttribType(static_cast<WebGLAttribType>(type));
-        vertexLayout.add(attrib, static_cast<uint8_t>(numElements), attribType, normalized);
-        vertexLayout.m_stride = static_cast<uint16_t>(byteStride);
-        vertexLayout.end();
+        const uint32_t startVertex = byteOffset / byteStride;
+
+        // Attributes interleaved in the same range of a buffer are read through one stream.
+        auto& vertexBuffers = vertexArray.vertexBuffers;
+        auto vertexBuffer = std::find_if(vertexBuffers.begin(), vertexBuffers.end(), [&](const auto& other) {
+            return other.data == vertexBufferData && other.startVertex == startVertex && other.layout.getStride() == byteStride && !other.layout.has(attrib);
+        });
+
+        auto& vertexLayoutCache = VertexLayoutCache::GetInstance();
+        if (vertexBuffer == vertexBuffers.end())
+        {
+            vertexBuffer = vertexBuffers.insert(vertexBuffers.end(), {vertexBufferData, startVertex});
+        }
+        else
+        {
+            vertexLayoutCache.Release(vertexBuffer->layout);
+        }
+
+        vertexBuffer->attributes.push_back({attrib, static_cast<uint8_t>(numElements), attribType, normalized, static_cast<uint16_t>(byteOffset % byteStride)});
+        vertexBuffer->layout = CreateVertexLayout(vertexBuffer->attributes, static_cast<uint16_t>(byteStride));
+        vertexBuffer->layoutHandle = vertexLayoutCache.Acquire(vertexBuffer->layout);
+
+        vertexBufferData->EnsureFinalized(info.Env(), vertexBuffer->layout);
+    }
+
+    Napi::Value NativeEngine::CreateInstanceBuffer(const Napi::CallbackInfo& info)
+    {
+        const Napi::TypedArray data = info[0].As<Napi::TypedArray>();
+        const uint32_t rowSize = info[1].As<Napi::Number>().Uint32Value();
 
-        vertexBufferData->EnsureFinalized(info.Env(), vertexLayout);
+        return Napi::External<InstanceBufferData>::New(info.Env(), new InstanceBufferData(data, rowSize));
+    }
 
-        vertexArray.vertexBuffers.push_back({vertexBufferData, byteOffset / byteStride});
+    void NativeEngine::DeleteInstanceBuffer(const Napi::CallbackInfo& info)
+    {
+        delete info[0].As<Napi::External<InstanceBufferData>>().Data();
+    }
+
+    void NativeEngine::UpdateInstanceBuffer(const Napi::CallbackInfo& info)
+    {
+        InstanceBufferData& instanceBufferData = *(info[0].As<Napi::External<InstanceBufferData>>().Data());
+        const Napi::TypedArray data = info[1].As<Napi::TypedArray>();
+        const uint32_t startInstance = info[2].As<Napi::Number>().Uint32Value();
+
+        instanceBufferData.Update(data, startInstance);
     }
 
     void NativeEngine::UpdateDynamicVertexBuffer(const Napi::CallbackInfo& info)
@@ -892,128 +1367,130 @@ namespace Babylon
         vertexBufferData.Update(data, byteOffset, byteLength);
     }
 
-    Napi::Value NativeEngine::CreateProgram(const Napi::CallbackInfo& info)
+    Napi::Value NativeEngine::CreateTransientVertexBuffer(const Napi::CallbackInfo& info)
     {
-        const auto vertexSource = info[0].As<Napi::String>().Utf8Value();
-        const auto fragmentSource = info[1].As<Napi::String>().Utf8Value();
+        const uint32_t byteStride = info[0].As<Napi::Number>().Uint32Value();
 
-        auto programData = std::make_unique<ProgramData>();
+        return Napi::External<VertexBufferData>::New(info.Env(), new VertexBufferData(static_cast<uint16_t>(byteStride)));
+    }
 
-        std::vector<uint8_t> vertexBytes{};
-        std::vector<uint8_t> fragmentBytes{};
-        std::unordered_map<std::string, uint32_t> attributeLocations;
+    void NativeEngine::UpdateTransientVertexBuffer(const Napi::CallbackInfo& info)
+    {
+        VertexBufferData& vertexBufferData = *(info[0].As<Napi::External<VertexBufferData>>().Data());
+        const Napi::TypedArray data = info[1].As<Napi::TypedArray>();
 
-        m_shaderCompiler.Compile(vertexSource, fragmentSource, [&](ShaderCompiler::ShaderInfo vertexShaderInfo, ShaderCompiler::ShaderInfo fragmentShaderInfo) {
-            constexpr uint8_t BGFX_SHADER_BIN_VERSION = 6;
+        vertexBufferData.UpdateTransient(data);
+    }
 
-            // These hashes are generated internally by BGFX's custom shader compilation pipeline,
-            // which we don't have access to.  Fortunately, however, they aren't used for anything
-            // crucial; they just have to match.
-            constexpr uint32_t vertexOutputsHash = 0xBAD1DEA;
-            constexpr uint32_t fragmentInputsHash = vertexOutputsHash;
+    Napi::Value NativeEngine::CreateProgram(const Napi::CallbackInfo& info)
+    {
+        const auto vertexSource = info[0].As<Napi::String>().Utf8Value();
+        const auto fragmentSource = info[1].As<Napi::String>().Utf8Value();
 
-            {
-                const auto& compiler = *vertexShaderInfo.Compiler;
-                const spirv_cross::ShaderResources resources = compiler.get_shader_resources();
-                auto uniformsInfo = CollectNonSamplerUniforms(*vertexShaderInfo.Parser, compiler);
-#if (BGFX_CONFIG_RENDERER_METAL)
-                // with metal, we bind images and not samplers
-                const spirv_cross::SmallVector<spirv_cross::Resource>& samplers = resources.separate_images;
-#else
-                const spirv_cross::SmallVector<spirv_cross::Resource>& samplers = resources.separate_samplers;
-#endif
-                size_t numUniforms = uniformsInfo.Uniforms.size() + samplers.size();
+        auto& shaderCache = ShaderCache::GetInstance();
+        const auto key = ShaderCache::GetKey(vertexSource, fragmentSource);
+        auto compiledProgram = shaderCache.Find(key);
+        if (!compiledProgram)
+        {
+            compiledProgram = CompileProgram(*m_shaderCompiler, vertexSource, fragmentSource);
+            shaderCache.Store(key, compiledProgram);
+        }
 
-                AppendBytes(vertexBytes, BX_MAKEFOURCC('V', 'S', 'H', BGFX_SHADER_BIN_VERSION));
-                AppendBytes(vertexBytes, vertexOutputsHash);
-                AppendBytes(vertexBytes, fragmentInputsHash);
+        auto program = CreateProgramHandle(info.Env());
+        InitializeProgram(*program.Data(), *compiledProgram);
+        return std::move(program);
+    }
 
-                AppendBytes(vertexBytes, static_cast<uint16_t>(numUniforms));
-                AppendUniformBuffer(vertexBytes, uniformsInfo, false);
-                AppendSamplers(vertexBytes, compiler, samplers, false, programData->VertexUniformNameToInfo);
+    Napi::Value NativeEngine::CreateProgramAsync(const Napi::CallbackInfo& info)
+    {
+        auto vertexSource = info[0].As<Napi::String>().Utf8Value();
+        auto fragmentSource = info[1].As<Napi::String>().Utf8Value();
 
-                AppendBytes(vertexBytes, static_cast<uint32_t>(vertexShaderInfo.Bytes.size()));
-                AppendBytes(vertexBytes, vertexShaderInfo.Bytes);
-                AppendBytes(vertexBytes, static_cast<uint8_t>(0));
+        // The program can be bound right away, but draws with it are skipped until it is ready.
+        auto program = CreateProgramHandle(info.Env());
+        auto deferred = Napi::Promise::Deferred::New(info.Env());
 
-                AppendBytes(vertexBytes, static_cast<uint8_t>(resources.stage_inputs.size()));
-                for (const spirv_cross::Resource& stageInput : resources.stage_inputs)
-                {
-                    const uint32_t location = compiler.get_decoration(stageInput.id, spv::DecorationLocation);
-                    AppendBytes(vertexBytes, bgfx::attribToId(static_cast<bgfx::Attrib::Enum>(location)));
-
-                    std::string attributeName = stageInput.name;
-                    if (attributeName == "a_position")
-                        attributeName = "position";
-                    else if (attributeName == "a_normal")
-                        attributeName = "normal";
-                    else if (attributeName == "a_tangent")
-                        attributeName = "tangent";
-                    else if (attributeName == "a_texcoord0")
-                        attributeName = "uv";
-                    else if (attributeName == "a_texcoord1")
-                        attributeName = "uv2";
-                    else if (attributeName == "a_texcoord2")
-                        attributeName = "uv3";
-                    else if (attributeName == "a_texcoord3")
-                        attributeName = "uv4";
-                    else if (attributeName == "a_color0")
-                        attributeName = "color";
-                    else if (attributeName == "a_indices")
-                        attributeName = "matricesIndices";
-                    else if (attributeName == "a_weight")
-                        attributeName = "matricesWeights";
-
-                    attributeLocations[attributeName] = location;
-                }
+        auto result = Napi::Object::New(info.Env());
+        result.Set("program", program);
+        result.Set("ready", deferred.Promise());
 
-                AppendBytes(vertexBytes, static_cast<uint16_t>(uniformsInfo.ByteSize));
-            }
+        {
+            std::scoped_lock lock{m_asyncCompiles->Mutex};
+            ++m_asyncCompiles->Running;
+        }
 
+        // The compile does not hold the engine, which may be disposed meanwhile. It dispatches its
+        // result to the runtime itself before Dispose stops waiting for it, so the runtime is still
+        // alive at that point. The target names the renderer, which is only safe to query from this
+        // thread.
+        arcana::make_task(arcana::threadpool_scheduler, arcana::cancellation::none(), [shaderCompiler = m_shaderCompiler, target{ShaderCache::GetTarget()}, vertexSource{std::move(vertexSource)}, fragmentSource{std::move(fragmentSource)}]() {
+            auto& shaderCache = ShaderCache::GetInstance();
+            const auto key = ShaderCache::GetKey(target, vertexSource, fragmentSource);
+            auto compiledProgram = shaderCache.Find(key);
+            if (!compiledProgram)
             {
-                const spirv_cross::Compiler& compiler = *fragmentShaderInfo.Compiler;
-                const spirv_cross::ShaderResources resources = compiler.get_shader_resources();
-                const auto uniformsInfo = CollectNonSamplerUniforms(*fragmentShaderInfo.Parser, compiler);
-#if __APPLE__
-                // with metal, we bind images and not samplers
-                const spirv_cross::SmallVector<spirv_cross::Resource>& samplers = resources.separate_images;
-#else
-                const spirv_cross::SmallVector<spirv_cross::Resource>& samplers = resources.separate_samplers;
-#endif
-                size_t numUniforms = uniformsInfo.Uniforms.size() + samplers.size();
+                compiledProgram = CompileProgram(*shaderCompiler, vertexSource, fragmentSource);
+                shaderCache.Store(key, compiledProgram);
+            }
 
-                AppendBytes(fragmentBytes, BX_MAKEFOURCC('F', 'S', 'H', BGFX_SHADER_BIN_VERSION));
-                AppendBytes(fragmentBytes, vertexOutputsHash);
-                AppendBytes(fragmentBytes, fragmentInputsHash);
+            return compiledProgram;
+        }).then(arcana::inline_scheduler, arcana::cancellation::none(), [asyncCompiles = m_asyncCompiles, &runtime = m_runtime, programRef = std::make_shared<Napi::Reference<Napi::External<ProgramData>>>(Napi::Persistent(program)), deferred](const arcana::expected<std::shared_ptr<const CompiledProgram>, std::exception_ptr>& result) mutable {
+            // The program reference moves to the JavaScript thread, which must be the one to release it.
+            runtime.Dispatch([asyncCompiles, programRef = std::move(programRef), deferred, result](Napi::Env) {
+                {
+                    std::scoped_lock lock{asyncCompiles->Mutex};
+                    if (asyncCompiles->Disposed)
+                    {
+                        return;
+                    }
+                }
 
-                AppendBytes(fragmentBytes, static_cast<uint16_t>(numUniforms));
-                AppendUniformBuffer(fragmentBytes, uniformsInfo, true);
-                AppendSamplers(fragmentBytes, compiler, samplers, true, programData->FragmentUniformNameToInfo);
+                if (result.has_error())
+                {
+                    std::string message{"Shader compilation failed."};
+                    try
+                    {
+                        std::rethrow_exception(result.error());
+                    }
+                    catch (const std::exception& exception)
+                    {
+                        message = exception.what();
+                    }
+                    catch (...)
+                    {
+                    }
 
-                AppendBytes(fragmentBytes, static_cast<uint32_t>(fragmentShaderInfo.Bytes.size()));
-                AppendBytes(fragmentBytes, fragmentShaderInfo.Bytes);
-                AppendBytes(fragmentBytes, static_cast<uint8_t>(0));
+                    deferred.Reject(Napi::Error::New(deferred.Env(), message).Value());
+                    return;
+                }
 
-                // Fragment shaders don't have attributes.
-                AppendBytes(fragmentBytes, static_cast<uint8_t>(0));
+                InitializeProgram(*programRef->Value().Data(), *result.value());
+                deferred.Resolve(programRef->Value());
+            });
 
-                AppendBytes(fragmentBytes, static_cast<uint16_t>(uniformsInfo.ByteSize));
-            }
+            std::scoped_lock lock{asyncCompiles->Mutex};
+            --asyncCompiles->Running;
+            asyncCompiles->Finished.notify_all();
         });
 
-        auto vertexShader = bgfx::createShader(bgfx::copy(vertexBytes.data(), static_cast<uint32_t>(vertexBytes.size())));
-        CacheUniformHandles(vertexShader, programData->VertexUniformNameToInfo);
-        programData->AttributeLocations = std::move(attributeLocations);
-
-        auto fragmentShader = bgfx::createShader(bgfx::copy(fragmentBytes.data(), static_cast<uint32_t>(fragmentBytes.size())));
-        CacheUniformHandles(fragmentShader, programData->FragmentUniformNameToInfo);
-
-        programData->Program = bgfx::createProgram(vertexShader, fragmentShader, true);
+        return std::move(result);
+    }
 
+    Napi::External<ProgramData> NativeEngine::CreateProgramHandle(Napi::Env env)
+    {
+        auto programData = std::make_unique<ProgramData>();
         auto* rawProgramData = programData.get();
         auto ticket = m_programDataCollection.insert(std::move(programData));
-        auto finalizer = [ticket = std::move(ticket)](Napi::Env, ProgramData*) {};
-        return Napi::External<ProgramData>::New(info.Env(), rawProgramData, std::move(finalizer));
+        m_commandHandles->AddResource(rawProgramData, CommandHandleType::Program);
+        auto finalizer = [ticket = std::move(ticket), commandHandles = m_commandHandles](Napi::Env, ProgramData* programData) {
+            commandHandles->RemoveResource(programData);
+        };
+        return Napi::External<ProgramData>::New(env, rawProgramData, std::move(finalizer));
+    }
+
+    std::shared_ptr<const CompiledProgram> NativeEngine::CompileProgram(ShaderCompiler& shaderCompiler, const std::string& vertexSource, const std::string& fragmentSource)
+    {
+        return std::make_shared<const CompiledProgram>(Babylon::CompileProgram(shaderCompiler, vertexSource, fragmentSource));
     }
 
     Napi::Value NativeEngine::GetUniforms(const Napi::CallbackInfo& info)
@@ -1032,10 +1509,12 @@ namespace Babylon
 
             if (vertexFound != program->VertexUniformNameToInfo.end())
             {
+                m_commandHandles->AddResource(&vertexFound->second, CommandHandleType::Uniform, program);
                 uniforms[index] = Napi::External<UniformInfo>::New(info.Env(), &vertexFound->second);
             }
             else if (fragmentFound != program->FragmentUniformNameToInfo.end())
             {
+                m_commandHandles->AddResource(&fragmentFound->second, CommandHandleType::Uniform, program);
                 uniforms[index] = Napi::External<UniformInfo>::New(info.Env(), &fragmentFound->second);
             }
             else
@@ -1047,6 +1526,74 @@ namespace Babylon
         return std::move(uniforms);
     }
 
+    Napi::Value NativeEngine::GetUniformBuffer(const Napi::CallbackInfo& info)
+    {
+        const auto program = info[0].As<Napi::External<ProgramData>>().Data();
+        if (!bgfx::isValid(program->Program))
+        {
+            // The block is laid out when the program is initialized and would be replaced then,
+            // losing whatever script had written to it.
+            throw Napi::Error::New(info.Env(), "The uniform buffer is not available until the program is ready.");
+        }
+
+        program->CheckSharedUniformBlock();
+        if (!program->IsUniformBlockShared())
+        {
+            // Allocated by the JavaScript engine rather than wrapping UniformBlock, since not every
+            // engine supports array buffers over external memory.
+            const auto length = program->UniformBlock.size();
+            const auto arrayBuffer = Napi::ArrayBuffer::New(info.Env(), length * sizeof(float));
+            auto buffer = Napi::Float32Array::New(info.Env(), length, arrayBuffer, 0);
+            std::copy(program->UniformBlock.begin(), program->UniformBlock.end(), buffer.Data());
+
+            program->UniformValues = {buffer.Data(), static_cast<std::ptrdiff_t>(length)};
+            program->SharedUniformBlock = Napi::Persistent(buffer);
+            program->SharedUniformBuffer = Napi::Persistent(arrayBuffer);
+
+            // Script can write any uniform without saying so, so every one is submitted in full.
+            for (auto& slot : program->UniformSlots)
+            {
+                slot.ElementLength = static_cast<uint16_t>(slot.Capacity / slot.ElementSize);
+            }
+        }
+
+        return program->SharedUniformBlock.Value();
+    }
+
+    Napi::Value NativeEngine::GetUniformBufferOffsets(const Napi::CallbackInfo& info)
+    {
+        const auto program = info[0].As<Napi::External<ProgramData>>().Data();
+        const auto names = info[1].As<Napi::Array>();
+
+        auto length = names.Length();
+        auto offsets = Napi::Array::New(info.Env(), length);
+        for (uint32_t index = 0; index < length; ++index)
+        {
+            const auto name = names[index].As<Napi::String>().Utf8Value();
+
+            const UniformInfo* uniform{nullptr};
+            for (const auto* uniforms : {&program->VertexUniformNameToInfo, &program->FragmentUniformNameToInfo})
+            {
+                const auto found = uniforms->find(name);
+                if (found != uniforms->end())
+                {
+                    uniform = &found->second;
+                    break;
+                }
+            }
+
+            int offset{-1};
+            if (uniform != nullptr && uniform->Slot != UniformInfo::NO_SLOT)
+            {
+                offset = gsl::narrow_cast<int>(program->UniformSlots[uniform->Slot].Offset);
+            }
+
+            offsets[index] = Napi::Value::From(info.Env(), offset);
+        }
+
+        return std::move(offsets);
+    }
+
     Napi::Value NativeEngine::GetAttributes(const Napi::CallbackInfo& info)
     {
         const auto program = info[0].As<Napi::External<ProgramData>>().Data();
@@ -1078,6 +1625,14 @@ namespace Babylon
         const auto culling = info[0].As<Napi::Boolean>().Value();
         const auto reverseSide = info[2].As<Napi::Boolean>().Value();
 
+        UpdateCullState(culling, reverseSide);
+
+        // TODO: zOffset
+        //const auto zOffset = info[1].As<Napi::Number>().FloatValue();
+    }
+
+    void NativeEngine::UpdateCullState(bool culling, bool reverseSide)
+    {
         m_engineState &= ~BGFX_STATE_CULL_MASK;
         if (reverseSide)
         {
@@ -1097,9 +1652,6 @@ namespace Babylon
                 m_engineState |= BGFX_STATE_CULL_CCW;
             }
         }
-
-        // TODO: zOffset
-        //const auto zOffset = info[1].As<Napi::Number>().FloatValue();
     }
 
     void NativeEngine::SetZOffset(const Napi::CallbackInfo& /*info*/)
@@ -1117,8 +1669,11 @@ namespace Babylon
 
     void NativeEngine::SetDepthTest(const Napi::CallbackInfo& info)
     {
-        const auto enable = info[0].As<Napi::Boolean>().Value();
+        UpdateDepthTest(info[0].As<Napi::Boolean>().Value());
+    }
 
+    void NativeEngine::UpdateDepthTest(bool enable)
+    {
         m_engineState &= ~BGFX_STATE_DEPTH_TEST_MASK;
         m_engineState |= enable ? BGFX_STATE_DEPTH_TEST_LESS : BGFX_STATE_DEPTH_TEST_ALWAYS;
     }
@@ -1130,24 +1685,33 @@ namespace Babylon
 
     void NativeEngine::SetDepthWrite(const Napi::CallbackInfo& info)
     {
-        const auto enable = info[0].As<Napi::Boolean>().Value();
+        UpdateDepthWrite(info[0].As<Napi::Boolean>().Value());
+    }
 
+    void NativeEngine::UpdateDepthWrite(bool enable)
+    {
         m_engineState &= ~BGFX_STATE_WRITE_Z;
         m_engineState |= enable ? BGFX_STATE_WRITE_Z : 0;
     }
 
     void NativeEngine::SetColorWrite(const Napi::CallbackInfo& info)
     {
-        const auto enable = info[0].As<Napi::Boolean>().Value();
+        UpdateColorWrite(info[0].As<Napi::Boolean>().Value());
+    }
 
+    void NativeEngine::UpdateColorWrite(bool enable)
+    {
         m_engineState &= ~(BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A);
         m_engineState |= enable ? (BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A) : 0;
     }
 
     void NativeEngine::SetBlendMode(const Napi::CallbackInfo& info)
     {
-        const auto blendMode = info[0].As<Napi::Number>().Int32Value();
+        UpdateBlendMode(info[0].As<Napi::Number>().Int32Value());
+    }
 
+    void NativeEngine::UpdateBlendMode(int32_t blendMode)
+    {
         m_engineState &= ~BGFX_STATE_BLEND_MASK;
         m_engineState |= ALPHA_MODE[blendMode];
     }
@@ -1156,7 +1720,7 @@ namespace Babylon
     {
         const auto uniformData = info[0].As<Napi::External<UniformInfo>>().Data();
         const auto value = info[1].As<Napi::Number>().FloatValue();
-        m_currentProgram->SetUniform(uniformData->Handle, gsl::make_span(&value, 1));
+        m_currentProgram->SetUniform(*uniformData, gsl::make_span(&value, 1));
     }
 
     template<int size, typename arrayType>
@@ -1179,7 +1743,7 @@ namespace Babylon
             m_scratch.insert(m_scratch.end(), values, values + 4);
         }
 
-        m_currentProgram->SetUniform(uniformData->Handle, m_scratch, elementLength / size);
+        m_currentProgram->SetUniform(*uniformData, m_scratch, elementLength / size);
     }
 
     template<int size>
@@ -1193,7 +1757,7 @@ namespace Babylon
             (size > 3) ? info[4].As<Napi::Number>().FloatValue() : 0.f,
         };
 
-        m_currentProgram->SetUniform(uniformData->Handle, values);
+        m_currentProgram->SetUniform(*uniformData, values);
     }
 
     template<int size>
@@ -1218,11 +1782,11 @@ namespace Babylon
                 }
             }
 
-            m_currentProgram->SetUniform(uniformData->Handle, gsl::make_span(matrixValues.data(), 16));
+            m_currentProgram->SetUniform(*uniformData, gsl::make_span(matrixValues.data(), 16));
         }
         else
         {
-            m_currentProgram->SetUniform(uniformData->Handle, gsl::make_span(matrix.Data(), elementLength));
+            m_currentProgram->SetUniform(*uniformData, gsl::make_span(matrix.Data(), elementLength));
         }
     }
 
@@ -1274,7 +1838,7 @@ namespace Babylon
         const size_t elementLength = matricesArray.ElementLength();
         assert(elementLength % 16 == 0);
 
-        m_currentProgram->SetUniform(uniformData->Handle, gsl::span(matricesArray.Data(), elementLength), elementLength / 16);
+        m_currentProgram->SetUniform(*uniformData, gsl::span(matricesArray.Data(), elementLength), elementLength / 16);
     }
 
     void NativeEngine::SetMatrix2x2(const Napi::CallbackInfo& info)
@@ -1314,7 +1878,9 @@ namespace Babylon
 
     Napi::Value NativeEngine::CreateTexture(const Napi::CallbackInfo& info)
     {
-        return Napi::External<TextureData>::New(info.Env(), new TextureData());
+        auto* texture = new TextureData();
+        m_commandHandles->AddResource(texture, CommandHandleType::Texture);
+        return Napi::External<TextureData>::New(info.Env(), texture);
     }
 
     void NativeEngine::LoadTexture(const Napi::CallbackInfo& info)
@@ -1343,7 +1909,7 @@ namespace Babylon
                 }
                 return image;
             })
-            .then(m_runtimeScheduler, m_cancelSource, [texture, dataRef = Napi::Persistent(data)](bimg::ImageContainer* image) {
+            .then(m_backgroundRuntimeScheduler, m_cancelSource, [texture, dataRef = Napi::Persistent(data)](bimg::ImageContainer* image) {
                 CreateTextureFromImage(texture, image);
             })
             .then(arcana::inline_scheduler, m_cancelSource, [onSuccessRef = Napi::Persistent(onSuccess), onErrorRef = Napi::Persistent(onError)](arcana::expected<void, std::exception_ptr> result) {
@@ -1382,7 +1948,7 @@ namespace Babylon
         }
 
         arcana::when_all(gsl::make_span(tasks))
-            .then(m_runtimeScheduler, m_cancelSource,
+            .then(m_backgroundRuntimeScheduler, m_cancelSource,
                 [texture, dataRef = Napi::Persistent(data), generateMips](const std::vector<bimg::ImageContainer*>& images) {
                     CreateCubeTextureFromImages(texture, images, generateMips);
                 })
@@ -1422,10 +1988,10 @@ namespace Babylon
         }
 
         arcana::when_all(gsl::make_span(tasks))
-            .then(m_runtimeScheduler, m_cancelSource, [texture, dataRef = Napi::Persistent(data)](std::vector<bimg::ImageContainer*> images) {
+            .then(m_backgroundRuntimeScheduler, m_cancelSource, [texture, dataRef = Napi::Persistent(data)](std::vector<bimg::ImageContainer*> images) {
                 CreateCubeTextureFromImages(texture, images, true);
             })
-            .then(m_runtimeScheduler, m_cancelSource, [this, onSuccessRef = Napi::Persistent(onSuccess)]() {
+            .then(m_backgroundRuntimeScheduler, m_cancelSource, [this, onSuccessRef = Napi::Persistent(onSuccess)]() {
                 onSuccessRef.Call({Napi::Value::From(Env(), true)});
             })
             .then(arcana::inline_scheduler, m_cancelSource, [this, onErrorRef = Napi::Persistent(onError)](arcana::expected<void, std::exception_ptr> result) {
@@ -1522,6 +2088,7 @@ namespace Babylon
     void NativeEngine::DeleteTexture(const Napi::CallbackInfo& info)
     {
         const auto texture = info[0].As<Napi::External<TextureData>>().Data();
+        m_commandHandles->RemoveResource(texture);
         delete texture;
     }
 
@@ -1593,8 +2160,94 @@ namespace Babylon
     void NativeEngine::DrawIndexed(const Napi::CallbackInfo& info)
     {
         const auto fillMode = info[0].As<Napi::Number>().Int32Value();
-        //const auto elementStart = info[1].As<Napi::Number>().Int32Value();
-        //const auto elementCount = info[2].As<Napi::Number>().Int32Value();
+        const auto elementStart = info[1].As<Napi::Number>().Uint32Value();
+        const auto elementCount = info[2].As<Napi::Number>().Uint32Value();
+
+        SetIndexRange(elementStart, elementCount);
+        SubmitDraw(fillMode);
+    }
+
+    void NativeEngine::MultiDrawIndexed(const Napi::CallbackInfo& info)
+    {
+        const auto fillMode = info[0].As<Napi::Number>().Int32Value();
+        const auto ranges = info[1].As<Napi::Int32Array>();
+
+        // (elementStart, elementCount, baseVertex) per draw.
+        constexpr size_t RANGE_SIZE{3};
+        if (ranges.ElementLength() % RANGE_SIZE != 0)
+        {
+            throw Napi::Error::New(info.Env(), "Draw ranges must come in (elementStart, elementCount, baseVertex) triples.");
+        }
+
+        if (m_boundVertexArray == nullptr)
+        {
+            throw Napi::Error::New(info.Env(), "multiDrawIndexed requires a bound vertex array.");
+        }
+
+        // Checked before anything is submitted. A negative base vertex, which GL allows, would
+        // otherwise wrap around to a huge offset.
+        const int32_t* begin = ranges.Data();
+        const int32_t* end = begin + ranges.ElementLength();
+        if (std::any_of(begin, end, [](int32_t value) { return value < 0; }))
+        {
+            throw Napi::Error::New(info.Env(), "Draw ranges must not be negative.");
+        }
+
+        // Every draw shares the program, state, uniforms and textures, so only the buffer ranges
+        // change between submits.
+        bool offsetVertices{false};
+        for (const int32_t* range = begin; range != end; range += RANGE_SIZE)
+        {
+            const auto baseVertex = static_cast<uint32_t>(range[2]);
+            if (baseVertex != 0 || offsetVertices)
+            {
+                ApplyVertexBuffers(*m_boundVertexArray, baseVertex);
+                offsetVertices = baseVertex != 0;
+            }
+
+            SetIndexRange(static_cast<uint32_t>(range[0]), static_cast<uint32_t>(range[1]));
+            SubmitDraw(fillMode);
+        }
+
+        if (offsetVertices)
+        {
+            ApplyVertexBuffers(*m_boundVertexArray, 0);
+        }
+    }
+
+    void NativeEngine::DrawIndexedInstanced(const Napi::CallbackInfo& info)
+    {
+        const auto fillMode = info[0].As<Napi::Number>().Int32Value();
+        const auto elementStart = info[1].As<Napi::Number>().Uint32Value();
+        const auto elementCount = info[2].As<Napi::Number>().Uint32Value();
+        const auto& instanceBufferData = *(info[3].As<Napi::External<InstanceBufferData>>().Data());
+        const auto startInstance = info[4].As<Napi::Number>().Uint32Value();
+        const auto instanceCount = info[5].As<Napi::Number>().Uint32Value();
+
+        instanceBufferData.SetAsBgfxInstanceDataBuffer(startInstance, instanceCount);
+        SetIndexRange(elementStart, elementCount);
+        SubmitDraw(fillMode);
+
+        // Android submits without discarding, and the next draw may not be instanced.
+        bgfx::discard(BGFX_DISCARD_INSTANCE_DATA);
+    }
+
+    void NativeEngine::SubmitDraw(int32_t fillMode)
+    {
+#if (ANDROID)
+        // TODO : find why we need to discard state on Android
+        constexpr uint8_t DISCARD_FLAGS{BGFX_DISCARD_NONE};
+#else
+        constexpr uint8_t DISCARD_FLAGS{BGFX_DISCARD_INSTANCE_DATA | BGFX_DISCARD_STATE | BGFX_DISCARD_TRANSFORM};
+#endif
+
+        if (!bgfx::isValid(m_currentProgram->Program))
+        {
+            // Still being compiled by createProgramAsync. What the draw set is dropped as if it had
+            // been submitted, so it does not carry over to the next one.
+            bgfx::discard(DISCARD_FLAGS);
+            return;
+        }
 
         // TODO: handle viewport
 
@@ -1605,25 +2258,77 @@ namespace Babylon
             fillModeState |= BGFX_STATE_PT_POINTS;
         }
 
-        for (const auto& it : m_currentProgram->Uniforms)
+        const bgfx::ViewId viewId = m_frameBufferManager.GetBound().ViewId;
+        const uint64_t state = m_engineState | fillModeState;
+        const DrawKey drawKey{viewId, m_currentProgram->Program.idx, state};
+        if (drawKey != m_submittedUniformsDrawKey)
         {
-            const ProgramData::UniformValue& value = it.second;
-            bgfx::setUniform({it.first}, value.Data.data(), value.ElementLength);
+            InvalidateSubmittedUniforms();
+            m_submittedUniformsDrawKey = drawKey;
         }
 
-        bgfx::setState(m_engineState | fillModeState);
-#if (ANDROID)
-        // TODO : find why we need to discard state on Android
-        bgfx::submit(m_frameBufferManager.GetBound().ViewId, m_currentProgram->Program, 0, false);
-#else
-        bgfx::submit(m_frameBufferManager.GetBound().ViewId, m_currentProgram->Program, 0, BGFX_DISCARD_INSTANCE_DATA | BGFX_DISCARD_STATE | BGFX_DISCARD_TRANSFORM);
-#endif
+        SubmitUniforms(*m_currentProgram);
+
+        bgfx::setState(state);
+        bgfx::submit(viewId, m_currentProgram->Program, 0, DISCARD_FLAGS);
+    }
+
+    void NativeEngine::SubmitUniforms(ProgramData& program)
+    {
+        program.CheckSharedUniformBlock();
+
+        for (auto& slot : program.UniformSlots)
+        {
+            if (slot.ElementLength == 0)
+            {
+                continue;
+            }
+
+            if (slot.Handle.idx >= m_submittedUniforms.size())
+            {
+                m_submittedUniforms.resize(slot.Handle.idx + 1);
+            }
+
+            auto& submitted = m_submittedUniforms[slot.Handle.idx];
+            if (!slot.Dirty && !program.IsUniformBlockShared() && submitted.ProgramId == program.Id)
+            {
+                ++m_frameStats.UniformUpdatesSkipped;
+                continue;
+            }
+
+            slot.Dirty = false;
+            submitted.ProgramId = program.Id;
+
+            // Dirty slots and shared uniform blocks may still hold the value last submitted.
+            const float* values = program.UniformValues.data() + slot.Offset;
+            const size_t length = static_cast<size_t>(slot.ElementLength) * slot.ElementSize;
+            if (submitted.ElementLength == slot.ElementLength && std::memcmp(submitted.Values.data(), values, length * sizeof(float)) == 0)
+            {
+                ++m_frameStats.UniformUpdatesSkipped;
+                continue;
+            }
+
+            bgfx::setUniform(slot.Handle, values, slot.ElementLength);
+            ++m_frameStats.UniformUpdates;
+
+            submitted.ElementLength = slot.ElementLength;
+            submitted.Values.assign(values, values + length);
+        }
+    }
+
+    void NativeEngine::InvalidateSubmittedUniforms()
+    {
+        for (auto& submitted : m_submittedUniforms)
+        {
+            submitted.ProgramId = 0;
+            submitted.ElementLength = 0;
+        }
     }
 
     void NativeEngine::Draw(const Napi::CallbackInfo& info)
     {
         bgfx::discard(BGFX_DISCARD_INDEX_BUFFER);
-        DrawIndexed(info);
+        SubmitDraw(info[0].As<Napi::Number>().Int32Value());
     }
 
     void NativeEngine::Clear(const Napi::CallbackInfo& info)
@@ -1691,11 +2396,253 @@ namespace Babylon
         return Napi::Value::From(info.Env(), static_cast<int>(bgfx::getRendererType()));
     }
 
+    Napi::Value NativeEngine::GetFrameStats(const Napi::CallbackInfo& info)
+    {
+        auto stats = Napi::Object::New(info.Env());
+        stats.Set("uniformUpdates", Napi::Value::From(info.Env(), m_lastFrameStats.UniformUpdates));
+        stats.Set("uniformUpdatesSkipped", Napi::Value::From(info.Env(), m_lastFrameStats.UniformUpdatesSkipped));
+        return std::move(stats);
+    }
+
+    Napi::Value NativeEngine::GetShaderCacheStats(const Napi::CallbackInfo& info)
+    {
+        const auto cacheStats = ShaderCache::GetInstance().GetStats();
+
+        auto stats = Napi::Object::New(info.Env());
+        stats.Set("memoryHits", Napi::Value::From(info.Env(), static_cast<double>(cacheStats.MemoryHits)));
+        stats.Set("packHits", Napi::Value::From(info.Env(), static_cast<double>(cacheStats.PackHits)));
+        stats.Set("diskHits", Napi::Value::From(info.Env(), static_cast<double>(cacheStats.DiskHits)));
+        stats.Set("misses", Napi::Value::From(info.Env(), static_cast<double>(cacheStats.Misses)));
+
+        // Variants that share a cache key share their bgfx shaders and program, so these show how
+        // many createProgram calls and shader stages were deduplicated.
+        const auto requestedPrograms = cacheStats.MemoryHits + cacheStats.PackHits + cacheStats.DiskHits + cacheStats.Misses;
+        const auto* bgfxStats = bgfx::getStats();
+        stats.Set("requestedPrograms", Napi::Value::From(info.Env(), static_cast<double>(requestedPrograms)));
+        stats.Set("requestedShaders", Napi::Value::From(info.Env(), static_cast<double>(requestedPrograms * 2)));
+        stats.Set("uniquePrograms", Napi::Value::From(info.Env(), static_cast<double>(bgfxStats->numPrograms)));
+        stats.Set("uniqueShaders", Napi::Value::From(info.Env(), static_cast<double>(bgfxStats->numShaders)));
+
+        const auto binaryStats = ProgramBinaryCache::GetInstance().GetStats();
+        stats.Set("programBinaryHits", Napi::Value::From(info.Env(), static_cast<double>(binaryStats.Hits)));
+        stats.Set("programBinaryMisses", Napi::Value::From(info.Env(), static_cast<double>(binaryStats.Misses)));
+        stats.Set("programBinaryRejected", Napi::Value::From(info.Env(), static_cast<double>(binaryStats.Rejected)));
+        return std::move(stats);
+    }
+
+    Napi::Value NativeEngine::CreateCommandHandle(const Napi::CallbackInfo& info)
+    {
+        const uint32_t handle = m_commandHandles->Create(info[0].As<Napi::External<void>>().Data());
+        if (handle == 0)
+        {
+            throw Napi::Error::New(info.Env(), "Command handles can only refer to live programs, uniforms, textures and vertex arrays.");
+        }
+
+        return Napi::Value::From(info.Env(), handle);
+    }
+
+    void NativeEngine::DeleteCommandHandle(const Napi::CallbackInfo& info)
+    {
+        if (!m_commandHandles->Delete(info[0].As<Napi::Number>().Uint32Value()))
+        {
+            throw Napi::Error::New(info.Env(), "Invalid command handle.");
+        }
+    }
+
+    template<typename T>
+    T* NativeEngine::GetCommandHandleData(Napi::Env env, uint32_t handle) const
+    {
+        const auto* entry = m_commandHandles->Find(handle);
+        if (entry == nullptr)
+        {
+            throw Napi::Error::New(env, "Invalid command handle, or its resource has been deleted.");
+        }
+
+        if (entry->Type != CommandHandleTypeOf<T>::Value)
+        {
+            throw Napi::Error::New(env, "Command handle refers to a different type of resource.");
+        }
+
+        return static_cast<T*>(entry->Resource);
+    }
+
+    // Executes a whole buffer of commands in one call, which saves the per-call argument
+    // marshalling of the individual methods. Commands preceding a malformed one have already
+    // been executed when the error is thrown.
+    void NativeEngine::SubmitCommands(const Napi::CallbackInfo& info)
+    {
+        gsl::span<const uint8_t> bytes{};
+        if (info[0].IsArrayBuffer())
+        {
+            const auto buffer = info[0].As<Napi::ArrayBuffer>();
+            bytes = gsl::make_span(static_cast<const uint8_t*>(buffer.Data()), buffer.ByteLength());
+        }
+        else
+        {
+            const auto array = info[0].As<Napi::TypedArray>();
+            bytes = gsl::make_span(static_cast<const uint8_t*>(array.ArrayBuffer().Data()) + array.ByteOffset(), array.ByteLength());
+        }
+
+        // Lets a frame reuse one large buffer and submit only the part it wrote.
+        if (info.Length() > 1 && !info[1].IsUndefined())
+        {
+            const uint32_t byteLength = info[1].As<Napi::Number>().Uint32Value();
+            if (byteLength > static_cast<size_t>(bytes.size()))
+            {
+                throw Napi::Error::New(info.Env(), "Command buffer length exceeds the buffer.");
+            }
+
+            bytes = bytes.first(byteLength);
+        }
+
+        const auto env = info.Env();
+        const auto currentProgram = [this, env]() {
+            if (m_currentProgram == nullptr)
+            {
+                throw Napi::Error::New(env, "No program is set.");
+            }
+
+            return m_currentProgram;
+        };
+
+        CommandBufferReader reader{env, bytes};
+        while (reader.HasCommands())
+        {
+            switch (reader.ReadCommandType())
+            {
+                case CommandType::SetProgram:
+                {
+                    m_currentProgram = GetCommandHandleData<ProgramData>(env, reader.ReadUint32());
+                    break;
+                }
+                case CommandType::SetState:
+                {
+                    const bool culling = reader.ReadBool();
+                    reader.ReadFloat(); // TODO: zOffset, as in SetState.
+                    const bool reverseSide = reader.ReadBool();
+                    UpdateCullState(culling, reverseSide);
+                    break;
+                }
+                case CommandType::SetDepthTest:
+                {
+                    UpdateDepthTest(reader.ReadBool());
+                    break;
+                }
+                case CommandType::SetDepthWrite:
+                {
+                    UpdateDepthWrite(reader.ReadBool());
+                    break;
+                }
+                case CommandType::SetColorWrite:
+                {
+                    UpdateColorWrite(reader.ReadBool());
+                    break;
+                }
+                case CommandType::SetBlendMode:
+                {
+                    const int32_t blendMode = reader.ReadInt32();
+                    if (blendMode < 0 || static_cast<size_t>(blendMode) >= ALPHA_MODE.size())
+                    {
+                        throw Napi::Error::New(env, "Invalid blend mode.");
+                    }
+
+                    UpdateBlendMode(blendMode);
+                    break;
+                }
+                case CommandType::SetInt:
+                {
+                    const auto uniform = GetCommandHandleData<UniformInfo>(env, reader.ReadUint32());
+                    const auto value = static_cast<float>(reader.ReadInt32());
+                    currentProgram()->SetUniform(*uniform, gsl::make_span(&value, 1));
+                    break;
+                }
+                case CommandType::SetFloat:
+                {
+                    const auto uniform = GetCommandHandleData<UniformInfo>(env, reader.ReadUint32());
+                    currentProgram()->SetUniform(*uniform, ReadUniformVector<1>(reader));
+                    break;
+                }
+                case CommandType::SetFloat2:
+                {
+                    const auto uniform = GetCommandHandleData<UniformInfo>(env, reader.ReadUint32());
+                    currentProgram()->SetUniform(*uniform, ReadUniformVector<2>(reader));
+                    break;
+                }
+                case CommandType::SetFloat3:
+                {
+                    const auto uniform = GetCommandHandleData<UniformInfo>(env, reader.ReadUint32());
+                    currentProgram()->SetUniform(*uniform, ReadUniformVector<3>(reader));
+                    break;
+                }
+                case CommandType::SetFloat4:
+                {
+                    const auto uniform = GetCommandHandleData<UniformInfo>(env, reader.ReadUint32());
+                    currentProgram()->SetUniform(*uniform, ReadUniformVector<4>(reader));
+                    break;
+                }
+                case CommandType::SetMatrix:
+                {
+                    const auto uniform = GetCommandHandleData<UniformInfo>(env, reader.ReadUint32());
+                    currentProgram()->SetUniform(*uniform, reader.ReadFloats<16>());
+                    break;
+                }
+                case CommandType::SetTexture:
+                {
+                    const auto uniform = GetCommandHandleData<UniformInfo>(env, reader.ReadUint32());
+                    const auto texture = GetCommandHandleData<TextureData>(env, reader.ReadUint32());
+                    bgfx::setTexture(uniform->Stage, uniform->Handle, texture->Handle, texture->Flags);
+                    break;
+                }
+                case CommandType::BindVertexArray:
+                {
+                    ApplyVertexArray(*GetCommandHandleData<VertexArray>(env, reader.ReadUint32()));
+                    break;
+                }
+                case CommandType::DrawIndexed:
+                {
+                    const int32_t fillMode = reader.ReadInt32();
+                    const uint32_t elementStart = reader.ReadUint32();
+                    const uint32_t elementCount = reader.ReadUint32();
+                    currentProgram();
+                    SetIndexRange(elementStart, elementCount);
+                    SubmitDraw(fillMode);
+                    break;
+                }
+                case CommandType::Draw:
+                {
+                    const int32_t fillMode = reader.ReadInt32();
+                    reader.ReadInt32(); // verticesStart, ignored as in Draw.
+                    reader.ReadInt32(); // verticesCount
+                    currentProgram();
+                    bgfx::discard(BGFX_DISCARD_INDEX_BUFFER);
+                    SubmitDraw(fillMode);
+                    break;
+                }
+                default:
+                {
+                    throw Napi::Error::New(env, "Unknown command.");
+                }
+            }
+        }
+    }
+
     void NativeEngine::EndFrame()
     {
         GetFrameBufferManager().Reset();
 
-        bgfx::frame();
+        Frame();
+        m_arrayReferences->DeleteReleased();
+
+        // View ids are reused by the next frame, so nothing submitted in this one can be relied on.
+        InvalidateSubmittedUniforms();
+        m_submittedUniformsDrawKey = {};
+        m_lastFrameStats = std::exchange(m_frameStats, {});
+
+        if (!m_firstFrameRecorded)
+        {
+            StartupProfiler::Mark("First frame", "NativeEngine");
+            m_firstFrameRecorded = true;
+        }
     }
 
     void NativeEngine::Dispatch(std::function<void()> function)
@@ -2,6 +2,8 @@
 
 #include "ShaderCompiler.h"
 #include "BgfxCallback.h"
+#include "CommandBuffer.h"
+#include "ShaderCache.h"
 
 #include <Babylon/JsRuntime.h>
 #include <Babylon/JsRuntimeScheduler.h>
@@ -21,6 +23,11 @@
 
 #include <arcana/containers/weak_table.h>
 #include <arcana/threading/cancellation.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
 namespace Babylon
@@ -284,9 +291,13 @@ namespace Babylon
 
     struct UniformInfo final
     {
+        static constexpr uint16_t NO_SLOT{UINT16_MAX};
+
         uint8_t Stage{};
         // uninitilized bgfx resource is BGFX_INVALID_HANDLE. 0 can be a valid handle.
         bgfx::UniformHandle Handle{bgfx::kInvalidHandle};
+        // Index into the owning program's UniformSlots. Samplers have no slot.
+        uint16_t Slot{NO_SLOT};
     };
 
     struct TextureData final
@@ -326,36 +337,160 @@ namespace Babylon
 
         ~ProgramData()
         {
-            bgfx::destroy(Program);
+            if (bgfx::isValid(Program))
+            {
+                bgfx::destroy(Program);
+            }
         }
 
         std::unordered_map<std::string, uint32_t> AttributeLocations{};
         std::unordered_map<std::string, UniformInfo> VertexUniformNameToInfo{};
         std::unordered_map<std::string, UniformInfo> FragmentUniformNameToInfo{};
 
-        bgfx::ProgramHandle Program{};
+        // Invalid until the shaders are compiled, which createProgramAsync does in the background.
+        bgfx::ProgramHandle Program{bgfx::kInvalidHandle};
 
-        struct UniformValue
+        // Identifies the program in NativeEngine's record of submitted uniform values. Unlike the
+        // address, it is never reused.
+        const uint64_t Id{s_nextId++};
+
+        struct UniformSlot
         {
-            std::vector<float> Data{};
-            uint16_t ElementLength{};
+            bgfx::UniformHandle Handle{bgfx::kInvalidHandle};
+            uint32_t Offset{};         // Into UniformBlock, in floats.
+            uint32_t Capacity{};       // In floats.
+            uint16_t ElementSize{};    // Floats per element of the bgfx uniform type.
+            uint16_t ElementLength{};  // Elements last set, 0 if never set.
+            bool Dirty{};              // Changed since this program last submitted it.
         };
 
-        std::unordered_map<uint16_t, UniformValue> Uniforms{};
+        // The values of all non-sampler uniforms, laid out once when the program is created. It is
+        // never resized afterwards, so setting a uniform does not allocate.
+        std::vector<float> UniformBlock{};
+        std::vector<UniformSlot> UniformSlots{};
+
+        // Where the uniform values live: UniformBlock, or SharedUniformBlock once script has asked
+        // for it. Script writes to the shared block directly, so its slots carry no dirty state.
+        // UniformValues points into the shared block's buffer, which is referenced so that it
+        // cannot be collected.
+        gsl::span<float> UniformValues{};
+        Napi::Reference<Napi::Float32Array> SharedUniformBlock{};
+        Napi::Reference<Napi::ArrayBuffer> SharedUniformBuffer{};
+
+        bool IsUniformBlockShared() const
+        {
+            return !SharedUniformBlock.IsEmpty();
+        }
+
+        // Script can still detach the shared block's buffer, for example by transferring it, which
+        // would leave UniformValues dangling. The values then go back to UniformBlock, holding
+        // what they were when the block was shared, and a later getUniformBuffer shares a new one.
+        void CheckSharedUniformBlock()
+        {
+            if (!IsUniformBlockShared())
+            {
+                return;
+            }
+
+            const auto buffer = SharedUniformBuffer.Value();
+            if (buffer.Data() == UniformValues.data() && buffer.ByteLength() >= UniformValues.size_bytes())
+            {
+                return;
+            }
+
+            SharedUniformBlock.Reset();
+            SharedUniformBuffer.Reset();
+            UniformValues = UniformBlock;
+            for (auto& slot : UniformSlots)
+            {
+                slot.Dirty = true;
+            }
+        }
+
+        void SetUniform(const UniformInfo& uniform, gsl::span<const float> data, size_t elementLength = 1)
+        {
+            CheckSharedUniformBlock();
+
+            UniformSlot* slot = FindUniformSlot(uniform);
+            if (slot == nullptr)
+            {
+                // Not a uniform of this program, so no draw with it could observe the value.
+                return;
+            }
+
+            const size_t length = std::min(static_cast<size_t>(data.size()), static_cast<size_t>(slot->Capacity));
+            const auto clampedElementLength = static_cast<uint16_t>(std::min(elementLength, static_cast<size_t>(slot->Capacity / slot->ElementSize)));
 
-        void SetUniform(bgfx::UniformHandle handle, gsl::span<const float> data, size_t elementLength = 1)
+            float* values = UniformValues.data() + slot->Offset;
+            if (slot->ElementLength == clampedElementLength && std::memcmp(values, data.data(), length * sizeof(float)) == 0)
+            {
+                return;
+            }
+
+            std::memcpy(values, data.data(), length * sizeof(float));
+            slot->ElementLength = clampedElementLength;
+            slot->Dirty = true;
+        }
+
+    private:
+        UniformSlot* FindUniformSlot(const UniformInfo& uniform)
         {
-            UniformValue& value = Uniforms[handle.idx];
-            value.Data.assign(data.begin(), data.end());
-            value.ElementLength = static_cast<uint16_t>(elementLength);
+            if (uniform.Slot < UniformSlots.size() && UniformSlots[uniform.Slot].Handle.idx == uniform.Handle.idx)
+            {
+                return &UniformSlots[uniform.Slot];
+            }
+
+            // The uniform was looked up through another program that shares it.
+            for (auto& slot : UniformSlots)
+            {
+                if (slot.Handle.idx == uniform.Handle.idx)
+                {
+                    return &slot;
+                }
+            }
+
+            return nullptr;
         }
+
+        static inline uint64_t s_nextId{1};
     };
 
     class IndexBufferData;
     class VertexBufferData;
+    class ArrayReference;
+
+    // Holds the JavaScript arrays bgfx has released from any thread until the JavaScript thread
+    // deletes them. Owned by NativeEngine and by every array bgfx still reads, so it outlives
+    // whichever goes first. Once closed, arrays released later are leaked rather than deleted,
+    // since the JavaScript runtime may already be gone.
+    class ArrayReferenceQueue final
+    {
+    public:
+        ~ArrayReferenceQueue();
+
+        // Called for every array handed to bgfx.
+        void AddPending();
+        bool HasPending() const;
+
+        // May be called from any thread.
+        void Release(std::unique_ptr<ArrayReference> reference);
+
+        // Called on the JavaScript thread.
+        void DeleteReleased();
+        void Close();
+
+    private:
+        mutable std::mutex m_mutex{};
+        std::vector<std::unique_ptr<ArrayReference>> m_released{};
+        size_t m_pendingCount{};
+        bool m_closed{};
+    };
 
     struct VertexArray final
     {
+        // Releases the layouts of the vertex buffers.
+        ~VertexArray();
+
         struct IndexBuffer
         {
             const IndexBufferData* data{};
@@ -363,10 +498,25 @@ namespace Babylon
 
         IndexBuffer indexBuffer{};
 
+        // An attribute at a byte offset within each vertex of a stream.
+        struct Attribute
+        {
+            bgfx::Attrib::Enum attrib{};
+            uint8_t count{};
+            bgfx::AttribType::Enum type{};
+            bool normalized{};
+            uint16_t offset{};
+        };
+
+        // One bgfx vertex stream, which reads every attribute recorded for the same buffer, stride
+        // and start vertex. The layout is rebuilt from the attributes whenever one is recorded.
         struct VertexBuffer
         {
             const VertexBufferData* data{};
             uint32_t startVertex{};
+            std::vector<Attribute> attributes{};
+            bgfx::VertexLayout layout{};
+            bgfx::VertexLayoutHandle layoutHandle{bgfx::kInvalidHandle};
         };
 
         std::vector<VertexBuffer> vertexBuffers{};
@@ -386,6 +536,10 @@ namespace Babylon
         static void DeinitializeWindow();
         static void Initialize(Napi::Env);
 
+        // Every bgfx::frame call must go through here, so that transient buffers can tell which
+        // frame they were filled in.
+        static void Frame();
+
         FrameBufferManager& GetFrameBufferManager();
         void Dispatch(std::function<void()>);
         void EndFrame();
@@ -399,16 +553,31 @@ namespace Babylon
         Napi::Value CreateVertexArray(const Napi::CallbackInfo& info);
         void DeleteVertexArray(const Napi::CallbackInfo& info);
         void BindVertexArray(const Napi::CallbackInfo& info);
+        // Static index and vertex buffers are uploaded straight from the array passed to
+        // createIndexBuffer or createVertexBuffer, which bgfx reads in place rather than copying.
+        // Script must not write to that array afterwards: bgfx reads it until the end of the frame
+        // that uploads the buffer, and a static vertex buffer is only uploaded once a vertex array
+        // first records it. Dynamic buffers copy their array.
         Napi::Value CreateIndexBuffer(const Napi::CallbackInfo& info);
         void DeleteIndexBuffer(const Napi::CallbackInfo& info);
         void RecordIndexBuffer(const Napi::CallbackInfo& info);
         void UpdateDynamicIndexBuffer(const Napi::CallbackInfo& info);
+        Napi::Value CreateTransientIndexBuffer(const Napi::CallbackInfo& info);
+        void UpdateTransientIndexBuffer(const Napi::CallbackInfo& info);
         Napi::Value CreateVertexBuffer(const Napi::CallbackInfo& info);
         void DeleteVertexBuffer(const Napi::CallbackInfo& info);
         void RecordVertexBuffer(const Napi::CallbackInfo& info);
         void UpdateDynamicVertexBuffer(const Napi::CallbackInfo& info);
+        Napi::Value CreateTransientVertexBuffer(const Napi::CallbackInfo& info);
+        void UpdateTransientVertexBuffer(const Napi::CallbackInfo& info);
+        Napi::Value CreateInstanceBuffer(const Napi::CallbackInfo& info);
+        void DeleteInstanceBuffer(const Napi::CallbackInfo& info);
+        void UpdateInstanceBuffer(const Napi::CallbackInfo& info);
         Napi::Value CreateProgram(const Napi::CallbackInfo& info);
+        Napi::Value CreateProgramAsync(const Napi::CallbackInfo& info);
         Napi::Value GetUniforms(const Napi::CallbackInfo& info);
+        Napi::Value GetUniformBuffer(const Napi::CallbackInfo& info);
+        Napi::Value GetUniformBufferOffsets(const Napi::CallbackInfo& info);
         Napi::Value GetAttributes(const Napi::CallbackInfo& info);
         void SetProgram(const Napi::CallbackInfo& info);
         void SetState(const Napi::CallbackInfo& info);
@@ -452,6 +621,8 @@ namespace Babylon
         void BindFrameBuffer(const Napi::CallbackInfo& info);
         void UnbindFrameBuffer(const Napi::CallbackInfo& info);
         void DrawIndexed(const Napi::CallbackInfo& info);
+        void DrawIndexedInstanced(const Napi::CallbackInfo& info);
+        void MultiDrawIndexed(const Napi::CallbackInfo& info);
         void Draw(const Napi::CallbackInfo& info);
         void Clear(const Napi::CallbackInfo& info);
         void ClearColor(const Napi::CallbackInfo& info);
@@ -463,19 +634,65 @@ namespace Babylon
         void GetFramebufferData(const Napi::CallbackInfo& info);
         void BindBuffer(const Napi::CallbackInfo& info);
         Napi::Value GetRenderAPI(const Napi::CallbackInfo& info);
+        Napi::Value GetFrameStats(const Napi::CallbackInfo& info);
+        Napi::Value GetShaderCacheStats(const Napi::CallbackInfo& info);
+        Napi::Value CreateCommandHandle(const Napi::CallbackInfo& info);
+        void DeleteCommandHandle(const Napi::CallbackInfo& info);
+        void SubmitCommands(const Napi::CallbackInfo& info);
 
         void UpdateSize(size_t width, size_t height);
 
+        Napi::External<ProgramData> CreateProgramHandle(Napi::Env env);
+
+        // Safe to call from any thread.
+        static std::shared_ptr<const CompiledProgram> CompileProgram(ShaderCompiler& shaderCompiler, const std::string& vertexSource, const std::string& fragmentSource);
+
+        // Shared by the individual methods above and by SubmitCommands.
+        void UpdateCullState(bool culling, bool reverseSide);
+        void UpdateDepthTest(bool enable);
+        void UpdateDepthWrite(bool enable);
+        void UpdateColorWrite(bool enable);
+        void UpdateBlendMode(int32_t blendMode);
+        void ApplyVertexArray(const VertexArray& vertexArray);
+        void ApplyVertexBuffers(const VertexArray& vertexArray, uint32_t baseVertex);
+        void SetIndexRange(uint32_t elementStart, uint32_t elementCount);
+        void SubmitUniforms(ProgramData& program);
+        void InvalidateSubmittedUniforms();
+        void SubmitDraw(int32_t fillMode);
+
+        template<typename T>
+        T* GetCommandHandleData(Napi::Env env, uint32_t handle) const;
+
         arcana::cancellation_source m_cancelSource{};
 
-        ShaderCompiler m_shaderCompiler;
+        // Shared with the compiles started by createProgramAsync, which do not hold the engine.
+        std::shared_ptr<ShaderCompiler> m_shaderCompiler{std::make_shared<ShaderCompiler>()};
+
+        // The compiles started by createProgramAsync that have not yet handed their result to the
+        // runtime. Dispose waits for them, so none outlives the engine or its runtime.
+        struct AsyncCompiles
+        {
+            std::mutex Mutex{};
+            std::condition_variable Finished{};
+            size_t Running{};
+            bool Disposed{};
+        };
+
+        std::shared_ptr<AsyncCompiles> m_asyncCompiles{std::make_shared<AsyncCompiles>()};
 
         ProgramData* m_currentProgram{nullptr};
+        const VertexArray* m_boundVertexArray{nullptr};
         arcana::weak_table<std::unique_ptr<ProgramData>> m_programDataCollection{};
 
         JsRuntime& m_runtime;
         JsRuntimeScheduler m_runtimeScheduler;
 
+        std::shared_ptr<ArrayReferenceQueue> m_arrayReferences{std::make_shared<ArrayReferenceQueue>()};
+
+        // Texture decode completions and GPU uploads run here so that a burst of them
+        // cannot delay frame callbacks or input.
+        JsRuntimeScheduler m_backgroundRuntimeScheduler;
+
         bx::DefaultAllocator m_allocator;
         uint64_t m_engineState;
 
@@ -495,7 +712,56 @@ namespace Babylon
 
         // Scratch vector used for data alignment.
         std::vector<float> m_scratch{};
+
+        // The last value given to bgfx::setUniform for each uniform handle, and which program
+        // gave it. bgfx keeps uniform values between draws, so a draw only needs to set the
+        // uniforms whose values differ from the draw rendered before it. bgfx sorts the draws of a
+        // view, but its sort is stable and keyed on the view, program and blend state, so a draw
+        // submitted right after one with the same view, program and state also renders right after
+        // it. The record is therefore dropped whenever any of those change and at the end of each
+        // frame.
+        struct SubmittedUniform
+        {
+            uint64_t ProgramId{};
+            uint16_t ElementLength{};
+            std::vector<float> Values{};
+        };
+
+        struct DrawKey
+        {
+            bgfx::ViewId ViewId{UINT16_MAX};
+            uint16_t Program{bgfx::kInvalidHandle};
+            uint64_t State{};
+
+            bool operator==(const DrawKey& other) const
+            {
+                return ViewId == other.ViewId && Program == other.Program && State == other.State;
+            }
+
+            bool operator!=(const DrawKey& other) const
+            {
+                return !(*this == other);
+            }
+        };
+
+        std::vector<SubmittedUniform> m_submittedUniforms{};
+        DrawKey m_submittedUniformsDrawKey{};
+
+        struct FrameStats
+        {
+            uint32_t UniformUpdates{};
+            uint32_t UniformUpdatesSkipped{};
+        };
+
+        FrameStats m_frameStats{};
+        FrameStats m_lastFrameStats{};
+
+        // Resources referenced by command buffers. Shared with the finalizers of programs, which
+        // remove them from the table.
+        std::shared_ptr<CommandHandleTable> m_commandHandles{std::make_shared<CommandHandleTable>()};
         
         Napi::FunctionReference m_requestAnimationFrameCalback{};
+
+        bool m_firstFrameRecorded{false};
     };
 }
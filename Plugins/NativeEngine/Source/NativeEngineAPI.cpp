@@ -1,8 +1,15 @@
 #include <Babylon/Plugins/NativeEngine.h>
 #include "NativeEngine.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
 
 #include <NativeWindow.h>
 
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
 namespace Babylon::Plugins::NativeEngine
 {
     void InitializeGraphics(void* windowPtr, size_t width, size_t height)
@@ -29,11 +36,55 @@ namespace Babylon::Plugins::NativeEngine
         auto& window = Plugins::Internal::NativeWindow::GetFromJavaScript(env);
         window.Resize(width, height, windowPtr);
         // flush bgfx so the resize (and swapchain update) happens here
-        bgfx::frame();
+        Babylon::NativeEngine::Frame();
     }
 
     void DeinitializeGraphics()
     {
         Babylon::NativeEngine::DeinitializeWindow();
     }
+
+    void SetShaderOptimization(ShaderOptimization optimization)
+    {
+        switch (optimization)
+        {
+            case ShaderOptimization::None:
+                ShaderCompiler::SetOptimization(ShaderCompiler::Optimization::None);
+                break;
+            case ShaderOptimization::Performance:
+                ShaderCompiler::SetOptimization(ShaderCompiler::Optimization::Performance);
+                break;
+            case ShaderOptimization::Size:
+                ShaderCompiler::SetOptimization(ShaderCompiler::Optimization::Size);
+                break;
+        }
+    }
+
+    void EnableShaderCache(std::string directory)
+    {
+        ShaderCache::GetInstance().EnableDiskCache(std::move(directory));
+    }
+
+    void LoadShaderPack(const std::string& path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        if (!file)
+        {
+            throw std::runtime_error{"Cannot open shader pack " + path + "."};
+        }
+
+        const std::vector<uint8_t> bytes{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        auto pack = ShaderPack::Deserialize(bytes);
+        if (!pack.has_value())
+        {
+            throw std::runtime_error{"Invalid shader pack " + path + "."};
+        }
+
+        ShaderCache::GetInstance().AddPack(std::move(pack.value()));
+    }
+
+    void EnableProgramBinaryCache(std::string directory, size_t maxSize)
+    {
+        ProgramBinaryCache::GetInstance().Enable(std::move(directory), maxSize);
+    }
 }
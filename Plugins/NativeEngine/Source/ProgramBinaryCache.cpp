@@ -0,0 +1,423 @@
+#include "ProgramBinaryCache.h"
+
+#include <arcana/threading/task.h>
+#include <arcana/threading/task_schedulers.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace Babylon
+{
+    namespace
+    {
+        constexpr uint32_t FILE_MAGIC{0x42504E42}; // "BNPB"
+        constexpr uint32_t INDEX_MAGIC{0x49504E42}; // "BNPI"
+        constexpr uint32_t FORMAT_VERSION{1};
+        constexpr const char* FILE_EXTENSION{".bin"};
+        constexpr const char* INDEX_FILE_NAME{"index.dat"};
+
+        // Magic, version, id, payload size and payload checksum.
+        constexpr size_t HEADER_SIZE{sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint64_t)};
+
+        // Magic, version, entry count and checksum of the entries, followed by the entries.
+        constexpr size_t INDEX_HEADER_SIZE{sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t)};
+
+        // Id, size and last use.
+        constexpr size_t INDEX_ENTRY_SIZE{sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint64_t)};
+
+        uint64_t GetChecksum(gsl::span<const uint8_t> data)
+        {
+            // FNV-1a.
+            uint64_t hash{14695981039346656037ull};
+            for (uint8_t byte : data)
+            {
+                hash ^= byte;
+                hash *= 1099511628211ull;
+            }
+
+            return hash;
+        }
+
+        std::string GetPath(const std::string& directory, uint64_t id)
+        {
+            char name[17]{};
+            std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(id));
+            return directory + "/" + name + FILE_EXTENSION;
+        }
+
+        std::string GetIndexPath(const std::string& directory)
+        {
+            return directory + "/" + INDEX_FILE_NAME;
+        }
+
+        // Creates the directory and any missing parents. A directory that can't be created shows
+        // up as entries that fail to write.
+        void CreateDirectories(const std::string& directory)
+        {
+            for (size_t end = directory.find_first_of("/\\", 1); ; end = directory.find_first_of("/\\", end + 1))
+            {
+                const std::string parent{directory.substr(0, end)};
+#ifdef _WIN32
+                _mkdir(parent.c_str());
+#else
+                mkdir(parent.c_str(), 0755);
+#endif
+
+                if (end == std::string::npos)
+                {
+                    return;
+                }
+            }
+        }
+
+        template<typename T>
+        void WriteValue(std::vector<uint8_t>& bytes, T value)
+        {
+            const auto* valueBytes = reinterpret_cast<const uint8_t*>(&value);
+            bytes.insert(bytes.end(), valueBytes, valueBytes + sizeof(T));
+        }
+
+        template<typename T>
+        T ReadValue(const std::vector<uint8_t>& bytes, size_t& offset)
+        {
+            T value;
+            std::memcpy(&value, bytes.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return value;
+        }
+
+        std::optional<std::vector<uint8_t>> ReadFile(const std::string& path)
+        {
+            std::ifstream file{path, std::ios::binary};
+            if (!file)
+            {
+                return {};
+            }
+
+            return std::vector<uint8_t>{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        }
+
+        // Writes to a temporary file first so that readers never observe a partial file.
+        bool WriteFile(const std::string& path, const std::vector<uint8_t>& bytes)
+        {
+            static std::atomic<uint64_t> s_tempFileCounter{};
+            const std::string tempPath{path + "." + std::to_string(s_tempFileCounter++) + ".tmp"};
+
+            {
+                std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+                file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+                if (!file)
+                {
+                    file.close();
+                    std::remove(tempPath.c_str());
+                    return false;
+                }
+            }
+
+#ifdef _WIN32
+            // Unlike POSIX rename, the Windows one does not replace an existing file.
+            std::remove(path.c_str());
+#endif
+            if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+            {
+                std::remove(tempPath.c_str());
+                return false;
+            }
+
+            return true;
+        }
+
+        // Returns the payload, or nothing if the file is missing, truncated, corrupted or was
+        // written for another id or format version.
+        std::optional<std::vector<uint8_t>> ReadEntry(const std::string& path, uint64_t id)
+        {
+            auto bytes = ReadFile(path);
+            if (!bytes.has_value() || bytes->size() < HEADER_SIZE)
+            {
+                return {};
+            }
+
+            size_t offset{0};
+            const auto magic = ReadValue<uint32_t>(bytes.value(), offset);
+            const auto version = ReadValue<uint32_t>(bytes.value(), offset);
+            const auto storedId = ReadValue<uint64_t>(bytes.value(), offset);
+            const auto size = ReadValue<uint32_t>(bytes.value(), offset);
+            const auto checksum = ReadValue<uint64_t>(bytes.value(), offset);
+            if (magic != FILE_MAGIC || version != FORMAT_VERSION || storedId != id || bytes->size() - HEADER_SIZE != size)
+            {
+                return {};
+            }
+
+            bytes->erase(bytes->begin(), bytes->begin() + HEADER_SIZE);
+            if (GetChecksum(bytes.value()) != checksum)
+            {
+                return {};
+            }
+
+            return bytes;
+        }
+
+        bool WriteEntry(const std::string& path, uint64_t id, gsl::span<const uint8_t> data)
+        {
+            std::vector<uint8_t> bytes{};
+            bytes.reserve(HEADER_SIZE + data.size());
+            WriteValue(bytes, FILE_MAGIC);
+            WriteValue(bytes, FORMAT_VERSION);
+            WriteValue(bytes, id);
+            WriteValue(bytes, static_cast<uint32_t>(data.size()));
+            WriteValue(bytes, GetChecksum(data));
+            bytes.insert(bytes.end(), data.begin(), data.end());
+
+            return WriteFile(path, bytes);
+        }
+
+        template<typename IndexEntryT>
+        std::vector<uint8_t> SerializeIndex(const std::unordered_map<uint64_t, IndexEntryT>& index)
+        {
+            std::vector<uint8_t> entries{};
+            entries.reserve(index.size() * INDEX_ENTRY_SIZE);
+            for (const auto& [id, entry] : index)
+            {
+                WriteValue(entries, id);
+                WriteValue(entries, static_cast<uint64_t>(entry.Size));
+                WriteValue(entries, entry.LastUse);
+            }
+
+            std::vector<uint8_t> bytes{};
+            bytes.reserve(INDEX_HEADER_SIZE + entries.size());
+            WriteValue(bytes, INDEX_MAGIC);
+            WriteValue(bytes, FORMAT_VERSION);
+            WriteValue(bytes, static_cast<uint32_t>(index.size()));
+            WriteValue(bytes, GetChecksum(entries));
+            bytes.insert(bytes.end(), entries.begin(), entries.end());
+            return bytes;
+        }
+
+        // Returns nothing if the index is missing, truncated, corrupted or of another format
+        // version, in which case the cache starts out empty.
+        template<typename IndexEntryT>
+        std::optional<std::unordered_map<uint64_t, IndexEntryT>> DeserializeIndex(const std::vector<uint8_t>& bytes)
+        {
+            if (bytes.size() < INDEX_HEADER_SIZE)
+            {
+                return {};
+            }
+
+            size_t offset{0};
+            const auto magic = ReadValue<uint32_t>(bytes, offset);
+            const auto version = ReadValue<uint32_t>(bytes, offset);
+            const auto count = ReadValue<uint32_t>(bytes, offset);
+            const auto checksum = ReadValue<uint64_t>(bytes, offset);
+            if (magic != INDEX_MAGIC || version != FORMAT_VERSION || bytes.size() - INDEX_HEADER_SIZE != count * INDEX_ENTRY_SIZE ||
+                GetChecksum({bytes.data() + INDEX_HEADER_SIZE, static_cast<std::ptrdiff_t>(bytes.size() - INDEX_HEADER_SIZE)}) != checksum)
+            {
+                return {};
+            }
+
+            std::unordered_map<uint64_t, IndexEntryT> index{};
+            for (uint32_t entry = 0; entry < count; ++entry)
+            {
+                const auto id = ReadValue<uint64_t>(bytes, offset);
+                const auto size = ReadValue<uint64_t>(bytes, offset);
+                const auto lastUse = ReadValue<uint64_t>(bytes, offset);
+                index[id] = {static_cast<size_t>(size), lastUse};
+            }
+
+            return index;
+        }
+    }
+
+    ProgramBinaryCache& ProgramBinaryCache::GetInstance()
+    {
+        static ProgramBinaryCache instance{};
+        return instance;
+    }
+
+    void ProgramBinaryCache::Enable(std::string directory, size_t maxSize)
+    {
+        CreateDirectories(directory);
+
+        // Entries are only validated when read; until then the indexed size is close enough.
+        std::unordered_map<uint64_t, IndexEntry> index{};
+        if (const auto bytes = ReadFile(GetIndexPath(directory)))
+        {
+            index = DeserializeIndex<IndexEntry>(bytes.value()).value_or(std::unordered_map<uint64_t, IndexEntry>{});
+        }
+
+        size_t totalSize{0};
+        uint64_t lastUse{0};
+        for (const auto& [id, entry] : index)
+        {
+            totalSize += entry.Size;
+            lastUse = std::max(lastUse, entry.LastUse);
+        }
+
+        std::scoped_lock lock{m_mutex};
+        m_directory = std::move(directory);
+        m_maxSize = maxSize;
+        m_index = std::move(index);
+        m_totalSize = totalSize;
+        m_lastUse = lastUse;
+        Evict();
+    }
+
+    uint32_t ProgramBinaryCache::GetSize(uint64_t id)
+    {
+        std::scoped_lock lock{m_mutex};
+        m_pendingData.clear();
+
+        if (!m_directory.has_value())
+        {
+            return 0;
+        }
+
+        if (m_index.find(id) == m_index.end())
+        {
+            ++m_stats.Misses;
+            return 0;
+        }
+
+        const std::string path{GetPath(m_directory.value(), id)};
+        auto data = ReadEntry(path, id);
+        if (!data.has_value() || data->empty())
+        {
+            // An interrupted write or an outside modification; the entry can't be trusted.
+            ++m_stats.Rejected;
+            ++m_stats.Misses;
+            Remove(id);
+            return 0;
+        }
+
+        m_index[id].LastUse = ++m_lastUse;
+        SaveIndex();
+
+        m_pendingId = id;
+        m_pendingData = std::move(data.value());
+        return static_cast<uint32_t>(m_pendingData.size());
+    }
+
+    bool ProgramBinaryCache::Read(uint64_t id, gsl::span<uint8_t> data)
+    {
+        std::scoped_lock lock{m_mutex};
+        if (m_pendingData.empty() || m_pendingId != id || static_cast<size_t>(data.size()) != m_pendingData.size())
+        {
+            ++m_stats.Misses;
+            return false;
+        }
+
+        std::memcpy(data.data(), m_pendingData.data(), m_pendingData.size());
+        m_pendingData.clear();
+        ++m_stats.Hits;
+        return true;
+    }
+
+    void ProgramBinaryCache::Write(uint64_t id, gsl::span<const uint8_t> data)
+    {
+        std::string directory{};
+        {
+            std::scoped_lock lock{m_mutex};
+            if (!m_directory.has_value() || HEADER_SIZE + static_cast<size_t>(data.size()) > m_maxSize)
+            {
+                return;
+            }
+
+            directory = m_directory.value();
+        }
+
+        // The data belongs to bgfx and is only valid during the callback.
+        arcana::make_task(arcana::threadpool_scheduler, arcana::cancellation::none(), [this, id, directory{std::move(directory)}, bytes{std::vector<uint8_t>{data.begin(), data.end()}}]() {
+            const std::string path{GetPath(directory, id)};
+            const bool written = WriteEntry(path, id, bytes);
+
+            std::scoped_lock lock{m_mutex};
+            if (m_directory != directory)
+            {
+                return;
+            }
+
+            if (!written)
+            {
+                Remove(id);
+                return;
+            }
+
+            const size_t size{HEADER_SIZE + bytes.size()};
+            auto& indexEntry = m_index[id];
+            m_totalSize = m_totalSize - indexEntry.Size + size;
+            indexEntry = {size, ++m_lastUse};
+            Evict();
+            SaveIndex();
+        });
+    }
+
+    ProgramBinaryCache::Stats ProgramBinaryCache::GetStats() const
+    {
+        std::scoped_lock lock{m_mutex};
+        return m_stats;
+    }
+
+    void ProgramBinaryCache::Remove(uint64_t id)
+    {
+        std::remove(GetPath(m_directory.value(), id).c_str());
+
+        auto indexEntry = m_index.find(id);
+        if (indexEntry != m_index.end())
+        {
+            m_totalSize -= indexEntry->second.Size;
+            m_index.erase(indexEntry);
+            SaveIndex();
+        }
+    }
+
+    void ProgramBinaryCache::Evict()
+    {
+        while (m_totalSize > m_maxSize && !m_index.empty())
+        {
+            auto leastRecentlyUsed = std::min_element(m_index.begin(), m_index.end(), [](const auto& a, const auto& b) {
+                return a.second.LastUse < b.second.LastUse;
+            });
+
+            Remove(leastRecentlyUsed->first);
+        }
+    }
+
+    void ProgramBinaryCache::SaveIndex()
+    {
+        if (m_indexSaveScheduled)
+        {
+            return;
+        }
+
+        m_indexSaveScheduled = true;
+        arcana::make_task(arcana::threadpool_scheduler, arcana::cancellation::none(), [this]() {
+            // Held across the write so that an older index never replaces a newer one.
+            std::scoped_lock fileLock{m_indexFileMutex};
+
+            std::string directory{};
+            std::vector<uint8_t> bytes{};
+            {
+                std::scoped_lock lock{m_mutex};
+                m_indexSaveScheduled = false;
+                if (!m_directory.has_value())
+                {
+                    return;
+                }
+
+                directory = m_directory.value();
+                bytes = SerializeIndex(m_index);
+            }
+
+            WriteFile(GetIndexPath(directory), bytes);
+        });
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <gsl/gsl>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Babylon
+{
+    // Driver-specific binaries that bgfx hands to BgfxCallback, such as linked OpenGL programs from
+    // glGetProgramBinary, stored one file per id. Unlike ShaderCache, which skips our own shader
+    // compiler, this skips the driver's compile and link. Every file carries a checksum so that
+    // truncated or corrupted entries are discarded. The total size is bounded; the least recently
+    // used entries are evicted first. Sizes and uses are kept in an index file next to the entries,
+    // so the cache needs no directory listing or file times.
+    class ProgramBinaryCache final
+    {
+    public:
+        struct Stats
+        {
+            uint64_t Hits{};
+            uint64_t Misses{};
+            uint64_t Rejected{};
+        };
+
+        static constexpr size_t DEFAULT_MAX_SIZE{64 * 1024 * 1024};
+
+        static ProgramBinaryCache& GetInstance();
+
+        // Loads the index of an existing cache directory, creating the directory if needed.
+        // Until this is called the cache stores and finds nothing.
+        void Enable(std::string directory, size_t maxSize);
+
+        // bgfx asks for the size of an entry and then reads it into a buffer of that size, so the
+        // entry found by GetSize is kept until the matching Read.
+        uint32_t GetSize(uint64_t id);
+        bool Read(uint64_t id, gsl::span<uint8_t> data);
+
+        // The file is written on a background thread.
+        void Write(uint64_t id, gsl::span<const uint8_t> data);
+
+        Stats GetStats() const;
+
+    private:
+        struct IndexEntry
+        {
+            size_t Size{};
+            // A counter rather than a time, which only has to order the entries.
+            uint64_t LastUse{};
+        };
+
+        ProgramBinaryCache() = default;
+
+        void Remove(uint64_t id);
+        void Evict();
+        void SaveIndex();
+
+        mutable std::mutex m_mutex{};
+        std::optional<std::string> m_directory{};
+        size_t m_maxSize{DEFAULT_MAX_SIZE};
+        size_t m_totalSize{};
+        std::unordered_map<uint64_t, IndexEntry> m_index{};
+        uint64_t m_lastUse{};
+
+        // Index saves run on the thread pool. One is scheduled at a time and writes the index as it
+        // is when the save starts, so any number of changes are coalesced into one write.
+        std::mutex m_indexFileMutex{};
+        bool m_indexSaveScheduled{};
+
+        uint64_t m_pendingId{};
+        std::vector<uint8_t> m_pendingData{};
+
+        Stats m_stats{};
+    };
+}
@@ -0,0 +1,340 @@
+#include "ProgramCompiler.h"
+#include "ShaderCompiler.h"
+#include <spirv_cross.hpp>
+#include <spirv_parser.hpp>
+
+#include <bgfx/bgfx.h>
+#include <bx/bx.h>
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+// TODO: this needs to be fixed in bgfx
+namespace bgfx
+{
+    uint16_t attribToId(Attrib::Enum _attr);
+}
+
+#define BGFX_UNIFORM_FRAGMENTBIT UINT8_C(0x10) // Copy-pasta from bgfx_p.h
+#define BGFX_UNIFORM_SAMPLERBIT UINT8_C(0x20)  // Copy-pasta from bgfx_p.h
+
+namespace Babylon
+{
+    namespace
+    {
+        template<typename AppendageT>
+        inline void AppendBytes(std::vector<uint8_t>& bytes, const AppendageT appendage)
+        {
+            auto ptr = reinterpret_cast<const uint8_t*>(&appendage);
+            auto stride = static_cast<std::ptrdiff_t>(sizeof(AppendageT));
+            bytes.insert(bytes.end(), ptr, ptr + stride);
+        }
+
+        template<typename AppendageT = std::string&>
+        inline void AppendBytes(std::vector<uint8_t>& bytes, const std::string& string)
+        {
+            auto ptr = reinterpret_cast<const uint8_t*>(string.data());
+            auto stride = static_cast<std::ptrdiff_t>(string.length());
+            bytes.insert(bytes.end(), ptr, ptr + stride);
+        }
+
+        template<typename ElementT>
+        inline void AppendBytes(std::vector<uint8_t>& bytes, const gsl::span<ElementT>& data)
+        {
+            auto ptr = reinterpret_cast<const uint8_t*>(data.data());
+            auto stride = static_cast<std::ptrdiff_t>(data.size() * sizeof(ElementT));
+            bytes.insert(bytes.end(), ptr, ptr + stride);
+        }
+
+        struct NonSamplerUniformsInfo
+        {
+            struct Uniform
+            {
+                enum class TypeEnum
+                {
+                    Vec4,
+                    Mat4
+                };
+
+                std::string Name{};
+                uint32_t Offset{};
+                uint16_t RegisterSize{};
+                TypeEnum Type{};
+            };
+
+            uint16_t ByteSize{};
+            std::vector<Uniform> Uniforms{};
+        };
+
+        void AppendUniformBuffer(std::vector<uint8_t>& bytes, const NonSamplerUniformsInfo& uniformBuffer, bool isFragment)
+        {
+            const uint8_t fragmentBit = (isFragment ? BGFX_UNIFORM_FRAGMENTBIT : 0);
+
+            for (const auto& uniform : uniformBuffer.Uniforms)
+            {
+                bgfx::UniformType::Enum bgfxType;
+
+                switch (uniform.Type)
+                {
+                    case NonSamplerUniformsInfo::Uniform::TypeEnum::Vec4:
+                        bgfxType = bgfx::UniformType::Vec4;
+                        break;
+                    case NonSamplerUniformsInfo::Uniform::TypeEnum::Mat4:
+                        bgfxType = bgfx::UniformType::Mat4;
+                        break;
+                    default:
+                        throw std::runtime_error{"Unrecognized uniform type."};
+                }
+
+                AppendBytes(bytes, static_cast<uint8_t>(uniform.Name.size()));
+                AppendBytes(bytes, uniform.Name);
+                AppendBytes(bytes, static_cast<uint8_t>(bgfxType | fragmentBit));
+                AppendBytes(bytes, static_cast<uint8_t>(0)); // Value "num" not used by D3D11 pipeline.
+                AppendBytes(bytes, static_cast<uint16_t>(uniform.Offset));
+                AppendBytes(bytes, static_cast<uint16_t>(uniform.RegisterSize));
+            }
+        }
+
+        void AppendSamplers(std::vector<uint8_t>& bytes, const spirv_cross::Compiler& compiler, const spirv_cross::SmallVector<spirv_cross::Resource>& samplers, bool /*isFragment*/, std::unordered_map<std::string, uint8_t>& stages)
+        {
+            for (const spirv_cross::Resource& sampler : samplers)
+            {
+                AppendBytes(bytes, static_cast<uint8_t>(sampler.name.size()));
+                AppendBytes(bytes, sampler.name);
+                AppendBytes(bytes, static_cast<uint8_t>(bgfx::UniformType::Sampler | BGFX_UNIFORM_SAMPLERBIT));
+
+                // TODO : These values (num, regIndex, regCount) are only used by Vulkan and should be set for that API
+                AppendBytes(bytes, static_cast<uint8_t>(0));
+                AppendBytes(bytes, static_cast<uint16_t>(0));
+                AppendBytes(bytes, static_cast<uint16_t>(0));
+
+                stages[sampler.name] = static_cast<uint8_t>(compiler.get_decoration(sampler.id, spv::DecorationBinding));
+            }
+        }
+
+        NonSamplerUniformsInfo CollectNonSamplerUniforms(spirv_cross::Parser& parser, const spirv_cross::Compiler& compiler)
+        {
+            NonSamplerUniformsInfo info{};
+
+            const auto& resources = compiler.get_shader_resources();
+            if (resources.uniform_buffers.size() == 1)
+            {
+                const auto& uniformBuffer = resources.uniform_buffers[0];
+                const auto& type = compiler.get_type(uniformBuffer.base_type_id);
+                assert(type.basetype == spirv_cross::SPIRType::BaseType::Struct);
+
+                info.ByteSize = static_cast<uint16_t>(compiler.get_declared_struct_size(type));
+
+                info.Uniforms.resize(type.member_types.size());
+                for (uint32_t index = 0; index < type.member_types.size(); ++index)
+                {
+                    auto& uniform = info.Uniforms[index];
+
+                    uniform.Name = compiler.get_member_name(uniformBuffer.base_type_id, index);
+                    uniform.Offset = compiler.get_member_decoration(uniformBuffer.base_type_id, index, spv::DecorationOffset);
+                    
+                    const auto spirType = compiler.get_type(type.member_types[index]);
+                    if (spirType.columns == 1 && 1 <= spirType.vecsize && spirType.vecsize <= 4)
+                    {
+                        uniform.Type = NonSamplerUniformsInfo::Uniform::TypeEnum::Vec4;
+                        uniform.RegisterSize = 1;
+                    }
+                    else if (spirType.columns == 4 && spirType.vecsize == 4)
+                    {
+                        uniform.Type = NonSamplerUniformsInfo::Uniform::TypeEnum::Mat4;
+                        uniform.RegisterSize = 4;
+                    }
+                    else
+                    {
+                        throw std::runtime_error{"Unrecognized uniform type."};
+                    }
+
+                    for (const auto size : spirType.array)
+                    {
+                        uniform.RegisterSize *= static_cast<uint16_t>(size);
+                    }
+                }
+            }
+            else
+            {
+                info.ByteSize = 0;
+                parser.get_parsed_ir().for_each_typed_id<spirv_cross::SPIRVariable>([&](uint32_t id, spirv_cross::SPIRVariable& var) {
+                    auto& type = compiler.get_type_from_variable(id);
+                    if (var.storage == spv::StorageClassUniformConstant &&
+                        type.basetype != spirv_cross::SPIRType::BaseType::SampledImage &&
+                        type.basetype != spirv_cross::SPIRType::BaseType::Sampler)
+                    {
+                        auto& uniform = info.Uniforms.emplace_back();
+                        uniform.Name = compiler.get_name(id);
+                        uniform.Offset = 0; // Not actually used for anything by OpenGL.
+                        
+                        if (type.columns == 1 && 1 <= type.vecsize && type.vecsize <= 4)
+                        {
+                            uniform.Type = NonSamplerUniformsInfo::Uniform::TypeEnum::Vec4;
+                            uniform.RegisterSize = 1;
+                        }
+                        else if (type.columns == 4 && type.vecsize == 4)
+                        {
+                            uniform.Type = NonSamplerUniformsInfo::Uniform::TypeEnum::Mat4;
+                            uniform.RegisterSize = 4;
+                        }
+                        else
+                        {
+                            throw std::runtime_error{"Unrecognized uniform type."};
+                        }
+
+                        for (const auto size : type.array)
+                        {
+                            uniform.RegisterSize *= static_cast<uint16_t>(size);
+                        }
+
+                        info.ByteSize += 4 * uniform.RegisterSize;
+                    }
+                });
+            }
+
+            return info;
+        }
+    }
+
+    CompiledProgram CompileProgram(ShaderCompiler& shaderCompiler, std::string_view vertexSource, std::string_view fragmentSource)
+    {
+        CompiledProgram compiledProgram{};
+        auto& vertexBytes = compiledProgram.VertexBytes;
+        auto& fragmentBytes = compiledProgram.FragmentBytes;
+        auto& attributeLocations = compiledProgram.AttributeLocations;
+        auto& uniformRegisterSizes = compiledProgram.UniformRegisterSizes;
+
+        shaderCompiler.Compile(vertexSource, fragmentSource, [&](ShaderCompiler::ShaderInfo vertexShaderInfo, ShaderCompiler::ShaderInfo fragmentShaderInfo) {
+            constexpr uint8_t BGFX_SHADER_BIN_VERSION = 6;
+
+            // These hashes are generated internally by BGFX's custom shader compilation pipeline,
+            // which we don't have access to.  Fortunately, however, they aren't used for anything
+            // crucial; they just have to match.
+            constexpr uint32_t vertexOutputsHash = 0xBAD1DEA;
+            constexpr uint32_t fragmentInputsHash = vertexOutputsHash;
+
+            {
+                const auto& compiler = *vertexShaderInfo.Compiler;
+                const spirv_cross::ShaderResources resources = compiler.get_shader_resources();
+                auto uniformsInfo = CollectNonSamplerUniforms(*vertexShaderInfo.Parser, compiler);
+                for (const auto& uniform : uniformsInfo.Uniforms)
+                {
+                    uniformRegisterSizes[uniform.Name] = uniform.RegisterSize;
+                }
+#if (BGFX_CONFIG_RENDERER_METAL)
+                // with metal, we bind images and not samplers
+                const spirv_cross::SmallVector<spirv_cross::Resource>& samplers = resources.separate_images;
+#else
+                const spirv_cross::SmallVector<spirv_cross::Resource>& samplers = resources.separate_samplers;
+#endif
+                size_t numUniforms = uniformsInfo.Uniforms.size() + samplers.size();
+
+                AppendBytes(vertexBytes, BX_MAKEFOURCC('V', 'S', 'H', BGFX_SHADER_BIN_VERSION));
+                AppendBytes(vertexBytes, vertexOutputsHash);
+                AppendBytes(vertexBytes, fragmentInputsHash);
+
+                AppendBytes(vertexBytes, static_cast<uint16_t>(numUniforms));
+                AppendUniformBuffer(vertexBytes, uniformsInfo, false);
+                AppendSamplers(vertexBytes, compiler, samplers, false, compiledProgram.VertexSamplerStages);
+
+                AppendBytes(vertexBytes, static_cast<uint32_t>(vertexShaderInfo.Bytes.size()));
+                AppendBytes(vertexBytes, vertexShaderInfo.Bytes);
+                AppendBytes(vertexBytes, static_cast<uint8_t>(0));
+
+                std::vector<uint16_t> attributeIds{};
+                for (const spirv_cross::Resource& stageInput : resources.stage_inputs)
+                {
+                    const uint32_t location = compiler.get_decoration(stageInput.id, spv::DecorationLocation);
+
+                    // Instance data is bound by bgfx itself rather than through a vertex layout, so
+                    // like bgfx's own shader compiler, leave it out of the attribute table.
+                    if (stageInput.name.compare(0, 6, "i_data") != 0)
+                    {
+                        attributeIds.push_back(bgfx::attribToId(static_cast<bgfx::Attrib::Enum>(location)));
+                    }
+
+                    std::string attributeName = stageInput.name;
+                    if (attributeName == "a_position")
+                        attributeName = "position";
+                    else if (attributeName == "a_normal")
+                        attributeName = "normal";
+                    else if (attributeName == "a_tangent")
+                        attributeName = "tangent";
+                    else if (attributeName == "a_texcoord0")
+                        attributeName = "uv";
+                    else if (attributeName == "a_texcoord1")
+                        attributeName = "uv2";
+                    else if (attributeName == "a_texcoord2")
+                        attributeName = "uv3";
+                    else if (attributeName == "a_texcoord3")
+                        attributeName = "uv4";
+                    else if (attributeName == "a_color0")
+                        attributeName = "color";
+                    else if (attributeName == "a_indices")
+                        attributeName = "matricesIndices";
+                    else if (attributeName == "a_weight")
+                        attributeName = "matricesWeights";
+                    else if (attributeName == "i_data0")
+                        attributeName = "world0";
+                    else if (attributeName == "i_data1")
+                        attributeName = "world1";
+                    else if (attributeName == "i_data2")
+                        attributeName = "world2";
+                    else if (attributeName == "i_data3")
+                        attributeName = "world3";
+                    else if (attributeName == "i_data4")
+                        attributeName = "instanceColor";
+
+                    attributeLocations[attributeName] = location;
+                }
+
+                AppendBytes(vertexBytes, static_cast<uint8_t>(attributeIds.size()));
+                for (const uint16_t attributeId : attributeIds)
+                {
+                    AppendBytes(vertexBytes, attributeId);
+                }
+
+                AppendBytes(vertexBytes, static_cast<uint16_t>(uniformsInfo.ByteSize));
+            }
+
+            {
+                const spirv_cross::Compiler& compiler = *fragmentShaderInfo.Compiler;
+                const spirv_cross::ShaderResources resources = compiler.get_shader_resources();
+                const auto uniformsInfo = CollectNonSamplerUniforms(*fragmentShaderInfo.Parser, compiler);
+                for (const auto& uniform : uniformsInfo.Uniforms)
+                {
+                    auto& registerSize = uniformRegisterSizes[uniform.Name];
+                    registerSize = std::max(registerSize, uniform.RegisterSize);
+                }
+#if __APPLE__
+                // with metal, we bind images and not samplers
+                const spirv_cross::SmallVector<spirv_cross::Resource>& samplers = resources.separate_images;
+#else
+                const spirv_cross::SmallVector<spirv_cross::Resource>& samplers = resources.separate_samplers;
+#endif
+                size_t numUniforms = uniformsInfo.Uniforms.size() + samplers.size();
+
+                AppendBytes(fragmentBytes, BX_MAKEFOURCC('F', 'S', 'H', BGFX_SHADER_BIN_VERSION));
+                AppendBytes(fragmentBytes, vertexOutputsHash);
+                AppendBytes(fragmentBytes, fragmentInputsHash);
+
+                AppendBytes(fragmentBytes, static_cast<uint16_t>(numUniforms));
+                AppendUniformBuffer(fragmentBytes, uniformsInfo, true);
+                AppendSamplers(fragmentBytes, compiler, samplers, true, compiledProgram.FragmentSamplerStages);
+
+                AppendBytes(fragmentBytes, static_cast<uint32_t>(fragmentShaderInfo.Bytes.size()));
+                AppendBytes(fragmentBytes, fragmentShaderInfo.Bytes);
+                AppendBytes(fragmentBytes, static_cast<uint8_t>(0));
+
+                // Fragment shaders don't have attributes.
+                AppendBytes(fragmentBytes, static_cast<uint8_t>(0));
+
+                AppendBytes(fragmentBytes, static_cast<uint16_t>(uniformsInfo.ByteSize));
+            }
+        });
+
+        return compiledProgram;
+    }
+}
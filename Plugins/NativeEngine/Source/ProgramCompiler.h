@@ -0,0 +1,15 @@
+#pragma once
+
+#include "ShaderCache.h"
+
+#include <string_view>
+
+namespace Babylon
+{
+    class ShaderCompiler;
+
+    // Compiles a WebGL program into bgfx shader blobs for the renderer ShaderCompiler was built
+    // for. Throws if either shader fails to compile. Needs no bgfx context, so it also runs in
+    // the offline shader pack compiler.
+    CompiledProgram CompileProgram(ShaderCompiler& shaderCompiler, std::string_view vertexSource, std::string_view fragmentSource);
+}
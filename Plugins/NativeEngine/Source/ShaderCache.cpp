@@ -0,0 +1,480 @@
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+
+#include <arcana/threading/task.h>
+#include <arcana/threading/task_schedulers.h>
+
+#include <bgfx/bgfx.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace Babylon
+{
+    namespace
+    {
+        constexpr uint32_t FILE_MAGIC{0x43534E42}; // "BNSC"
+
+        // Bump whenever the serialized layout or the generated shader blobs change.
+        constexpr uint32_t FORMAT_VERSION{3};
+
+        constexpr uint32_t PACK_MAGIC{0x50534E42}; // "BNSP"
+
+        constexpr const char* FILE_EXTENSION{".shader"};
+
+        uint64_t GetHash(std::string_view key)
+        {
+            // FNV-1a.
+            uint64_t hash{14695981039346656037ull};
+            for (char c : key)
+            {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 1099511628211ull;
+            }
+
+            return hash;
+        }
+
+        std::string GetFileName(const std::string& key)
+        {
+            char name[17]{};
+            std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(GetHash(key)));
+            return name;
+        }
+
+        class Writer final
+        {
+        public:
+            template<typename T>
+            void WriteValue(T value)
+            {
+                const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+                m_bytes.insert(m_bytes.end(), bytes, bytes + sizeof(T));
+            }
+
+            void WriteBytes(gsl::span<const uint8_t> bytes)
+            {
+                WriteValue(static_cast<uint32_t>(bytes.size()));
+                m_bytes.insert(m_bytes.end(), bytes.begin(), bytes.end());
+            }
+
+            void WriteString(std::string_view string)
+            {
+                WriteBytes(gsl::make_span(reinterpret_cast<const uint8_t*>(string.data()), string.size()));
+            }
+
+            template<typename T>
+            void WriteMap(const std::unordered_map<std::string, T>& map)
+            {
+                WriteValue(static_cast<uint32_t>(map.size()));
+                for (const auto& [name, value] : map)
+                {
+                    WriteString(name);
+                    WriteValue(value);
+                }
+            }
+
+            std::vector<uint8_t> Release()
+            {
+                return std::move(m_bytes);
+            }
+
+        private:
+            std::vector<uint8_t> m_bytes{};
+        };
+
+        class Reader final
+        {
+        public:
+            explicit Reader(gsl::span<const uint8_t> bytes)
+                : m_bytes{bytes}
+            {
+            }
+
+            template<typename T>
+            bool ReadValue(T& value)
+            {
+                if (Remaining() < sizeof(T))
+                {
+                    return false;
+                }
+
+                std::memcpy(&value, m_bytes.data() + m_offset, sizeof(T));
+                m_offset += sizeof(T);
+                return true;
+            }
+
+            bool ReadBytes(std::vector<uint8_t>& bytes)
+            {
+                uint32_t size{};
+                if (!ReadValue(size) || Remaining() < size)
+                {
+                    return false;
+                }
+
+                const auto* data = m_bytes.data() + m_offset;
+                bytes.assign(data, data + size);
+                m_offset += size;
+                return true;
+            }
+
+            bool ReadString(std::string& string)
+            {
+                uint32_t size{};
+                if (!ReadValue(size) || Remaining() < size)
+                {
+                    return false;
+                }
+
+                string.assign(reinterpret_cast<const char*>(m_bytes.data() + m_offset), size);
+                m_offset += size;
+                return true;
+            }
+
+            template<typename T>
+            bool ReadMap(std::unordered_map<std::string, T>& map)
+            {
+                uint32_t count{};
+                if (!ReadValue(count))
+                {
+                    return false;
+                }
+
+                for (uint32_t index = 0; index < count; ++index)
+                {
+                    std::string name{};
+                    T value{};
+                    if (!ReadString(name) || !ReadValue(value))
+                    {
+                        return false;
+                    }
+
+                    map.emplace(std::move(name), value);
+                }
+
+                return true;
+            }
+
+            gsl::span<const uint8_t> Rest() const
+            {
+                return m_bytes.subspan(static_cast<std::ptrdiff_t>(m_offset));
+            }
+
+        private:
+            size_t Remaining() const
+            {
+                return static_cast<size_t>(m_bytes.size()) - m_offset;
+            }
+
+            gsl::span<const uint8_t> m_bytes;
+            size_t m_offset{0};
+        };
+
+        std::vector<uint8_t> ReadFile(const std::string& path)
+        {
+            std::ifstream file{path, std::ios::binary};
+            if (!file)
+            {
+                return {};
+            }
+
+            return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        }
+
+        // Writes to a temporary file first so that readers never observe a partial file.
+        void WriteFileAtomically(const std::string& path, gsl::span<const uint8_t> data)
+        {
+            static std::atomic<uint64_t> s_tempFileCounter{};
+            const std::string tempPath{path + "." + std::to_string(s_tempFileCounter++) + ".tmp"};
+
+            {
+                std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+                file.write(reinterpret_cast<const char*>(data.data()), data.size());
+                if (!file)
+                {
+                    file.close();
+                    std::remove(tempPath.c_str());
+                    return;
+                }
+            }
+
+            if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+            {
+                std::remove(tempPath.c_str());
+            }
+        }
+
+        std::shared_ptr<const CompiledProgram> FindOnDisk(const std::string& directory, const std::string& key)
+        {
+            const auto bytes = ReadFile(directory + "/" + GetFileName(key) + FILE_EXTENSION);
+
+            Reader reader{bytes};
+            uint32_t magic{};
+            uint32_t version{};
+            std::string storedKey{};
+            if (!reader.ReadValue(magic) || magic != FILE_MAGIC || !reader.ReadValue(version) || version != FORMAT_VERSION || !reader.ReadString(storedKey) || storedKey != key)
+            {
+                return {};
+            }
+
+            auto program = CompiledProgram::Deserialize(reader.Rest());
+            if (!program.has_value())
+            {
+                return {};
+            }
+
+            return std::make_shared<const CompiledProgram>(std::move(program.value()));
+        }
+
+        void StoreOnDisk(const std::string& directory, const std::string& key, const CompiledProgram& program)
+        {
+            Writer writer{};
+            writer.WriteValue(FILE_MAGIC);
+            writer.WriteValue(FORMAT_VERSION);
+            writer.WriteString(key);
+            auto bytes = writer.Release();
+
+            const auto body = program.Serialize();
+            bytes.insert(bytes.end(), body.begin(), body.end());
+
+            WriteFileAtomically(directory + "/" + GetFileName(key) + FILE_EXTENSION, bytes);
+        }
+    }
+
+    std::vector<uint8_t> CompiledProgram::Serialize() const
+    {
+        Writer writer{};
+        writer.WriteBytes(VertexBytes);
+        writer.WriteBytes(FragmentBytes);
+        writer.WriteMap(AttributeLocations);
+        writer.WriteMap(UniformRegisterSizes);
+        writer.WriteMap(VertexSamplerStages);
+        writer.WriteMap(FragmentSamplerStages);
+        return writer.Release();
+    }
+
+    std::optional<CompiledProgram> CompiledProgram::Deserialize(gsl::span<const uint8_t> bytes)
+    {
+        Reader reader{bytes};
+        CompiledProgram program{};
+        if (!reader.ReadBytes(program.VertexBytes) ||
+            !reader.ReadBytes(program.FragmentBytes) ||
+            !reader.ReadMap(program.AttributeLocations) ||
+            !reader.ReadMap(program.UniformRegisterSizes) ||
+            !reader.ReadMap(program.VertexSamplerStages) ||
+            !reader.ReadMap(program.FragmentSamplerStages))
+        {
+            return {};
+        }
+
+        return program;
+    }
+
+    void ShaderPack::Add(const std::string& key, const CompiledProgram& program)
+    {
+        m_entries[key] = program.Serialize();
+    }
+
+    std::vector<uint8_t> ShaderPack::Serialize() const
+    {
+        Writer writer{};
+        writer.WriteValue(PACK_MAGIC);
+        writer.WriteValue(FORMAT_VERSION);
+        writer.WriteValue(static_cast<uint32_t>(m_entries.size()));
+        for (const auto& [key, program] : m_entries)
+        {
+            writer.WriteString(key);
+            writer.WriteBytes(program);
+        }
+
+        return writer.Release();
+    }
+
+    std::optional<ShaderPack> ShaderPack::Deserialize(gsl::span<const uint8_t> bytes)
+    {
+        Reader reader{bytes};
+        uint32_t magic{};
+        uint32_t version{};
+        uint32_t count{};
+        if (!reader.ReadValue(magic) || magic != PACK_MAGIC || !reader.ReadValue(version) || version != FORMAT_VERSION || !reader.ReadValue(count))
+        {
+            return {};
+        }
+
+        ShaderPack pack{};
+        for (uint32_t index = 0; index < count; ++index)
+        {
+            std::string key{};
+            std::vector<uint8_t> program{};
+            if (!reader.ReadString(key) || !reader.ReadBytes(program))
+            {
+                return {};
+            }
+
+            pack.m_entries.emplace(std::move(key), std::move(program));
+        }
+
+        return pack;
+    }
+
+    std::optional<CompiledProgram> ShaderPack::Find(const std::string& key) const
+    {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+        {
+            return {};
+        }
+
+        return CompiledProgram::Deserialize(it->second);
+    }
+
+    size_t ShaderPack::Size() const
+    {
+        return m_entries.size();
+    }
+
+    ShaderCache& ShaderCache::GetInstance()
+    {
+        static ShaderCache instance{};
+        return instance;
+    }
+
+    void ShaderCache::EnableDiskCache(std::string directory)
+    {
+        std::scoped_lock lock{m_mutex};
+        m_directory = std::move(directory);
+    }
+
+    std::string ShaderCache::GetKey(std::string_view vertexSource, std::string_view fragmentSource)
+    {
+        return GetKey(GetTarget(), vertexSource, fragmentSource);
+    }
+
+    std::string ShaderCache::GetKey(std::string_view target, std::string_view vertexSource, std::string_view fragmentSource)
+    {
+        // Variants that only differ in comments, whitespace or unused macros compile to the same
+        // program, so they share a key.
+        auto& cache = GetInstance();
+        const auto preprocess = [&cache](std::string_view source, ShaderCompiler::Stage stage) {
+            auto& stages = stage == ShaderCompiler::Stage::Vertex ? cache.m_preprocessedVertexStages : cache.m_preprocessedFragmentStages;
+            const std::string sourceKey{source};
+            {
+                std::scoped_lock lock{cache.m_preprocessedMutex};
+                if (const auto* text = stages.Find(sourceKey))
+                {
+                    return *text;
+                }
+            }
+
+            auto text = ShaderCompiler::Preprocess(source, stage);
+
+            std::scoped_lock lock{cache.m_preprocessedMutex};
+            stages.Insert(sourceKey, text);
+            return text;
+        };
+
+        const auto vertexKey = preprocess(vertexSource, ShaderCompiler::Stage::Vertex);
+        const auto fragmentKey = preprocess(fragmentSource, ShaderCompiler::Stage::Fragment);
+
+        std::string key{target};
+        key.reserve(key.size() + vertexKey.size() + fragmentKey.size() + 2);
+        key += '\0';
+        key += vertexKey;
+        key += '\0';
+        key += fragmentKey;
+        return key;
+    }
+
+    std::shared_ptr<const CompiledProgram> ShaderCache::Find(const std::string& key)
+    {
+        std::optional<std::string> directory{};
+        {
+            std::scoped_lock lock{m_mutex};
+            if (const auto* program = m_programs.Find(key))
+            {
+                ++m_memoryHits;
+                return *program;
+            }
+
+            for (const auto& pack : m_packs)
+            {
+                auto program = pack.Find(key);
+                if (program.has_value())
+                {
+                    ++m_packHits;
+
+                    auto sharedProgram = std::make_shared<const CompiledProgram>(std::move(program.value()));
+                    m_programs.Insert(key, sharedProgram);
+                    return sharedProgram;
+                }
+            }
+
+            directory = m_directory;
+        }
+
+        if (directory.has_value())
+        {
+            auto program = FindOnDisk(directory.value(), key);
+            if (program)
+            {
+                ++m_diskHits;
+
+                std::scoped_lock lock{m_mutex};
+                m_programs.Insert(key, program);
+                return program;
+            }
+        }
+
+        ++m_misses;
+        return {};
+    }
+
+    void ShaderCache::Store(const std::string& key, std::shared_ptr<const CompiledProgram> program)
+    {
+        std::optional<std::string> directory{};
+        {
+            std::scoped_lock lock{m_mutex};
+            m_programs.Insert(key, program);
+            directory = m_directory;
+        }
+
+        if (directory.has_value())
+        {
+            arcana::make_task(arcana::threadpool_scheduler, arcana::cancellation::none(), [directory{std::move(directory.value())}, key, program{std::move(program)}]() {
+                StoreOnDisk(directory, key, *program);
+            });
+        }
+    }
+
+    std::string ShaderCache::GetTarget(std::string_view rendererName)
+    {
+        // The generated shaders depend on the renderer, e.g. OpenGL and OpenGL ES differ, and on
+        // how the SPIR-V in between was optimized.
+        std::string target{rendererName};
+        const auto optimization = ShaderCompiler::GetOptimization();
+        if (optimization != ShaderCompiler::Optimization::None)
+        {
+            target += optimization == ShaderCompiler::Optimization::Size ? " -Os" : " -O";
+        }
+
+        return target;
+    }
+
+    std::string ShaderCache::GetTarget()
+    {
+        return GetTarget(bgfx::getRendererName(bgfx::getRendererType()));
+    }
+
+    void ShaderCache::AddPack(ShaderPack pack)
+    {
+        std::scoped_lock lock{m_mutex};
+        m_packs.push_back(std::move(pack));
+    }
+
+    ShaderCache::Stats ShaderCache::GetStats() const
+    {
+        return {m_memoryHits, m_packHits, m_diskHits, m_misses};
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <gsl/gsl>
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Babylon
+{
+    // Everything CreateProgram needs from the shader compiler: the final bgfx shader blobs and the
+    // reflection data that cannot be recovered from them.
+    struct CompiledProgram final
+    {
+        std::vector<uint8_t> VertexBytes{};
+        std::vector<uint8_t> FragmentBytes{};
+        std::unordered_map<std::string, uint32_t> AttributeLocations{};
+        std::unordered_map<std::string, uint16_t> UniformRegisterSizes{};
+        std::unordered_map<std::string, uint8_t> VertexSamplerStages{};
+        std::unordered_map<std::string, uint8_t> FragmentSamplerStages{};
+
+        std::vector<uint8_t> Serialize() const;
+
+        // Returns nothing if the bytes are truncated or were written by another format version.
+        static std::optional<CompiledProgram> Deserialize(gsl::span<const uint8_t> bytes);
+    };
+
+    // Programs compiled ahead of time by the ShaderPackCompiler tool, by cache key.
+    class ShaderPack final
+    {
+    public:
+        void Add(const std::string& key, const CompiledProgram& program);
+
+        std::vector<uint8_t> Serialize() const;
+
+        // Returns nothing if the bytes are truncated or were written by another format version.
+        static std::optional<ShaderPack> Deserialize(gsl::span<const uint8_t> bytes);
+
+        std::optional<CompiledProgram> Find(const std::string& key) const;
+
+        size_t Size() const;
+
+    private:
+        // Serialized programs by their full key, so that no two keys can share an entry.
+        std::unordered_map<std::string, std::vector<uint8_t>> m_entries{};
+    };
+
+    // A map that forgets its least recently used entries once it holds more than its capacity.
+    // Not synchronized.
+    template<typename ValueT>
+    class LruMap final
+    {
+    public:
+        explicit LruMap(size_t capacity)
+            : m_capacity{capacity}
+        {
+        }
+
+        // Counts as a use of the entry.
+        const ValueT* Find(const std::string& key)
+        {
+            const auto found = m_index.find(key);
+            if (found == m_index.end())
+            {
+                return nullptr;
+            }
+
+            m_entries.splice(m_entries.begin(), m_entries, found->second);
+            return &found->second->second;
+        }
+
+        // Keeps the existing value if the key is already present.
+        void Insert(const std::string& key, ValueT value)
+        {
+            if (Find(key) != nullptr)
+            {
+                return;
+            }
+
+            m_entries.emplace_front(key, std::move(value));
+            m_index.emplace(m_entries.front().first, m_entries.begin());
+
+            if (m_entries.size() > m_capacity)
+            {
+                m_index.erase(m_entries.back().first);
+                m_entries.pop_back();
+            }
+        }
+
+    private:
+        using Entry = std::pair<std::string, ValueT>;
+
+        size_t m_capacity;
+        std::list<Entry> m_entries{};
+
+        // Views the keys of m_entries, whose nodes never move.
+        std::unordered_map<std::string_view, typename std::list<Entry>::iterator> m_index{};
+    };
+
+    // Compiled programs by preprocessed shader source and renderer, so that variants differing
+    // only in comments, whitespace or unused macros share an entry. Every lookup goes through
+    // memory first, then through the loaded shader packs; once a directory is set, programs are
+    // also stored on disk so that later launches skip the shader compiler. Disk entries hold their
+    // full key, so a file name collision is only a miss. Memory only keeps the most recently used
+    // programs; programs created from an entry own their bgfx handles, so evicting it only costs a
+    // later lookup on disk or a recompile.
+    //
+    // Variants that share an entry get the same shader blobs. bgfx::createShader and createProgram
+    // look blobs up by hash and hand out another reference to an existing handle, so those
+    // variants share one bgfx::ShaderHandle per stage, and one program, without a table of our own.
+    // The same goes for a stage whose blob also comes out of another program.
+    class ShaderCache final
+    {
+    public:
+        struct Stats
+        {
+            uint64_t MemoryHits{};
+            uint64_t PackHits{};
+            uint64_t DiskHits{};
+            uint64_t Misses{};
+        };
+
+        static ShaderCache& GetInstance();
+
+        // The directory must already exist. Until this is called the cache is memory only.
+        void EnableDiskCache(std::string directory);
+
+        // Identifies a program compiled for the current bgfx renderer. Throws if either source
+        // cannot be preprocessed.
+        static std::string GetKey(std::string_view vertexSource, std::string_view fragmentSource);
+
+        // Identifies a program compiled for a target, see GetTarget. Unlike the overload above,
+        // safe to call from any thread.
+        static std::string GetKey(std::string_view target, std::string_view vertexSource, std::string_view fragmentSource);
+
+        // Names what the shader compiler generates code for: the renderer, see bgfx::getRendererName,
+        // and the compiler's settings.
+        static std::string GetTarget(std::string_view rendererName);
+
+        // The target for the current bgfx renderer.
+        static std::string GetTarget();
+
+        void AddPack(ShaderPack pack);
+
+        std::shared_ptr<const CompiledProgram> Find(const std::string& key);
+
+        // Disk writes happen on a background thread.
+        void Store(const std::string& key, std::shared_ptr<const CompiledProgram> program);
+
+        Stats GetStats() const;
+
+    private:
+        static constexpr size_t MAX_MEMORY_PROGRAMS{512};
+        static constexpr size_t MAX_PREPROCESSED_STAGES{512};
+
+        mutable std::mutex m_mutex{};
+        std::optional<std::string> m_directory{};
+        LruMap<std::shared_ptr<const CompiledProgram>> m_programs{MAX_MEMORY_PROGRAMS};
+        std::vector<ShaderPack> m_packs{};
+
+        // Preprocessed stages by raw source, so that creating a program again does not run the
+        // preprocessor. They have their own lock, since m_mutex is held by lookups.
+        std::mutex m_preprocessedMutex{};
+        LruMap<std::string> m_preprocessedVertexStages{MAX_PREPROCESSED_STAGES};
+        LruMap<std::string> m_preprocessedFragmentStages{MAX_PREPROCESSED_STAGES};
+
+        std::atomic<uint64_t> m_memoryHits{};
+        std::atomic<uint64_t> m_packHits{};
+        std::atomic<uint64_t> m_diskHits{};
+        std::atomic<uint64_t> m_misses{};
+    };
+}
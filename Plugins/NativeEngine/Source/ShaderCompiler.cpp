@@ -1,6 +1,12 @@
 #include "ShaderCompiler.h"
+#include "ResourceLimits.h"
 #include <glslang/Public/ShaderLang.h>
 #include <glslang/MachineIndependent/localintermediate.h>
+#include <SPIRV/GlslangToSpv.h>
+
+#include <atomic>
+#include <cctype>
+#include <stdexcept>
 
 namespace Babylon
 {
@@ -34,6 +40,107 @@ namespace Babylon
         };
     }
 
+    namespace
+    {
+        std::atomic<ShaderCompiler::Optimization> s_optimization{ShaderCompiler::Optimization::None};
+    }
+
+    void ShaderCompiler::SetOptimization(Optimization optimization)
+    {
+        s_optimization = optimization;
+    }
+
+    ShaderCompiler::Optimization ShaderCompiler::GetOptimization()
+    {
+#ifdef BABYLON_NATIVE_SPIRV_OPTIMIZER
+        return s_optimization;
+#else
+        return Optimization::None;
+#endif
+    }
+
+    glslang::SpvOptions ShaderCompiler::GetSpvOptions()
+    {
+        // Uniform and attribute names must survive, so debug info is never stripped.
+        glslang::SpvOptions options{};
+        options.disableOptimizer = GetOptimization() == Optimization::None;
+        options.optimizeSize = GetOptimization() == Optimization::Size;
+        return options;
+    }
+
+    void ShaderCompiler::InitializeThread()
+    {
+        // glslang's process state is reference counted, and its pool allocator is per thread.
+        struct ThreadScope
+        {
+            ThreadScope()
+            {
+                glslang::InitializeProcess();
+            }
+
+            ~ThreadScope()
+            {
+                glslang::FinalizeProcess();
+            }
+        };
+
+        thread_local ThreadScope scope{};
+    }
+
+    std::string ShaderCompiler::Preprocess(std::string_view source, Stage stage)
+    {
+        InitializeThread();
+
+        glslang::TShader shader{stage == Stage::Vertex ? EShLangVertex : EShLangFragment};
+        const char* strings[]{source.data()};
+        const int lengths[]{static_cast<int>(source.size())};
+        shader.setStringsWithLengths(strings, lengths, 1);
+
+        // Same version and profile as the compilers' AddShader.
+        std::string preprocessed{};
+        glslang::TShader::ForbidIncluder includer{};
+        if (!shader.preprocess(&DefaultTBuiltInResource, 310, EProfile::EEsProfile, true, true, EShMsgDefault, &preprocessed, includer))
+        {
+            throw std::runtime_error(shader.getInfoLog());
+        }
+
+        // One line per directive or statement line, trimmed, with single spaces between tokens.
+        std::string normalized{};
+        normalized.reserve(preprocessed.size());
+        bool lineHasTokens{false};
+        bool pendingSpace{false};
+        for (char c : preprocessed)
+        {
+            if (c == '\n')
+            {
+                if (lineHasTokens)
+                {
+                    normalized += '\n';
+                }
+
+                lineHasTokens = false;
+                pendingSpace = false;
+            }
+            else if (std::isspace(static_cast<unsigned char>(c)))
+            {
+                pendingSpace = lineHasTokens;
+            }
+            else
+            {
+                if (pendingSpace)
+                {
+                    normalized += ' ';
+                    pendingSpace = false;
+                }
+
+                normalized += c;
+                lineHasTokens = true;
+            }
+        }
+
+        return normalized;
+    }
+
     void ShaderCompiler::InvertYDerivativeOperands(glslang::TShader& shader)
     {
         auto intermediate = shader.getIntermediate();
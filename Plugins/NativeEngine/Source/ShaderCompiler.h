@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <string_view>
 #include <gsl/span>
 #include <functional>
@@ -7,6 +8,7 @@
 namespace glslang
 {
     class TShader;
+    struct SpvOptions;
 }
 namespace spirv_cross
 {
@@ -19,9 +21,29 @@ namespace Babylon
     class ShaderCompiler
     {
     public:
+        // How the SPIR-V between glslang and SPIRV-Cross is optimized. Performance and Size are
+        // SPIRV-Tools' recipes of the same names.
+        enum class Optimization
+        {
+            None,
+            Performance,
+            Size
+        };
+
+        enum class Stage
+        {
+            Vertex,
+            Fragment
+        };
+
         ShaderCompiler();
         ~ShaderCompiler();
 
+        // Applies to every compilation in the process. Builds without the SPIR-V optimizer, see
+        // BABYLON_NATIVE_SPIRV_OPTIMIZER, always compile as None.
+        static void SetOptimization(Optimization optimization);
+        static Optimization GetOptimization();
+
         struct ShaderInfo
         {
             std::unique_ptr<spirv_cross::Parser> Parser;
@@ -29,9 +51,21 @@ namespace Babylon
             gsl::span<uint8_t> Bytes;
         };
 
+        // Runs the preprocessor over a shader and normalizes its whitespace, so that sources which
+        // only differ in comments, formatting or unused macros come out the same. Throws if the
+        // preprocessor fails. May be called from any thread.
+        static std::string Preprocess(std::string_view source, Stage stage);
+
+        // May be called from several threads at once.
         void Compile(std::string_view vertexSource, std::string_view fragmentSource, std::function<void(ShaderInfo, ShaderInfo)> onCompiled);
 
     protected:
+        // Makes glslang usable on the calling thread for as long as the thread lives.
+        static void InitializeThread();
+
+        // The glslang::GlslangToSpv options for the current optimization.
+        static glslang::SpvOptions GetSpvOptions();
+
         // Invert dFdy operands similar to bgfx_shader.sh
         // https://github.com/bkaradzic/bgfx/blob/7be225bf490bb1cd231cfb4abf7e617bf35b59cb/src/bgfx_shader.sh#L44-L45
         // https://github.com/bkaradzic/bgfx/blob/7be225bf490bb1cd231cfb4abf7e617bf35b59cb/src/bgfx_shader.sh#L62-L65
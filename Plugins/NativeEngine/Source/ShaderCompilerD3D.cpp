@@ -27,10 +27,10 @@ namespace Babylon
             program.addShader(&shader);
         }
 
-        std::pair<std::unique_ptr<spirv_cross::Parser>, std::unique_ptr<spirv_cross::Compiler>> CompileShader(glslang::TProgram& program, EShLanguage stage, gsl::span<const spirv_cross::HLSLVertexAttributeRemap> attributes, ID3DBlob** blob)
+        std::pair<std::unique_ptr<spirv_cross::Parser>, std::unique_ptr<spirv_cross::Compiler>> CompileShader(glslang::TProgram& program, EShLanguage stage, glslang::SpvOptions& spvOptions, gsl::span<const spirv_cross::HLSLVertexAttributeRemap> attributes, ID3DBlob** blob)
         {
             std::vector<uint32_t> spirv;
-            glslang::GlslangToSpv(*program.getIntermediate(stage), spirv);
+            glslang::GlslangToSpv(*program.getIntermediate(stage), spirv, &spvOptions);
 
             auto parser = std::make_unique<spirv_cross::Parser>(std::move(spirv));
             parser->parse();
@@ -76,6 +76,8 @@ namespace Babylon
 
     void ShaderCompiler::Compile(std::string_view vertexSource, std::string_view fragmentSource, std::function<void(ShaderInfo, ShaderInfo)> onCompiled)
     {
+        InitializeThread();
+
         glslang::TProgram program;
 
         glslang::TShader vertexShader{EShLangVertex};
@@ -119,15 +121,17 @@ namespace Babylon
         };
         // clang-format on
 
+        auto spvOptions = GetSpvOptions();
+
         Microsoft::WRL::ComPtr<ID3DBlob> vertexBlob;
-        auto [vertexParser, vertexCompiler] = CompileShader(program, EShLangVertex, attributes, &vertexBlob);
+        auto [vertexParser, vertexCompiler] = CompileShader(program, EShLangVertex, spvOptions, attributes, &vertexBlob);
         ShaderInfo vertexShaderInfo{
             std::move(vertexParser),
             std::move(vertexCompiler),
             gsl::make_span(static_cast<uint8_t*>(vertexBlob->GetBufferPointer()), vertexBlob->GetBufferSize())};
 
         Microsoft::WRL::ComPtr<ID3DBlob> fragmentBlob;
-        auto [fragmentParser, fragmentCompiler] = CompileShader(program, EShLangFragment, {}, &fragmentBlob);
+        auto [fragmentParser, fragmentCompiler] = CompileShader(program, EShLangFragment, spvOptions, {}, &fragmentBlob);
         ShaderInfo fragmentShaderInfo{
             std::move(fragmentParser),
             std::move(fragmentCompiler),
@@ -25,10 +25,10 @@ namespace Babylon
             program.addShader(&shader);
         }
 
-        std::pair<std::unique_ptr<spirv_cross::Parser>, std::unique_ptr<spirv_cross::Compiler>> CompileShader(glslang::TProgram& program, EShLanguage stage, std::string& shaderResult)
+        std::pair<std::unique_ptr<spirv_cross::Parser>, std::unique_ptr<spirv_cross::Compiler>> CompileShader(glslang::TProgram& program, EShLanguage stage, glslang::SpvOptions& spvOptions, std::string& shaderResult)
         {
             std::vector<uint32_t> spirv;
-            glslang::GlslangToSpv(*program.getIntermediate(stage), spirv);
+            glslang::GlslangToSpv(*program.getIntermediate(stage), spirv, &spvOptions);
 
             auto parser = std::make_unique<spirv_cross::Parser>(std::move(spirv));
             parser->parse();
@@ -90,6 +90,8 @@ namespace Babylon
 
     void ShaderCompiler::Compile(std::string_view vertexSource, std::string_view fragmentSource, std::function<void(ShaderInfo, ShaderInfo)> onCompiled)
     {
+        InitializeThread();
+
         glslang::TProgram program;
 
         glslang::TShader vertexShader{EShLangVertex};
@@ -115,11 +117,13 @@ namespace Babylon
         ShaderCompilerTraversers::AssignLocationsAndNamesToVertexVaryings(program, ids);
         ShaderCompilerTraversers::SplitSamplersIntoSamplersAndTextures(program, ids);
 
+        auto spvOptions = GetSpvOptions();
+
         std::string vertexGLSL(vertexSource.data(), vertexSource.size());
-        auto [vertexParser, vertexCompiler] = CompileShader(program, EShLangVertex, vertexGLSL);
+        auto [vertexParser, vertexCompiler] = CompileShader(program, EShLangVertex, spvOptions, vertexGLSL);
 
         std::string fragmentGLSL(fragmentSource.data(), fragmentSource.size());
-        auto [fragmentParser, fragmentCompiler] = CompileShader(program, EShLangFragment, fragmentGLSL);
+        auto [fragmentParser, fragmentCompiler] = CompileShader(program, EShLangFragment, spvOptions, fragmentGLSL);
 
         uint8_t* strVertex = (uint8_t*)vertexGLSL.data();
         uint8_t* strFragment = (uint8_t*)fragmentGLSL.data();
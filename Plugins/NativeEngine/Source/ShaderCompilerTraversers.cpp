@@ -377,6 +377,15 @@ namespace Babylon::ShaderCompilerTraversers
                 IF_NAME_RETURN_ATTRIB("color", bgfx::Attrib::Color0, "a_color0")
                 IF_NAME_RETURN_ATTRIB("matricesIndices", bgfx::Attrib::Indices, "a_indices")
                 IF_NAME_RETURN_ATTRIB("matricesWeights", bgfx::Attrib::Weight, "a_weight")
+
+                // Per-instance attributes, fed from bgfx's instance data buffer. bgfx binds its rows
+                // to i_data0..i_data4, which use TexCoord7 down to TexCoord3; the last one is shared
+                // with uv4.
+                IF_NAME_RETURN_ATTRIB("world0", bgfx::Attrib::TexCoord7, "i_data0")
+                IF_NAME_RETURN_ATTRIB("world1", bgfx::Attrib::TexCoord6, "i_data1")
+                IF_NAME_RETURN_ATTRIB("world2", bgfx::Attrib::TexCoord5, "i_data2")
+                IF_NAME_RETURN_ATTRIB("world3", bgfx::Attrib::TexCoord4, "i_data3")
+                IF_NAME_RETURN_ATTRIB("instanceColor", bgfx::Attrib::TexCoord3, "i_data4")
 #undef IF_NAME_RETURN_ATTRIB
                 return {FIRST_GENERIC_ATTRIBUTE_LOCATION + m_genericAttributesRunningCount++, name};
             }
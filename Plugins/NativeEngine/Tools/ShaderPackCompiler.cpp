@@ -0,0 +1,194 @@
+// Compiles the programs listed in a manifest into a shader pack that NativeEngine loads through
+// Babylon::Plugins::NativeEngine::LoadShaderPack.
+//
+// Usage: ShaderPackCompiler [--optimize none|performance|size] <manifest> <output>
+//
+// Each non-empty manifest line that does not start with '#' names a vertex and a fragment source
+// file, separated by whitespace and relative to the manifest. The files must hold the sources
+// the application passes to createProgram, up to comments and whitespace; programs are found by
+// a hash of their preprocessed text. The optimization must match the one the application sets
+// with SetShaderOptimization. When it is not none, the SPIR-V instruction counts of each shader
+// before and after optimization are printed as well.
+
+#include "ProgramCompiler.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+
+#include <bgfx/bgfx.h>
+#include <spirv_parser.hpp>
+
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace
+{
+    // The renderer that ShaderCompilerOpenGL generates shaders for.
+    constexpr bgfx::RendererType::Enum RENDERER_TYPE{bgfx::RendererType::OpenGL};
+
+    std::string ReadTextFile(const std::filesystem::path& path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        if (!file)
+        {
+            throw std::runtime_error{"Cannot open " + path.string() + "."};
+        }
+
+        return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+
+    size_t CountInstructions(spirv_cross::Parser& parser)
+    {
+        // Instructions follow the five word header; each one's first word holds its word count
+        // in the high 16 bits.
+        const auto& words = parser.get_parsed_ir().spirv;
+        size_t count{0};
+        for (size_t offset = 5; offset < words.size() && (words[offset] >> 16) != 0; offset += words[offset] >> 16)
+        {
+            ++count;
+        }
+
+        return count;
+    }
+
+    struct InstructionCounts
+    {
+        size_t Vertex{};
+        size_t Fragment{};
+    };
+
+    InstructionCounts CountInstructions(Babylon::ShaderCompiler& shaderCompiler, std::string_view vertexSource, std::string_view fragmentSource)
+    {
+        InstructionCounts counts{};
+        shaderCompiler.Compile(vertexSource, fragmentSource, [&counts](Babylon::ShaderCompiler::ShaderInfo vertexShaderInfo, Babylon::ShaderCompiler::ShaderInfo fragmentShaderInfo) {
+            counts.Vertex = CountInstructions(*vertexShaderInfo.Parser);
+            counts.Fragment = CountInstructions(*fragmentShaderInfo.Parser);
+        });
+
+        return counts;
+    }
+
+    std::optional<Babylon::ShaderCompiler::Optimization> ParseOptimization(std::string_view name)
+    {
+        if (name == "none")
+        {
+            return Babylon::ShaderCompiler::Optimization::None;
+        }
+        else if (name == "performance")
+        {
+            return Babylon::ShaderCompiler::Optimization::Performance;
+        }
+        else if (name == "size")
+        {
+            return Babylon::ShaderCompiler::Optimization::Size;
+        }
+
+        return {};
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    auto optimization = Babylon::ShaderCompiler::Optimization::None;
+    int firstPath = 1;
+    if (argc == 5 && std::string_view{argv[1]} == "--optimize")
+    {
+        const auto parsedOptimization = ParseOptimization(argv[2]);
+        if (!parsedOptimization.has_value())
+        {
+            std::fprintf(stderr, "Unknown optimization %s.\n", argv[2]);
+            return 1;
+        }
+
+        optimization = parsedOptimization.value();
+        firstPath = 3;
+    }
+    else if (argc != 3)
+    {
+        std::fprintf(stderr, "Usage: %s [--optimize none|performance|size] <manifest> <output>\n", argv[0]);
+        return 1;
+    }
+
+    const char* manifestArgument = argv[firstPath];
+    const char* outputPath = argv[firstPath + 1];
+
+    try
+    {
+        Babylon::ShaderCompiler::SetOptimization(optimization);
+        if (Babylon::ShaderCompiler::GetOptimization() != optimization)
+        {
+            throw std::runtime_error{"This build has no SPIR-V optimizer, see BABYLON_NATIVE_SPIRV_OPTIMIZER."};
+        }
+
+        const std::filesystem::path manifestPath{manifestArgument};
+        std::istringstream manifest{ReadTextFile(manifestPath)};
+        const auto rendererName = bgfx::getRendererName(RENDERER_TYPE);
+        const auto target = Babylon::ShaderCache::GetTarget(rendererName);
+
+        Babylon::ShaderCompiler shaderCompiler{};
+        Babylon::ShaderPack pack{};
+
+        std::string line{};
+        while (std::getline(manifest, line))
+        {
+            std::istringstream fields{line};
+            std::string vertexPath{};
+            std::string fragmentPath{};
+            if (!(fields >> vertexPath) || vertexPath[0] == '#')
+            {
+                continue;
+            }
+
+            if (!(fields >> fragmentPath))
+            {
+                throw std::runtime_error{"Missing fragment shader for " + vertexPath + "."};
+            }
+
+            const auto vertexSource = ReadTextFile(manifestPath.parent_path() / vertexPath);
+            const auto fragmentSource = ReadTextFile(manifestPath.parent_path() / fragmentPath);
+
+            try
+            {
+                pack.Add(Babylon::ShaderCache::GetKey(target, vertexSource, fragmentSource), Babylon::CompileProgram(shaderCompiler, vertexSource, fragmentSource));
+
+                if (optimization != Babylon::ShaderCompiler::Optimization::None)
+                {
+                    const auto optimized = CountInstructions(shaderCompiler, vertexSource, fragmentSource);
+                    Babylon::ShaderCompiler::SetOptimization(Babylon::ShaderCompiler::Optimization::None);
+                    const auto unoptimized = CountInstructions(shaderCompiler, vertexSource, fragmentSource);
+                    Babylon::ShaderCompiler::SetOptimization(optimization);
+
+                    std::printf("%s: %zu -> %zu instructions\n", vertexPath.c_str(), unoptimized.Vertex, optimized.Vertex);
+                    std::printf("%s: %zu -> %zu instructions\n", fragmentPath.c_str(), unoptimized.Fragment, optimized.Fragment);
+                }
+            }
+            catch (const std::exception& exception)
+            {
+                throw std::runtime_error{vertexPath + " + " + fragmentPath + ": " + exception.what()};
+            }
+        }
+
+        const auto bytes = pack.Serialize();
+        std::ofstream output{outputPath, std::ios::binary | std::ios::trunc};
+        output.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        if (!output)
+        {
+            throw std::runtime_error{std::string{"Cannot write "} + outputPath + "."};
+        }
+
+        std::printf("Compiled %zu programs for %s into %s.\n", pack.Size(), target.c_str(), outputPath);
+        return 0;
+    }
+    catch (const std::exception& exception)
+    {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+}
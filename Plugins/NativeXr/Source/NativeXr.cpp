@@ -341,7 +341,7 @@ namespace Babylon
                 auto depthTex = bgfx::createTexture2D(static_cast<uint16_t>(view.DepthTextureSize.Width), static_cast<uint16_t>(view.DepthTextureSize.Height), false, 1, depthTextureFormat, BGFX_TEXTURE_RT);
 
                 // Force BGFX to create the texture now, which is necessary in order to use overrideInternal.
-                bgfx::frame();
+                NativeEngine::Frame();
 
                 bgfx::overrideInternal(colorTex, colorTexPtr);
                 bgfx::overrideInternal(depthTex, reinterpret_cast<uintptr_t>(view.DepthTexturePointer));
@@ -1,6 +1,8 @@
 #include "Window.h"
 #include <basen.hpp>
+#include <algorithm>
 #include <chrono>
+#include <limits>
 
 namespace Babylon::Polyfills::Internal
 {
@@ -8,9 +10,32 @@ namespace Babylon::Polyfills::Internal
     {
         constexpr auto JS_CLASS_NAME = "Window";
         constexpr auto JS_SET_TIMEOUT_NAME = "setTimeout";
+        constexpr auto JS_SET_INTERVAL_NAME = "setInterval";
+        constexpr auto JS_CLEAR_TIMEOUT_NAME = "clearTimeout";
+        constexpr auto JS_CLEAR_INTERVAL_NAME = "clearInterval";
+        constexpr auto JS_REQUEST_IDLE_CALLBACK_NAME = "requestIdleCallback";
+        constexpr auto JS_CANCEL_IDLE_CALLBACK_NAME = "cancelIdleCallback";
         constexpr auto JS_A_TO_B_NAME = "atob";
         constexpr auto JS_ADD_EVENT_LISTENER_NAME = "addEventListener";
         constexpr auto JS_REMOVE_EVENT_LISTENER_NAME = "removeEventListener";
+
+        // Matches the longest idle period browsers hand out when no frame is pending.
+        constexpr std::chrono::milliseconds IDLE_CALLBACK_BUDGET{50};
+
+        // Browsers store delays as signed 32 bit milliseconds, about 24.8 days.
+        constexpr double MAX_DELAY{std::numeric_limits<int32_t>::max()};
+
+        std::chrono::milliseconds GetDelay(const Napi::CallbackInfo& info)
+        {
+            if (info.Length() < 2 || !info[1].IsNumber())
+            {
+                return std::chrono::milliseconds{0};
+            }
+
+            // Clamped as a double so that large delays do not wrap around; NaN becomes zero.
+            const double delay{info[1].As<Napi::Number>().DoubleValue()};
+            return std::chrono::milliseconds{delay > 0 ? static_cast<int64_t>(std::min(delay, MAX_DELAY)) : 0};
+        }
     }
 
     void Window::Initialize(Napi::Env env)
@@ -38,6 +63,31 @@ namespace Babylon::Polyfills::Internal
             global.Set(JS_SET_TIMEOUT_NAME, Napi::Function::New(env, &Window::SetTimeout, JS_SET_TIMEOUT_NAME, Window::Unwrap(jsWindow)));
         }
 
+        if (global.Get(JS_SET_INTERVAL_NAME).IsUndefined())
+        {
+            global.Set(JS_SET_INTERVAL_NAME, Napi::Function::New(env, &Window::SetInterval, JS_SET_INTERVAL_NAME, Window::Unwrap(jsWindow)));
+        }
+
+        if (global.Get(JS_CLEAR_TIMEOUT_NAME).IsUndefined())
+        {
+            global.Set(JS_CLEAR_TIMEOUT_NAME, Napi::Function::New(env, &Window::ClearTimer, JS_CLEAR_TIMEOUT_NAME, Window::Unwrap(jsWindow)));
+        }
+
+        if (global.Get(JS_CLEAR_INTERVAL_NAME).IsUndefined())
+        {
+            global.Set(JS_CLEAR_INTERVAL_NAME, Napi::Function::New(env, &Window::ClearTimer, JS_CLEAR_INTERVAL_NAME, Window::Unwrap(jsWindow)));
+        }
+
+        if (global.Get(JS_REQUEST_IDLE_CALLBACK_NAME).IsUndefined())
+        {
+            global.Set(JS_REQUEST_IDLE_CALLBACK_NAME, Napi::Function::New(env, &Window::RequestIdleCallback, JS_REQUEST_IDLE_CALLBACK_NAME, Window::Unwrap(jsWindow)));
+        }
+
+        if (global.Get(JS_CANCEL_IDLE_CALLBACK_NAME).IsUndefined())
+        {
+            global.Set(JS_CANCEL_IDLE_CALLBACK_NAME, Napi::Function::New(env, &Window::CancelIdleCallback, JS_CANCEL_IDLE_CALLBACK_NAME, Window::Unwrap(jsWindow)));
+        }
+
         if (global.Get(JS_A_TO_B_NAME).IsUndefined())
         {
             global.Set(JS_A_TO_B_NAME, Napi::Function::New(env, &Window::DecodeBase64, JS_A_TO_B_NAME));
@@ -65,14 +115,80 @@ namespace Babylon::Polyfills::Internal
     {
     }
 
-    void Window::SetTimeout(const Napi::CallbackInfo& info)
+    Napi::Value Window::SetTimeout(const Napi::CallbackInfo& info)
     {
-        auto function = Napi::Persistent(info[0].As<Napi::Function>());
-        auto milliseconds = std::chrono::milliseconds{info[1].As<Napi::Number>().Int32Value()};
+        auto& window = *static_cast<Window*>(info.Data());
+        const auto timerId = window.AddTimer(info, false);
+        window.ScheduleTimer(timerId, GetDelay(info));
+        return Napi::Value::From(info.Env(), timerId);
+    }
 
+    Napi::Value Window::SetInterval(const Napi::CallbackInfo& info)
+    {
+        auto& window = *static_cast<Window*>(info.Data());
+        const auto timerId = window.AddTimer(info, true);
+        window.ScheduleTimer(timerId, window.m_timers.at(timerId).Interval.value());
+        return Napi::Value::From(info.Env(), timerId);
+    }
+
+    void Window::ClearTimer(const Napi::CallbackInfo& info)
+    {
+        if (info.Length() < 1 || !info[0].IsNumber())
+        {
+            return;
+        }
+
+        auto& window = *static_cast<Window*>(info.Data());
+        auto it = window.m_timers.find(info[0].As<Napi::Number>().Uint32Value());
+        if (it == window.m_timers.end())
+        {
+            return;
+        }
+
+        window.m_timerQueue.erase(TimerQueueEntry{it->second.DueTime, it->first});
+        window.m_timers.erase(it);
+    }
+
+    Napi::Value Window::RequestIdleCallback(const Napi::CallbackInfo& info)
+    {
         auto& window = *static_cast<Window*>(info.Data());
+        const auto callbackId = window.m_nextIdleCallbackId++;
+        window.m_idleCallbacks.emplace(callbackId, Napi::Persistent(info[0].As<Napi::Function>()));
+
+        window.m_runtime.Dispatch([&window, callbackId](Napi::Env env) {
+            auto it = window.m_idleCallbacks.find(callbackId);
+            if (it == window.m_idleCallbacks.end())
+            {
+                return;
+            }
+
+            auto function = std::move(it->second);
+            window.m_idleCallbacks.erase(it);
 
-        window.RecursiveWaitOrCall(std::make_shared<Napi::FunctionReference>(std::move(function)), std::chrono::system_clock::now() + milliseconds);
+            const auto deadline = std::chrono::steady_clock::now() + IDLE_CALLBACK_BUDGET;
+            auto idleDeadline = Napi::Object::New(env);
+            idleDeadline.Set("didTimeout", Napi::Value::From(env, false));
+            idleDeadline.Set("timeRemaining", Napi::Function::New(env, [deadline](const Napi::CallbackInfo& info) {
+                const auto remaining = std::chrono::duration<double, std::milli>(deadline - std::chrono::steady_clock::now()).count();
+                return Napi::Value::From(info.Env(), std::max(remaining, 0.0));
+            }, "timeRemaining"));
+
+            function.Call({idleDeadline});
+        },
+            JsRuntime::DispatchPriority::Background);
+
+        return Napi::Value::From(info.Env(), callbackId);
+    }
+
+    void Window::CancelIdleCallback(const Napi::CallbackInfo& info)
+    {
+        if (info.Length() < 1 || !info[0].IsNumber())
+        {
+            return;
+        }
+
+        auto& window = *static_cast<Window*>(info.Data());
+        window.m_idleCallbacks.erase(info[0].As<Napi::Number>().Uint32Value());
     }
 
     Napi::Value Window::DecodeBase64(const Napi::CallbackInfo& info)
@@ -93,19 +209,106 @@ namespace Babylon::Polyfills::Internal
         // TODO: handle events
     }
 
-    void Window::RecursiveWaitOrCall(
-        std::shared_ptr<Napi::FunctionReference> function,
-        std::chrono::system_clock::time_point whenToRun)
+    uint32_t Window::AddTimer(const Napi::CallbackInfo& info, bool repeat)
+    {
+        Timer timer{Napi::Persistent(info[0].As<Napi::Function>())};
+
+        if (info.Length() > 2)
+        {
+            auto arguments = Napi::Array::New(info.Env(), info.Length() - 2);
+            for (uint32_t index = 2; index < info.Length(); ++index)
+            {
+                arguments.Set(index - 2, info[index]);
+            }
+            timer.Arguments = Napi::Persistent(arguments.As<Napi::Object>());
+        }
+
+        if (repeat)
+        {
+            // A zero interval would re-queue the callback back to back and starve everything else.
+            timer.Interval = std::max(GetDelay(info), std::chrono::milliseconds{1});
+        }
+
+        const auto timerId = m_nextTimerId++;
+        m_timers.emplace(timerId, std::move(timer));
+        return timerId;
+    }
+
+    void Window::ScheduleTimer(uint32_t timerId, std::chrono::milliseconds delay)
+    {
+        auto& timer = m_timers.at(timerId);
+        timer.DueTime = std::chrono::steady_clock::now() + delay;
+        m_timerQueue.emplace(timer.DueTime, timerId);
+        ScheduleDispatch();
+    }
+
+    void Window::ScheduleDispatch()
+    {
+        if (m_timerQueue.empty())
+        {
+            return;
+        }
+
+        // Only a timer due before the one already dispatched needs a new dispatch. A dispatch
+        // whose timer has since been cleared finds nothing due and schedules the next one.
+        const auto dueTime = m_timerQueue.begin()->first;
+        if (!m_scheduledDueTime.has_value() || dueTime < m_scheduledDueTime.value())
+        {
+            m_scheduledDueTime = dueTime;
+            m_runtime.DispatchAt([this, dueTime](Napi::Env) { FireNextTimer(dueTime); }, dueTime);
+        }
+    }
+
+    void Window::FireNextTimer(std::chrono::steady_clock::time_point dueTime)
+    {
+        if (m_scheduledDueTime == dueTime)
+        {
+            m_scheduledDueTime.reset();
+        }
+
+        if (m_timerQueue.empty() || m_timerQueue.begin()->first > std::chrono::steady_clock::now())
+        {
+            ScheduleDispatch();
+            return;
+        }
+
+        // One timer per dispatch, so a chain of zero delay timers cannot starve the rest of the
+        // queue. The next dispatch is scheduled first in case the callback throws.
+        const auto timerId = m_timerQueue.begin()->second;
+        m_timerQueue.erase(m_timerQueue.begin());
+        ScheduleDispatch();
+        FireTimer(timerId);
+    }
+
+    void Window::FireTimer(uint32_t timerId)
     {
-        if (std::chrono::system_clock::now() >= whenToRun)
+        auto it = m_timers.find(timerId);
+        if (it == m_timers.end())
+        {
+            return;
+        }
+
+        // The callback may clear this or any other timer, or add new ones, so nothing may hold
+        // on to the map entry across the call.
+        Napi::Function function = it->second.Function.Value();
+        Napi::Value arguments = it->second.Arguments.IsEmpty() ? Napi::Value{} : it->second.Arguments.Value();
+
+        if (it->second.Interval.has_value())
+        {
+            ScheduleTimer(timerId, it->second.Interval.value());
+        }
+        else
+        {
+            m_timers.erase(it);
+        }
+
+        if (arguments.IsEmpty())
         {
-            function->Call({});
+            function.Call({});
         }
         else
         {
-            m_runtime.Dispatch([this, function = std::move(function), whenToRun](Napi::Env) {
-                RecursiveWaitOrCall(std::move(function), whenToRun);
-            });
+            function.Get("apply").As<Napi::Function>().Call(function, {function.Env().Undefined(), arguments});
         }
     }
 }
@@ -2,6 +2,11 @@
 
 #include <Babylon/JsRuntime.h>
 
+#include <chrono>
+#include <optional>
+#include <set>
+#include <unordered_map>
+
 namespace Babylon::Polyfills::Internal
 {
     class Window : public Napi::ObjectWrap<Window>
@@ -15,13 +20,43 @@ namespace Babylon::Polyfills::Internal
         Window(const Napi::CallbackInfo& info);
 
     private:
+        // Only ever touched on the JavaScript thread. Pending timers are kept in due order here
+        // and only the earliest one is handed to DispatchAt, so clearing a timer removes it
+        // immediately instead of leaving it queued until it comes due.
+        struct Timer
+        {
+            Napi::FunctionReference Function{};
+            Napi::ObjectReference Arguments{};
+            std::optional<std::chrono::milliseconds> Interval{};
+            std::chrono::steady_clock::time_point DueTime{};
+        };
+
+        using TimerQueueEntry = std::pair<std::chrono::steady_clock::time_point, uint32_t>;
+
         JsRuntime& m_runtime;
+        std::unordered_map<uint32_t, Timer> m_timers{};
+        std::set<TimerQueueEntry> m_timerQueue{};
+        std::optional<std::chrono::steady_clock::time_point> m_scheduledDueTime{};
+        uint32_t m_nextTimerId{1};
+
+        // Idle callbacks have their own ids, as in browsers, so clearTimeout and
+        // cancelIdleCallback cannot cancel each other's callbacks.
+        std::unordered_map<uint32_t, Napi::FunctionReference> m_idleCallbacks{};
+        uint32_t m_nextIdleCallbackId{1};
 
-        static void SetTimeout(const Napi::CallbackInfo& info);
+        static Napi::Value SetTimeout(const Napi::CallbackInfo& info);
+        static Napi::Value SetInterval(const Napi::CallbackInfo& info);
+        static void ClearTimer(const Napi::CallbackInfo& info);
+        static Napi::Value RequestIdleCallback(const Napi::CallbackInfo& info);
+        static void CancelIdleCallback(const Napi::CallbackInfo& info);
         static Napi::Value DecodeBase64(const Napi::CallbackInfo& info);
         static void AddEventListener(const Napi::CallbackInfo& info);
         static void RemoveEventListener(const Napi::CallbackInfo& info);
 
-        void RecursiveWaitOrCall(std::shared_ptr<Napi::FunctionReference> function, std::chrono::system_clock::time_point whenToRun);
+        uint32_t AddTimer(const Napi::CallbackInfo& info, bool repeat);
+        void ScheduleTimer(uint32_t timerId, std::chrono::milliseconds delay);
+        void ScheduleDispatch();
+        void FireNextTimer(std::chrono::steady_clock::time_point dueTime);
+        void FireTimer(uint32_t timerId);
     };
 }
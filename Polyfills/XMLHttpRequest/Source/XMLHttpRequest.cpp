@@ -1,6 +1,7 @@
 #include "XMLHttpRequest.h"
 #include <Babylon/JsRuntime.h>
 #include <Babylon/Polyfills/XMLHttpRequest.h>
+#include <utility>
 
 namespace Babylon::Polyfills::Internal
 {
@@ -35,6 +36,51 @@ namespace Babylon::Polyfills::Internal
             }
         }
 
+        // Non-standard: lets loaders say which downloads matter most when many are queued.
+        namespace Priority
+        {
+            constexpr const char* Script = "script";
+            constexpr const char* Geometry = "geometry";
+            constexpr const char* Normal = "normal";
+            constexpr const char* Texture = "texture";
+            constexpr const char* Prefetch = "prefetch";
+
+            UrlLib::UrlPriority StringToEnum(const std::string& value)
+            {
+                if (value == Script)
+                    return UrlLib::UrlPriority::Script;
+                if (value == Geometry)
+                    return UrlLib::UrlPriority::Geometry;
+                if (value == Normal)
+                    return UrlLib::UrlPriority::Normal;
+                if (value == Texture)
+                    return UrlLib::UrlPriority::Texture;
+                if (value == Prefetch)
+                    return UrlLib::UrlPriority::Prefetch;
+
+                throw std::exception{};
+            }
+
+            const char* EnumToString(UrlLib::UrlPriority value)
+            {
+                switch (value)
+                {
+                    case UrlLib::UrlPriority::Script:
+                        return Script;
+                    case UrlLib::UrlPriority::Geometry:
+                        return Geometry;
+                    case UrlLib::UrlPriority::Normal:
+                        return Normal;
+                    case UrlLib::UrlPriority::Texture:
+                        return Texture;
+                    case UrlLib::UrlPriority::Prefetch:
+                        return Prefetch;
+                }
+
+                throw std::exception{};
+            }
+        }
+
         namespace MethodType
         {
             constexpr const char* Get = "GET";
@@ -51,7 +97,17 @@ namespace Babylon::Polyfills::Internal
         namespace EventType
         {
             constexpr const char* ReadyStateChange = "readystatechange";
+            constexpr const char* Progress = "progress";
+
+            // Non-standard: each listener receives an ArrayBuffer holding the next slice of the
+            // body as it arrives, so loaders can start parsing before the download completes.
+            // The body is only copied for JavaScript when a listener exists at send time.
+            constexpr const char* Chunk = "chunk";
         }
+
+        // Beyond this many undelivered chunks, further data is appended to the last one, so a
+        // JavaScript thread that falls behind receives fewer, larger chunk events.
+        constexpr size_t MAX_QUEUED_CHUNKS{64};
     }
 
     void XMLHttpRequest::Initialize(Napi::Env env)
@@ -67,6 +123,7 @@ namespace Babylon::Polyfills::Internal
                 StaticValue("HEADERS_RECEIVED", Napi::Value::From(env, 2)),
                 StaticValue("LOADING", Napi::Value::From(env, 3)),
                 StaticValue("DONE", Napi::Value::From(env, 4)),
+                InstanceAccessor("priority", &XMLHttpRequest::GetPriority, &XMLHttpRequest::SetPriority),
                 InstanceAccessor("readyState", &XMLHttpRequest::GetReadyState, nullptr),
                 InstanceAccessor("response", &XMLHttpRequest::GetResponse, nullptr),
                 InstanceAccessor("responseText", &XMLHttpRequest::GetResponseText, nullptr),
@@ -89,6 +146,16 @@ namespace Babylon::Polyfills::Internal
     {
     }
 
+    Napi::Value XMLHttpRequest::GetPriority(const Napi::CallbackInfo&)
+    {
+        return Napi::Value::From(Env(), Priority::EnumToString(m_request.Priority()));
+    }
+
+    void XMLHttpRequest::SetPriority(const Napi::CallbackInfo&, const Napi::Value& value)
+    {
+        m_request.Priority(Priority::StringToEnum(value.As<Napi::String>().Utf8Value()));
+    }
+
     Napi::Value XMLHttpRequest::GetReadyState(const Napi::CallbackInfo&)
     {
         return Napi::Value::From(Env(), arcana::underlying_cast(m_readyState));
@@ -102,7 +169,9 @@ namespace Babylon::Polyfills::Internal
 
     Napi::Value XMLHttpRequest::GetResponseText(const Napi::CallbackInfo&)
     {
-        return Napi::Value::From(Env(), m_request.ResponseString().data());
+        // The response may be a view of a cached file rather than a null-terminated string.
+        const auto responseString = m_request.ResponseString();
+        return Napi::String::New(Env(), responseString.data(), static_cast<size_t>(responseString.size()));
     }
 
     Napi::Value XMLHttpRequest::GetResponseType(const Napi::CallbackInfo&)
@@ -164,6 +233,7 @@ namespace Babylon::Polyfills::Internal
     void XMLHttpRequest::Abort(const Napi::CallbackInfo&)
     {
         m_request.Abort();
+        m_progress.reset();
     }
 
     void XMLHttpRequest::Open(const Napi::CallbackInfo& info)
@@ -174,7 +244,63 @@ namespace Babylon::Polyfills::Internal
 
     void XMLHttpRequest::Send(const Napi::CallbackInfo& /*info*/)
     {
-        m_request.SendAsync().then(m_runtimeScheduler, arcana::cancellation::none(), [this]() {
+        auto progress = std::make_shared<Progress>();
+        m_progress = progress;
+        m_reportedLoaded = 0;
+
+        m_request.SetProgressCallback([this, progress, runtimeScheduler{m_runtimeScheduler}](size_t loaded, size_t total) {
+            bool drainPending{};
+            {
+                std::scoped_lock lock{progress->Mutex};
+                progress->Loaded = loaded;
+                progress->Total = total;
+                drainPending = std::exchange(progress->DrainPending, true);
+            }
+
+            if (!drainPending)
+            {
+                runtimeScheduler([this, progress]() {
+                    DrainProgress(*progress);
+                });
+            }
+        });
+
+        auto chunkHandlers = m_eventHandlerRefs.find(EventType::Chunk);
+        if (chunkHandlers != m_eventHandlerRefs.end() && !chunkHandlers->second.empty())
+        {
+            m_request.SetDataCallback([this, progress, runtimeScheduler{m_runtimeScheduler}](gsl::span<const std::byte> data) {
+                bool drainPending{};
+                {
+                    std::scoped_lock lock{progress->Mutex};
+                    if (progress->Chunks.size() < MAX_QUEUED_CHUNKS)
+                    {
+                        progress->Chunks.emplace_back(data.begin(), data.end());
+                    }
+                    else
+                    {
+                        auto& last = progress->Chunks.back();
+                        last.insert(last.end(), data.begin(), data.end());
+                    }
+                    drainPending = std::exchange(progress->DrainPending, true);
+                }
+
+                if (!drainPending)
+                {
+                    runtimeScheduler([this, progress]() {
+                        DrainProgress(*progress);
+                    });
+                }
+            });
+        }
+        else
+        {
+            m_request.SetDataCallback({});
+        }
+
+        m_request.SendAsync().then(m_runtimeScheduler, arcana::cancellation::none(), [this, progress]() {
+            // Deliver whatever the last queued drain has not picked up yet, so every chunk and
+            // the final progress event precede DONE.
+            DrainProgress(*progress);
             SetReadyState(ReadyState::Done);
         });
     }
@@ -182,14 +308,69 @@ namespace Babylon::Polyfills::Internal
     void XMLHttpRequest::SetReadyState(ReadyState readyState)
     {
         m_readyState = readyState;
+        RaiseEvent(EventType::ReadyStateChange);
+    }
+
+    void XMLHttpRequest::DrainProgress(Progress& progress)
+    {
+        // Ignore drains for a request that has since been aborted or re-sent.
+        if (&progress != m_progress.get())
+        {
+            return;
+        }
 
-        auto it = m_eventHandlerRefs.find(EventType::ReadyStateChange);
+        size_t loaded{};
+        size_t total{};
+        std::vector<std::vector<std::byte>> chunks{};
+        {
+            std::scoped_lock lock{progress.Mutex};
+            loaded = progress.Loaded;
+            total = progress.Total;
+            chunks.swap(progress.Chunks);
+            progress.DrainPending = false;
+        }
+
+        if (loaded == m_reportedLoaded && chunks.empty())
+        {
+            return;
+        }
+
+        m_reportedLoaded = loaded;
+
+        if (m_readyState == ReadyState::Opened)
+        {
+            SetReadyState(ReadyState::HeadersReceived);
+        }
+        SetReadyState(ReadyState::Loading);
+
+        for (auto& chunk : chunks)
+        {
+            // The ArrayBuffer takes over the received bytes instead of copying them.
+            auto buffer = std::make_unique<std::vector<std::byte>>(std::move(chunk));
+            auto arrayBuffer = Napi::ArrayBuffer::New(Env(), buffer->data(), buffer->size(), [](Napi::Env, void*, std::vector<std::byte>* data) {
+                delete data;
+            }, buffer.get());
+            buffer.release();
+            RaiseEvent(EventType::Chunk, {arrayBuffer});
+        }
+
+        auto event = Napi::Object::New(Env());
+        event.Set("type", EventType::Progress);
+        event.Set("loaded", static_cast<double>(loaded));
+        event.Set("total", static_cast<double>(total));
+        event.Set("lengthComputable", total != 0);
+        RaiseEvent(EventType::Progress, {event});
+    }
+
+    void XMLHttpRequest::RaiseEvent(const char* eventType, const std::vector<napi_value>& args)
+    {
+        auto it = m_eventHandlerRefs.find(eventType);
         if (it != m_eventHandlerRefs.end())
         {
             const auto& eventHandlerRefs = it->second;
             for (const auto& eventHandlerRef : eventHandlerRefs)
             {
-                eventHandlerRef.Call({});
+                eventHandlerRef.Call(args);
             }
         }
     }
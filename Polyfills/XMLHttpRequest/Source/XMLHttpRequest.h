@@ -5,7 +5,10 @@
 #include <napi/napi.h>
 #include <UrlLib/UrlLib.h>
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace Babylon::Polyfills::Internal
 {
@@ -23,9 +26,26 @@ namespace Babylon::Polyfills::Internal
         {
             Unsent = 0,
             Opened = 1,
+            HeadersReceived = 2,
+            Loading = 3,
             Done = 4,
         };
 
+        // Written by UrlLib's background thread as the body arrives, drained on the JavaScript
+        // thread. At most one drain is queued at a time, so a fast download coalesces into a
+        // few events instead of one per network read. Chunks stop growing in number once
+        // MAX_QUEUED_CHUNKS are waiting and are appended to the last one instead.
+        struct Progress
+        {
+            std::mutex Mutex{};
+            size_t Loaded{};
+            size_t Total{};
+            std::vector<std::vector<std::byte>> Chunks{};
+            bool DrainPending{};
+        };
+
+        Napi::Value GetPriority(const Napi::CallbackInfo& info);
+        void SetPriority(const Napi::CallbackInfo& info, const Napi::Value& value);
         Napi::Value GetReadyState(const Napi::CallbackInfo& info);
         Napi::Value GetResponse(const Napi::CallbackInfo& info);
         Napi::Value GetResponseText(const Napi::CallbackInfo& info);
@@ -40,10 +60,14 @@ namespace Babylon::Polyfills::Internal
         void Send(const Napi::CallbackInfo& info);
 
         void SetReadyState(ReadyState readyState);
+        void DrainProgress(Progress& progress);
+        void RaiseEvent(const char* eventType, const std::vector<napi_value>& args = {});
 
         UrlLib::UrlRequest m_request{};
         JsRuntimeScheduler m_runtimeScheduler;
         ReadyState m_readyState{ReadyState::Unsent};
+        std::shared_ptr<Progress> m_progress{};
+        size_t m_reportedLoaded{};
         std::unordered_map<std::string, std::vector<Napi::FunctionReference>> m_eventHandlerRefs;
     };
 }